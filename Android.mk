@@ -32,7 +32,26 @@ LOCAL_MODULE_RELATIVE_PATH := hw
 LOCAL_HEADER_LIBRARIES += libhardware_headers
 LOCAL_CFLAGS += -Wno-error
 # main libpower source
-LOCAL_SRC_FILES := power.cpp
+LOCAL_SRC_FILES := power.cpp \
+                   BoostArbiter.cpp \
+                   BoostCoalescer.cpp \
+                   CpuSet.cpp \
+                   CpuTopology.cpp \
+                   EnergyMeter.cpp \
+                   GpuFreqMonitor.cpp \
+                   GpuThrottleController.cpp \
+                   HintDispatcher.cpp \
+                   HintTrace.cpp \
+                   IntelPstateBackend.cpp \
+                   LaunchBoost.cpp \
+                   PowerHalState.cpp \
+                   PowerStats.cpp \
+                   PropertyCache.cpp \
+                   SysfsIo.cpp \
+                   SysfsNode.cpp \
+                   ThermalClient.cpp \
+                   TouchClassifier.cpp \
+                   UclampBoost.cpp
 
 ifeq ($(HAS_THD), true)
     LOCAL_C_INCLUDES += external/thermal_daemon/src
@@ -43,9 +62,11 @@ endif
 # for all devices under /sys/power/power_HAL_suspend
 LOCAL_SRC_FILES += DevicePowerMonitor.cpp \
                    DevicePowerMonitorInfo.cpp \
-                   CGroupCpusetController.cpp
+                   CGroupCpusetController.cpp \
+                   ProcessMigrator.cpp \
+                   WorkerPool.cpp
 
-LOCAL_SHARED_LIBRARIES := liblog libcutils libutils libdl libbinder
+LOCAL_SHARED_LIBRARIES := liblog libcutils libutils libdl libbinder libbase
 
 LOCAL_MODULE_TAGS := optional
 
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "BoostArbiter.h"
+
+#include <cutils/log.h>
+
+#include "EnergyMeter.h"
+#include "HintTrace.h"
+#include "PowerStats.h"
+
+BoostArbiter::BoostArbiter():
+    mClients(0)
+{
+    for (int i = 0; i < RES_COUNT; i++) {
+        mResources[i].writer = NULL;
+        mResources[i].defaultValue = 0;
+        mResources[i].value = 0;
+        mResources[i].written = false;
+        mResources[i].dirty = false;
+        pthread_mutex_init(&mResources[i].writeLock, NULL);
+        for (int j = 0; j < CLIENT_COUNT; j++) {
+            mResources[i].slots[j].active = false;
+            mResources[i].slots[j].generation = 0;
+        }
+    }
+    pthread_mutex_init(&mLock, NULL);
+}
+
+/*
+ * The default is what the knob held before anyone asked for anything, and
+ * what it is put back to once the last request is gone. Requests submitted
+ * before the knob was set up are applied here.
+ */
+void BoostArbiter::setResource(enum boost_resource resource, int defaultValue,
+                               resource_writer_t writer)
+{
+    bool changed;
+
+    pthread_mutex_lock(&mLock);
+    mResources[resource].writer = writer;
+    mResources[resource].defaultValue = defaultValue;
+    mResources[resource].value = defaultValue;
+    mResources[resource].written = true;
+    changed = evaluate(resource);
+    pthread_mutex_unlock(&mLock);
+    if (changed)
+        flush(resource);
+}
+
+int BoostArbiter::effective(const Resource &res) const
+{
+    const struct BoostRequest *floor = NULL;
+    const struct BoostRequest *ceiling = NULL;
+    int value = res.defaultValue;
+
+    for (int i = 0; i < CLIENT_COUNT; i++) {
+        const Slot &slot = res.slots[i];
+
+        if (!slot.active)
+            continue;
+        if (slot.request.kind == BOOST_FLOOR) {
+            if (!floor || slot.request.level > floor->level ||
+                (slot.request.level == floor->level && slot.request.priority > floor->priority))
+                floor = &slot.request;
+        } else {
+            if (!ceiling || slot.request.level < ceiling->level ||
+                (slot.request.level == ceiling->level && slot.request.priority > ceiling->priority))
+                ceiling = &slot.request;
+        }
+    }
+
+    if (floor && floor->level > value)
+        value = floor->level;
+    if (ceiling && ceiling->level < value) {
+        /* a floor only beats the ceiling with strictly higher priority */
+        if (!floor || floor->level <= ceiling->level || floor->priority <= ceiling->priority)
+            value = ceiling->level;
+    }
+
+    return value;
+}
+
+/* The energy meter charges each set of clients holding a request */
+void BoostArbiter::updateClients()
+{
+    unsigned int clients = 0;
+
+    for (int i = 0; i < RES_COUNT; i++) {
+        for (int j = 0; j < CLIENT_COUNT; j++) {
+            if (mResources[i].slots[j].active)
+                clients |= 1u << j;
+        }
+    }
+    if (clients == mClients)
+        return;
+    mClients = clients;
+    EnergyMeter::setClients(clients);
+}
+
+/*
+ * Called with mLock held, after any change of the resource's slots. Only
+ * records the new value; when it returns true the caller runs flush()
+ * once it dropped mLock.
+ */
+bool BoostArbiter::evaluate(enum boost_resource resource)
+{
+    Resource &res = mResources[resource];
+    int value = effective(res);
+
+    updateClients();
+
+    if (res.written && value == res.value)
+        return false;
+    if (!res.writer)
+        return false;
+
+    PowerStats::boostState(resource, value);
+    res.value = value;
+    res.written = true;
+    res.dirty = true;
+    HintTrace::record(TRACE_BOOST, resource | (value != res.defaultValue ? TRACE_BOOST_ACTIVE : 0),
+                      value);
+    return true;
+}
+
+/*
+ * Called without mLock. Writes the resource's value if it changed since
+ * the last write; a value that changes meanwhile is written by the thread
+ * that changed it, once it gets the write lock.
+ */
+void BoostArbiter::flush(enum boost_resource resource)
+{
+    Resource &res = mResources[resource];
+    resource_writer_t writer;
+    bool failed;
+    int value;
+
+    pthread_mutex_lock(&res.writeLock);
+    pthread_mutex_lock(&mLock);
+    if (!res.dirty) {
+        pthread_mutex_unlock(&mLock);
+        pthread_mutex_unlock(&res.writeLock);
+        return;
+    }
+    res.dirty = false;
+    value = res.value;
+    writer = res.writer;
+    pthread_mutex_unlock(&mLock);
+
+    failed = writer(value) != 0;
+    PowerStats::count(STAT_BOOST_WRITES);
+    if (failed) {
+        /* the next evaluation writes it again */
+        pthread_mutex_lock(&mLock);
+        if (res.value == value)
+            res.written = false;
+        pthread_mutex_unlock(&mLock);
+        PowerStats::count(STAT_BOOST_ERRORS);
+        ALOGE("%s: could not set resource %d to %d", __func__, resource, value);
+    }
+    pthread_mutex_unlock(&res.writeLock);
+}
+
+/* Adds the request, replacing the client's previous one on that knob. */
+void BoostArbiter::submit(const struct BoostRequest &request)
+{
+    Slot *slot;
+    bool changed;
+
+    pthread_mutex_lock(&mLock);
+    slot = &mResources[request.resource].slots[request.client];
+    slot->active = true;
+    slot->request = request;
+    slot->generation++;
+    if (request.deadlineNs) {
+        Expiry expiry = { request.deadlineNs, request.client, request.resource, slot->generation };
+        mExpiries.push(expiry);
+    }
+    changed = evaluate(request.resource);
+    pthread_mutex_unlock(&mLock);
+    if (changed)
+        flush(request.resource);
+}
+
+void BoostArbiter::cancel(enum boost_client client, enum boost_resource resource)
+{
+    bool changed = false;
+    Slot *slot;
+
+    pthread_mutex_lock(&mLock);
+    slot = &mResources[resource].slots[client];
+    if (slot->active) {
+        slot->active = false;
+        slot->generation++;
+        changed = evaluate(resource);
+    }
+    pthread_mutex_unlock(&mLock);
+    if (changed)
+        flush(resource);
+}
+
+bool BoostArbiter::active(enum boost_client client, enum boost_resource resource)
+{
+    bool ret;
+
+    pthread_mutex_lock(&mLock);
+    ret = mResources[resource].slots[client].active;
+    pthread_mutex_unlock(&mLock);
+    return ret;
+}
+
+/*
+ * Drops every request whose deadline has passed and re-evaluates its knob.
+ * Heap entries of replaced or cancelled requests are skipped by generation.
+ * Returns the ns until the next deadline, or -1 if there is none.
+ */
+int64_t BoostArbiter::expire(int64_t nowNs)
+{
+    unsigned int expired = 0;
+    int64_t next = -1;
+
+    pthread_mutex_lock(&mLock);
+    while (!mExpiries.empty()) {
+        const Expiry &top = mExpiries.top();
+        Slot *slot = &mResources[top.resource].slots[top.client];
+
+        if (!slot->active || slot->generation != top.generation) {
+            mExpiries.pop();
+            continue;
+        }
+        if (top.deadlineNs > nowNs) {
+            next = top.deadlineNs - nowNs;
+            break;
+        }
+
+        enum boost_resource resource = top.resource;
+        ALOGV("%s: request of client %d on resource %d timed out", __func__, top.client, resource);
+        slot->active = false;
+        slot->generation++;
+        mExpiries.pop();
+        if (evaluate(resource))
+            expired |= 1u << resource;
+    }
+    pthread_mutex_unlock(&mLock);
+
+    for (int i = 0; i < RES_COUNT; i++) {
+        if (expired & (1u << i))
+            flush((enum boost_resource) i);
+    }
+    return next;
+}
+
+int BoostArbiter::value(enum boost_resource resource)
+{
+    int value;
+
+    pthread_mutex_lock(&mLock);
+    value = mResources[resource].value;
+    pthread_mutex_unlock(&mLock);
+    return value;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_BOOST_ARBITER_H
+#define ANDROID_BOOST_ARBITER_H
+
+#include <queue>
+#include <vector>
+
+#include <pthread.h>
+#include <stdint.h>
+
+/* Knobs shared between boost and throttle clients */
+enum boost_resource {
+    RES_INTERACTIVE_BOOST = 0,  /* cpufreq/interactive/boost, 0 or 1 */
+    RES_PSTATE_LEVEL,           /* intel_pstate, enum pstate_level */
+    RES_CPU_MAX_FREQ_PCT,       /* per policy cap, percent of max */
+    RES_POWER_SAVE,             /* thermal daemon power save, 0 or 1 */
+    RES_UCLAMP_MIN_PCT,         /* foreground uclamp.min, percent */
+    RES_COUNT,
+};
+
+enum boost_client {
+    CLIENT_TOUCH = 0,
+    CLIENT_INTERACTIVE,
+    CLIENT_LAUNCH,
+    CLIENT_LOW_POWER,
+    CLIENT_SUSTAINED,
+    CLIENT_GPU_THROTTLE,
+    CLIENT_COUNT,
+};
+
+enum boost_kind {
+    BOOST_FLOOR = 0,            /* value must be at least level */
+    BOOST_CEILING,              /* value must be at most level */
+};
+
+enum boost_priority {
+    PRIORITY_LOW = 0,
+    PRIORITY_NORMAL,
+    PRIORITY_HIGH,
+};
+
+struct BoostRequest {
+    enum boost_client client;
+    enum boost_resource resource;
+    enum boost_kind kind;
+    int level;
+    enum boost_priority priority;
+    /* CLOCK_MONOTONIC ns, 0 for no deadline */
+    int64_t deadlineNs;
+};
+
+/**
+ * Computes one effective value per knob from all outstanding requests and
+ * writes a knob only when that value changes. The effective value is the
+ * highest floor, limited by the lowest ceiling; when a floor and a ceiling
+ * conflict the request with the higher priority wins, ceilings on ties.
+ * Without requests a knob goes back to its default.
+ *
+ * Deadlines are kept in a min-heap and run from expire(), which the hint
+ * dispatch thread calls; requests with a deadline should come from there.
+ *
+ * Writers run outside the arbiter lock, so a slow knob only holds up the
+ * callers of that knob. Each knob has a write lock that keeps its writes
+ * in order, and a write always carries the latest effective value.
+ */
+class BoostArbiter {
+
+  public:
+      /* returns 0 when the knob now holds value */
+      typedef int (*resource_writer_t)(int value);
+
+      BoostArbiter();
+      virtual ~BoostArbiter() {};
+      void setResource(enum boost_resource resource, int defaultValue, resource_writer_t writer);
+      void submit(const struct BoostRequest &request);
+      void cancel(enum boost_client client, enum boost_resource resource);
+      bool active(enum boost_client client, enum boost_resource resource);
+      int64_t expire(int64_t nowNs);
+      int value(enum boost_resource resource);
+
+  private:
+      struct Slot {
+          bool active;
+          struct BoostRequest request;
+          unsigned int generation;
+      };
+
+      struct Resource {
+          resource_writer_t writer;
+          int defaultValue;
+          int value;
+          bool written;
+          /* value changed since the last write was started */
+          bool dirty;
+          pthread_mutex_t writeLock;
+          Slot slots[CLIENT_COUNT];
+      };
+
+      struct Expiry {
+          int64_t deadlineNs;
+          enum boost_client client;
+          enum boost_resource resource;
+          unsigned int generation;
+          bool operator>(const Expiry &other) const { return deadlineNs > other.deadlineNs; };
+      };
+
+      Resource mResources[RES_COUNT];
+      std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry> > mExpiries;
+      unsigned int mClients;
+      pthread_mutex_t mLock;
+
+      int effective(const Resource &res) const;
+      bool evaluate(enum boost_resource resource);
+      void flush(enum boost_resource resource);
+      void updateClients();
+};
+#endif  // ANDROID_BOOST_ARBITER_H
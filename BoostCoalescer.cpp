@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "BoostCoalescer.h"
+
+#include <cutils/log.h>
+
+static int hint_slot(int hint)
+{
+    if (hint < 0)
+        return 0;
+    if (hint >= BoostCoalescer::MAX_HINT)
+        return BoostCoalescer::MAX_HINT - 1;
+    return hint;
+}
+
+BoostCoalescer::BoostCoalescer(SysfsNode *node):
+    mNode(node), mWindowNs(0), mLastPulseNs(0), mPulsed(false)
+{
+    int i;
+
+    for (i = 0; i < MAX_HINT; i++) {
+        mIssued[i].store(0, std::memory_order_relaxed);
+        mSuppressed[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void BoostCoalescer::setWindow(unsigned int windowUs)
+{
+    mWindowNs = (int64_t)windowUs * 1000;
+}
+
+/* Returns 1 if the pulse was written, 0 if it was coalesced, -1 on error. */
+int BoostCoalescer::pulse(int hint, const struct timespec *time)
+{
+    int64_t now = (int64_t)time->tv_sec * 1000000000LL + time->tv_nsec;
+    int slot = hint_slot(hint);
+
+    if (mPulsed && now - mLastPulseNs < mWindowNs) {
+        mSuppressed[slot].fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    if (mNode->write("1"))
+        return -1;
+
+    mLastPulseNs = now;
+    mPulsed = true;
+    mIssued[slot].fetch_add(1, std::memory_order_relaxed);
+    return 1;
+}
+
+unsigned long BoostCoalescer::issued(int hint) const
+{
+    return mIssued[hint_slot(hint)].load(std::memory_order_relaxed);
+}
+
+unsigned long BoostCoalescer::suppressed(int hint) const
+{
+    return mSuppressed[hint_slot(hint)].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_BOOST_COALESCER_H
+#define ANDROID_BOOST_COALESCER_H
+
+#include <atomic>
+#include <stdint.h>
+#include <time.h>
+
+#include "SysfsNode.h"
+
+/**
+ * Rate limits writes to a boost pulse knob. The governor keeps a pulse in
+ * effect for its boostpulse_duration, so a new pulse requested within a
+ * window of that is dropped instead of being written again. The window
+ * should be well short of the duration, or a steady stream of requests
+ * sees the boost lapse before the next pulse.
+ */
+class BoostCoalescer {
+
+  public:
+      /* hint ids at or above this are accounted in the last slot */
+      static const int MAX_HINT = 16;
+
+      BoostCoalescer(SysfsNode *node);
+      virtual ~BoostCoalescer() {};
+      void setWindow(unsigned int windowUs);
+      unsigned int window() const { return mWindowNs / 1000; };
+      int pulse(int hint, const struct timespec *time);
+      unsigned long issued(int hint) const;
+      unsigned long suppressed(int hint) const;
+
+  private:
+      SysfsNode *mNode;
+      int64_t mWindowNs;
+      int64_t mLastPulseNs;
+      bool mPulsed;
+      std::atomic<unsigned long> mIssued[MAX_HINT];
+      std::atomic<unsigned long> mSuppressed[MAX_HINT];
+};
+#endif  // ANDROID_BOOST_COALESCER_H
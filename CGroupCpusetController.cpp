@@ -13,7 +13,6 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
-
 #define LOG_TAG "PowerHAL"
 #define LOG_NDEBUG 0
 
@@ -30,105 +29,292 @@
 #include <errno.h>
 #include <string.h>
 
-static const char* CPUSET_ROOT_CPUS = "/dev/cpuset/cpus";
-static const char* CPUSET_NON_INTERACTIVE_CPUS = "/dev/cpuset/non_interactive/cpus";
+#include "SysfsIo.h"
+
+static const char* CPUSET_CONFIG_FILE = "/vendor/etc/powerhal_cpusets.conf";
+/* legacy "interactive;non-interactive" cpus of the non_interactive cpuset */
 static const char* POWER_HAL_CPUSET_PROPERTY = "ro.vendor.powerhal.cpuset_config";
 static const char* POWER_HAL_CPUSET_PROPERTY_DEBUG = "persist.vendor.powerhal.cpuset_config"; /* for userdebug, eng build tuning*/
+static CachedProperty cpusetProperty(POWER_HAL_CPUSET_PROPERTY);
+static CachedProperty cpusetDebugProperty(POWER_HAL_CPUSET_PROPERTY_DEBUG);
+
+static const char *state_names[CPUSET_STATE_COUNT] = {
+    "non_interactive",
+    "interactive",
+};
 
-CGroupCpusetController::CGroupCpusetController()
+static bool read_cpus(const std::string &path, CpuSet &cpus)
 {
-    int fd;
-    int ret;
+    char buf[4096];
+    int fd = SysfsIo::open(path.c_str(), O_RDONLY | O_CLOEXEC);
     int len;
+
+    if (fd < 0)
+        return false;
+
+    len = SysfsIo::pread(fd, buf, sizeof(buf) - 1, 0, path.c_str());
+    close(fd);
+    if (len < 0)
+        return false;
+
+    buf[len] = '\0';
+    if (cpus.parse(buf)) {
+        ALOGE("Invalid cpu list in %s", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+CGroupCpusetController::CGroupCpusetController(const char *cpusetRoot):
+    mRoot(cpusetRoot), mTopology(NULL), mState(-1), mSubscribed(false)
+{
+    pthread_mutex_init(&mLock, NULL);
+}
+
+CGroupCpusetController::~CGroupCpusetController()
+{
+    pthread_mutex_destroy(&mLock);
+}
+
+CGroupCpusetController::Group *CGroupCpusetController::group(const std::string &name)
+{
+    Group group;
+
+    for (size_t i = 0; i < mGroups.size(); i++) {
+        if (mGroups[i].name == name)
+            return &mGroups[i];
+    }
+
+    group.name = name;
+    mGroups.push_back(group);
+    return &mGroups.back();
+}
+
+void CGroupCpusetController::setRule(const std::string &name, enum cpuset_state state,
+                                     const std::string &mask)
+{
+    group(name)->masks[state] = mask;
+}
+
+/*
+ * Without any configuration screen-off work goes to cpu0 as it always did,
+ * or to the E-cores on hybrid parts, where background work follows.
+ */
+void CGroupCpusetController::loadDefaults(bool hybrid)
+{
+    setRule("non_interactive", CPUSET_INTERACTIVE, "all");
+    setRule("non_interactive", CPUSET_NON_INTERACTIVE, hybrid ? "efficiency" : "0");
+    if (hybrid) {
+        setRule("background", CPUSET_NON_INTERACTIVE, "efficiency");
+        setRule("system-background", CPUSET_NON_INTERACTIVE, "efficiency");
+    }
+}
+
+/* Lines of "<cgroup> <interactive|non_interactive> <mask>", # comments */
+void CGroupCpusetController::loadConfig(const char *path)
+{
+    char line[256];
+    char name[64], state[32], mask[128];
+    FILE *file;
+
+    file = SysfsIo::fopen(path, "re");
+    if (file == NULL)
+        return;
+
+    while (fgets(line, sizeof(line), file)) {
+        char *hash = strchr(line, '#');
+        int i;
+
+        if (hash)
+            *hash = '\0';
+        if (sscanf(line, "%63s %31s %127s", name, state, mask) != 3)
+            continue;
+
+        for (i = 0; i < CPUSET_STATE_COUNT; i++) {
+            if (!strcmp(state, state_names[i]))
+                break;
+        }
+        if (i == CPUSET_STATE_COUNT) {
+            ALOGW("%s: unknown state '%s' for cpuset %s", path, state, name);
+            continue;
+        }
+        setRule(name, (enum cpuset_state)i, mask);
+    }
+    fclose(file);
+}
+
+void CGroupCpusetController::loadLegacy(const CachedProperty &property)
+{
     char cpuset_config[PROPERTY_VALUE_MAX];
+    char *conf;
+    char *next_token;
 
-#ifdef POWERHAL_DEBUG
-    len = property_get(POWER_HAL_CPUSET_PROPERTY_DEBUG, cpuset_config, NULL);
-    if (len > 0) {
-        cpuset_config[len] = '\0';
-        char *conf;
-        char *next_token;
-        conf = strtok_r(cpuset_config, ";", &next_token);
-        if (conf)
-            snprintf(mCpusetRootCpus, strlen(conf)+1, "%s", conf);
-        conf = strtok_r(NULL, ";", &next_token);
-        if (conf)
-            snprintf(mCpusetNoninterCpus, strlen(conf)+1, "%s", conf);
+    if (!property.isSet())
+        return;
+    snprintf(cpuset_config, sizeof(cpuset_config), "%s", property.value().c_str());
+
+    conf = strtok_r(cpuset_config, ";", &next_token);
+    if (conf)
+        setRule("non_interactive", CPUSET_INTERACTIVE, conf);
+    conf = strtok_r(NULL, ";", &next_token);
+    if (conf)
+        setRule("non_interactive", CPUSET_NON_INTERACTIVE, conf);
+}
+
+/* Turns a mask into cpus the root cpuset has, falling back to all of them */
+bool CGroupCpusetController::resolve(const std::string &mask, CpuSet &cpus)
+{
+    if (mask == "all") {
+        cpus = mAll;
+    } else if (mask == "performance") {
+        cpus = mPerformance;
+    } else if (mask == "efficiency") {
+        cpus = mEfficiency;
+    } else if (cpus.parse(mask.c_str())) {
+        ALOGE("Invalid cpu mask '%s'", mask.c_str());
+        return false;
+    } else if (!cpus.subsetOf(mAll)) {
+        ALOGW("cpu mask %s has cpus outside %s, ignoring them", mask.c_str(),
+              mAll.format().c_str());
+    }
+
+    cpus &= mAll;
+    if (cpus.empty())
+        cpus = mAll;
+    return true;
+}
+
+std::string CGroupCpusetController::cpusPath(const Group &group)
+{
+    return mRoot + "/" + group.name + "/cpus";
+}
+
+/* Called with mLock held */
+void CGroupCpusetController::load()
+{
+    std::vector<CpufreqPolicy> policies = mTopology->policies();
+
+    mGroups.clear();
+    mPerformance.clearAll();
+    mEfficiency.clearAll();
+    if (!read_cpus(mRoot + "/cpus", mAll) || mAll.empty()) {
+        /* not a hard error, the cpusets are left alone */
+        ALOGV("Could not read %s/cpus (%d)", mRoot.c_str(), errno);
         return;
     }
+
+    for (size_t i = 0; i < policies.size(); i++) {
+        if (policies[i].coreType == CORE_TYPE_EFFICIENCY)
+            mEfficiency |= policies[i].cpus;
+        else
+            mPerformance |= policies[i].cpus;
+    }
+
+    loadDefaults(!mEfficiency.empty() && !mPerformance.empty());
+    loadConfig(CPUSET_CONFIG_FILE);
+    loadLegacy(cpusetProperty);
+#ifdef POWERHAL_DEBUG
+    loadLegacy(cpusetDebugProperty);
 #endif
-    len = property_get(POWER_HAL_CPUSET_PROPERTY, cpuset_config, NULL);
-    if (len > 0) {
-        cpuset_config[len] = '\0';
-        char *conf;
-        char *next_token;
-        conf = strtok_r(cpuset_config, ";", &next_token);
-        if (conf)
-            snprintf(mCpusetRootCpus, strlen(conf)+1, "%s", conf);
-        conf = strtok_r(NULL, ";", &next_token);
-        if (conf)
-            snprintf(mCpusetNoninterCpus, strlen(conf)+1, "%s", conf);
-    } else {
-        /* Default to set .cpus to 0 */
-        snprintf(mCpusetRootCpus, sizeof(mCpusetRootCpus), "0");
-
-        /**
-         * Read the default cpuset .cpus number.
-         * Will be used when device is interactive.
-         */
-        fd = open(CPUSET_ROOT_CPUS, O_RDONLY);
-
-        if (fd < 0) {
-            /* not a hard error; default is "0" (CPU core #0 only). */
-            ALOGV("Could not open the file: %s (%d)", CPUSET_ROOT_CPUS, errno);
-            return;
-        }
 
-        ret = read(fd, mCpusetRootCpus, sizeof(mCpusetRootCpus));
-        if (ret <= 0) {
-            /* nothing is being read but not a hard error */
-            /* default is "0" (CPU core #0 only).         */
-            ALOGV("Error when reading from file (%d)", errno);
-            close(fd);
-            return;
+    for (size_t i = 0; i < mGroups.size(); ) {
+        Group &group = mGroups[i];
+        bool valid = read_cpus(cpusPath(group), group.initial);
+
+        for (int state = 0; state < CPUSET_STATE_COUNT && valid; state++) {
+            if (group.masks[state].empty())
+                group.cpus[state] = group.initial;
+            else
+                valid = resolve(group.masks[state], group.cpus[state]);
         }
+        if (!valid) {
+            ALOGW("Ignoring cpuset %s", group.name.c_str());
+            mGroups.erase(mGroups.begin() + i);
+            continue;
+        }
+        ALOGI("cpuset %s: interactive %s, non interactive %s", group.name.c_str(),
+              group.cpus[CPUSET_INTERACTIVE].format().c_str(),
+              group.cpus[CPUSET_NON_INTERACTIVE].format().c_str());
+        i++;
+    }
+}
 
-        mCpusetRootCpus[sizeof(mCpusetRootCpus) - 1] = '\0';
-        close(fd);
-        mCpusetNoninterCpus[0] = '0';
-        mCpusetNoninterCpus[1] = '\0';
+void CGroupCpusetController::init(const CpuTopology &topology)
+{
+    pthread_mutex_lock(&mLock);
+    mTopology = &topology;
+    load();
+#ifdef POWERHAL_DEBUG
+    if (!mSubscribed)
+        PropertyCache::subscribe(POWER_HAL_CPUSET_PROPERTY_DEBUG, propertyListener, this);
+    mSubscribed = true;
+#endif
+    pthread_mutex_unlock(&mLock);
+}
+
+/*
+ * Puts every cpuset back to what it held at init(), so that is what the
+ * new table restores to, then reapplies the current state.
+ */
+void CGroupCpusetController::reload()
+{
+    pthread_mutex_lock(&mLock);
+    if (mTopology == NULL) {
+        pthread_mutex_unlock(&mLock);
+        return;
     }
-    return;
+    for (size_t i = 0; i < mGroups.size(); i++)
+        apply(mGroups[i], mGroups[i].initial);
+    load();
+    for (size_t i = 0; mState >= 0 && i < mGroups.size(); i++)
+        apply(mGroups[i], mGroups[i].cpus[mState]);
+    pthread_mutex_unlock(&mLock);
 }
 
-void CGroupCpusetController::setState(int state)
+void CGroupCpusetController::propertyListener(void *cookie)
+{
+    ALOGI("cpuset configuration changed, reloading");
+    ((CGroupCpusetController *)cookie)->reload();
+}
+
+int CGroupCpusetController::apply(const Group &group, const CpuSet &cpus)
 {
+    std::string path = cpusPath(group);
+    std::string list;
+    CpuSet current;
     int fd;
-    int ret = 0;
+    int ret;
 
-    /**
-     * Enable all cpus if interactive
-     * Restrict to certrain CPUs if non-interactive.
-     */
-    fd = open(CPUSET_NON_INTERACTIVE_CPUS, O_WRONLY);
+    /* compare as sets, the kernel may print a list differently */
+    if (read_cpus(path, current) && current == cpus)
+        return 0;
 
-    if (fd < 0) {
-        ALOGE("Could not open the file: %s (%d)", CPUSET_NON_INTERACTIVE_CPUS, errno);
-        return;
-    }
+    list = cpus.format();
 
-    if (state) {
-        /* Let loose when interactive */
-        ret = write(fd, mCpusetRootCpus, sizeof(mCpusetRootCpus));
-    }
-    else {
-        /* Restrict when non-interactive */
-        ret = write(fd, mCpusetNoninterCpus, sizeof(mCpusetNoninterCpus));
+    fd = SysfsIo::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ALOGE("Could not open the file: %s (%d)", path.c_str(), errno);
+        return -1;
     }
 
+    ret = SysfsIo::pwrite(fd, list.c_str(), list.size(), 0, path.c_str());
+    close(fd);
     if (ret < 0) {
-        ALOGE("Error when writing to the file (%d)", errno);
+        ALOGE("Error when writing %s to %s (%d)", list.c_str(), path.c_str(), errno);
+        return -1;
     }
 
-    close(fd);
+    ALOGD("cpuset %s cpus = %s", group.name.c_str(), list.c_str());
+    return 0;
+}
+
+void CGroupCpusetController::setState(int state)
+{
+    enum cpuset_state target = state ? CPUSET_INTERACTIVE : CPUSET_NON_INTERACTIVE;
+
+    pthread_mutex_lock(&mLock);
+    mState = target;
+    for (size_t i = 0; i < mGroups.size(); i++)
+        apply(mGroups[i], mGroups[i].cpus[target]);
+    pthread_mutex_unlock(&mLock);
 }
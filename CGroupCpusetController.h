@@ -13,7 +13,6 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
-
 #ifndef ANDROID_CGROUP_CPUSET_CONTROLLER_H
 #define ANDROID_CGROUP_CPUSET_CONTROLLER_H
 
@@ -23,19 +22,64 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <vector>
 
+#include "CpuTopology.h"
+#include "PropertyCache.h"
+
+enum cpuset_state {
+    CPUSET_NON_INTERACTIVE = 0,
+    CPUSET_INTERACTIVE,
+    CPUSET_STATE_COUNT,
+};
+
+/**
+ * Reshapes cpusets on interactive transitions from a (cgroup, state) to
+ * cpu mask table. Masks are cpulists or one of "all", "performance" and
+ * "efficiency", resolved against the core types CpuTopology found, so on
+ * hybrid parts screen-off work can be kept on the E-cores. A cgroup with
+ * no mask for a state gets back what it held at init(). A cpuset is only
+ * written when its current contents differ. Debug builds reload() when
+ * the tuning property changes.
+ */
 class CGroupCpusetController {
 
   public:
-      CGroupCpusetController();
-      virtual ~CGroupCpusetController() {};
+      CGroupCpusetController(const char *cpusetRoot = "/dev/cpuset");
+      virtual ~CGroupCpusetController();
+      void init(const CpuTopology &topology);
+      void reload();
       void setState(int state);
 
   private:
-      /* "all" cpus string in root cpuset */
-      char mCpusetRootCpus[10];
-      char mCpusetNoninterCpus[10];
+      struct Group {
+          std::string name;                     /* relative to the cpuset root */
+          CpuSet initial;                       /* cpus at init() */
+          std::string masks[CPUSET_STATE_COUNT]; /* as configured, empty to restore */
+          CpuSet cpus[CPUSET_STATE_COUNT];      /* resolved masks */
+      };
+
+      std::string mRoot;
+      std::vector<Group> mGroups;
+      CpuSet mAll;
+      CpuSet mPerformance;
+      CpuSet mEfficiency;
+      const CpuTopology *mTopology;
+      int mState;                               /* last set, -1 before any */
+      bool mSubscribed;
+      pthread_mutex_t mLock;
+
+      void load();
+      static void propertyListener(void *cookie);
+      Group *group(const std::string &name);
+      void setRule(const std::string &name, enum cpuset_state state, const std::string &mask);
+      void loadDefaults(bool hybrid);
+      void loadConfig(const char *path);
+      void loadLegacy(const CachedProperty &property);
+      bool resolve(const std::string &mask, CpuSet &cpus);
+      std::string cpusPath(const Group &group);
+      int apply(const Group &group, const CpuSet &cpus);
 };
 #endif  // ANDROID_CGROUP_CPUSET_CONTROLLER_H
@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "CpuSet.h"
+
+#include <ctype.h>
+#include <string.h>
+
+void CpuSet::clearAll()
+{
+    memset(mBits, 0, sizeof(mBits));
+}
+
+void CpuSet::set(int cpu)
+{
+    if (cpu >= 0 && cpu < MAX_CPUS)
+        mBits[cpu / 64] |= 1ULL << (cpu % 64);
+}
+
+void CpuSet::clear(int cpu)
+{
+    if (cpu >= 0 && cpu < MAX_CPUS)
+        mBits[cpu / 64] &= ~(1ULL << (cpu % 64));
+}
+
+/* Sets first..last a word at a time; both must be valid cpus */
+void CpuSet::setRange(int first, int last)
+{
+    int word = first / 64;
+    int end = last / 64;
+    uint64_t head = ~0ULL << (first % 64);
+    uint64_t tail = ~0ULL >> (63 - last % 64);
+
+    if (word == end) {
+        mBits[word] |= head & tail;
+        return;
+    }
+    mBits[word++] |= head;
+    while (word < end)
+        mBits[word++] = ~0ULL;
+    mBits[end] |= tail;
+}
+
+bool CpuSet::test(int cpu) const
+{
+    if (cpu < 0 || cpu >= MAX_CPUS)
+        return false;
+    return mBits[cpu / 64] & (1ULL << (cpu % 64));
+}
+
+int CpuSet::count() const
+{
+    int n = 0;
+
+    for (int i = 0; i < WORDS; i++)
+        n += __builtin_popcountll(mBits[i]);
+    return n;
+}
+
+bool CpuSet::empty() const
+{
+    for (int i = 0; i < WORDS; i++) {
+        if (mBits[i])
+            return false;
+    }
+    return true;
+}
+
+int CpuSet::next(int cpu) const
+{
+    int word;
+    uint64_t bits;
+
+    if (cpu < 0)
+        cpu = 0;
+    if (cpu >= MAX_CPUS)
+        return -1;
+
+    word = cpu / 64;
+    bits = mBits[word] & (~0ULL << (cpu % 64));
+    while (!bits) {
+        if (++word == WORDS)
+            return -1;
+        bits = mBits[word];
+    }
+    return word * 64 + __builtin_ctzll(bits);
+}
+
+bool CpuSet::subsetOf(const CpuSet &other) const
+{
+    for (int i = 0; i < WORDS; i++) {
+        if (mBits[i] & ~other.mBits[i])
+            return false;
+    }
+    return true;
+}
+
+CpuSet &CpuSet::operator&=(const CpuSet &other)
+{
+    for (int i = 0; i < WORDS; i++)
+        mBits[i] &= other.mBits[i];
+    return *this;
+}
+
+CpuSet &CpuSet::operator|=(const CpuSet &other)
+{
+    for (int i = 0; i < WORDS; i++)
+        mBits[i] |= other.mBits[i];
+    return *this;
+}
+
+CpuSet &CpuSet::operator-=(const CpuSet &other)
+{
+    for (int i = 0; i < WORDS; i++)
+        mBits[i] &= ~other.mBits[i];
+    return *this;
+}
+
+bool CpuSet::operator==(const CpuSet &other) const
+{
+    return !memcmp(mBits, other.mBits, sizeof(mBits));
+}
+
+/* A decimal below MAX_CPUS; no signs, no overflow */
+static const char *parse_cpu(const char *s, int *cpu)
+{
+    int value = 0;
+
+    if (!isdigit((unsigned char)*s))
+        return NULL;
+    while (isdigit((unsigned char)*s)) {
+        value = value * 10 + (*s++ - '0');
+        if (value >= CpuSet::MAX_CPUS)
+            return NULL;
+    }
+    *cpu = value;
+    return s;
+}
+
+/*
+ * Parses a cpulist as the kernel prints and accepts it: comma separated
+ * cpus and ranges, a range optionally strided as "first-last:used/group".
+ * Trailing whitespace is fine and an empty list is the empty set. On error
+ * the set is left empty.
+ */
+int CpuSet::parse(const char *s)
+{
+    clearAll();
+
+    while (*s && !isspace((unsigned char)*s)) {
+        int first, last, used = 1, group = 1;
+
+        if (!(s = parse_cpu(s, &first)))
+            goto error;
+        last = first;
+        if (*s == '-') {
+            if (!(s = parse_cpu(s + 1, &last)) || last < first)
+                goto error;
+            if (*s == ':') {
+                if (!(s = parse_cpu(s + 1, &used)) || *s != '/' ||
+                    !(s = parse_cpu(s + 1, &group)) || used == 0 || used > group)
+                    goto error;
+            }
+        }
+
+        if (used == group) {
+            setRange(first, last);
+        } else {
+            for (int cpu = first; cpu <= last; cpu += group)
+                setRange(cpu, cpu + used - 1 < last ? cpu + used - 1 : last);
+        }
+
+        if (*s == ',') {
+            s++;
+            if (!*s || isspace((unsigned char)*s))
+                goto error;
+        } else if (*s && !isspace((unsigned char)*s)) {
+            goto error;
+        }
+    }
+
+    while (isspace((unsigned char)*s))
+        s++;
+    if (*s)
+        goto error;
+    return 0;
+
+error:
+    clearAll();
+    return -1;
+}
+
+/* Lowest cpu at or above cpu that is not in the set, or MAX_CPUS */
+int CpuSet::nextClear(int cpu) const
+{
+    int word = cpu / 64;
+    uint64_t bits;
+
+    if (cpu >= MAX_CPUS)
+        return MAX_CPUS;
+
+    bits = ~mBits[word] & (~0ULL << (cpu % 64));
+    while (!bits) {
+        if (++word == WORDS)
+            return MAX_CPUS;
+        bits = ~mBits[word];
+    }
+    return word * 64 + __builtin_ctzll(bits);
+}
+
+/* Cpus are below 10000, so at most four digits */
+static char *format_cpu(char *p, int cpu)
+{
+    char digits[4];
+    int n = 0;
+
+    do {
+        digits[n++] = '0' + cpu % 10;
+        cpu /= 10;
+    } while (cpu);
+    while (n)
+        *p++ = digits[--n];
+    return p;
+}
+
+std::string CpuSet::format() const
+{
+    /* worst case is every other cpu, "1000," at most five chars each */
+    char buf[MAX_CPUS * 5];
+    char *p = buf;
+    int cpu = first();
+
+    while (cpu >= 0) {
+        int last = nextClear(cpu) - 1;
+
+        if (p != buf)
+            *p++ = ',';
+        p = format_cpu(p, cpu);
+        if (last > cpu) {
+            *p++ = '-';
+            p = format_cpu(p, last);
+        }
+        cpu = next(last + 1);
+    }
+    return std::string(buf, p - buf);
+}
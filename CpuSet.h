@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_CPU_SET_H
+#define ANDROID_CPU_SET_H
+
+#include <string>
+
+#include <stdint.h>
+
+/**
+ * Fixed-size cpu bitmap with the kernel's cpulist syntax ("0-3,8-15",
+ * "0-15:2/4"). Sized like cpu_set_t, so it is cheap to copy and covers
+ * every cpu count the kernel can report here.
+ */
+class CpuSet {
+
+  public:
+      static const int MAX_CPUS = 1024;
+
+      CpuSet() { clearAll(); };
+      int parse(const char *s);
+      std::string format() const;
+
+      void set(int cpu);
+      void clear(int cpu);
+      bool test(int cpu) const;
+      void clearAll();
+      int count() const;
+      bool empty() const;
+      /* lowest cpu at or above cpu, or -1 */
+      int next(int cpu) const;
+      int first() const { return next(0); };
+      bool subsetOf(const CpuSet &other) const;
+
+      CpuSet &operator&=(const CpuSet &other);
+      CpuSet &operator|=(const CpuSet &other);
+      CpuSet &operator-=(const CpuSet &other);
+      bool operator==(const CpuSet &other) const;
+      bool operator!=(const CpuSet &other) const { return !(*this == other); };
+
+  private:
+      static const int WORDS = MAX_CPUS / 64;
+
+      uint64_t mBits[WORDS];
+
+      void setRange(int first, int last);
+      int nextClear(int cpu) const;
+};
+
+inline CpuSet operator&(CpuSet a, const CpuSet &b) { return a &= b; }
+inline CpuSet operator|(CpuSet a, const CpuSet &b) { return a |= b; }
+inline CpuSet operator-(CpuSet a, const CpuSet &b) { return a -= b; }
+
+#endif  // ANDROID_CPU_SET_H
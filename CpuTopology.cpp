@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "CpuTopology.h"
+
+#include <algorithm>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+#include "SysfsIo.h"
+#include "SysfsNode.h"
+
+/* One-shot read for files only looked at while (re)building the model */
+static int read_file(const std::string &path, char *buf, int length)
+{
+    int fd = SysfsIo::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    int len;
+
+    if (fd < 0)
+        return -1;
+
+    len = SysfsIo::pread(fd, buf, length - 1, 0, path.c_str());
+    close(fd);
+    if (len < 0)
+        return -1;
+
+    buf[len] = '\0';
+    return len;
+}
+
+static unsigned long read_ulong(const std::string &path)
+{
+    char buf[32];
+
+    if (read_file(path, buf, sizeof(buf)) <= 0)
+        return 0;
+    return strtoul(buf, NULL, 10);
+}
+
+CpuTopology::CpuTopology(const char *sysfsRoot):
+    mCpuRoot(std::string(sysfsRoot) + "/devices/system/cpu"),
+    mDevicesRoot(std::string(sysfsRoot) + "/devices"),
+    mCapPercent(100)
+{
+    pthread_mutex_init(&mLock, NULL);
+}
+
+int CpuTopology::readCpuList(const std::string &path, CpuSet &cpus)
+{
+    char buf[4096];
+
+    cpus.clearAll();
+    if (read_file(path, buf, sizeof(buf)) < 0)
+        return -1;
+    return cpus.parse(buf);
+}
+
+/* Not every driver has a table; intel_pstate for one does not. */
+static void readFreqTable(const std::string &path, std::vector<unsigned long> &freqs)
+{
+    char buf[1024];
+    char *p, *end;
+    unsigned long freq;
+
+    freqs.clear();
+    if (read_file(path, buf, sizeof(buf)) <= 0)
+        return;
+
+    for (p = buf; ; p = end) {
+        freq = strtoul(p, &end, 10);
+        if (end == p)
+            break;
+        freqs.push_back(freq);
+    }
+    std::sort(freqs.begin(), freqs.end());
+}
+
+void CpuTopology::addPolicy(const std::string &path)
+{
+    CpufreqPolicy policy;
+
+    policy.path = path;
+    if (readCpuList(path + "/related_cpus", policy.cpus) || policy.cpus.empty())
+        return;
+    policy.minFreq = read_ulong(path + "/cpuinfo_min_freq");
+    policy.maxFreq = read_ulong(path + "/cpuinfo_max_freq");
+    if (!policy.maxFreq)
+        return;
+    readFreqTable(path + "/scaling_available_frequencies", policy.freqs);
+    policy.coreType = CORE_TYPE_UNKNOWN;
+    policy.online = false;
+
+    /* the per-cpu fallback lists a shared policy once per cpu */
+    for (size_t i = 0; i < mPolicies.size(); i++) {
+        if (mPolicies[i].cpus == policy.cpus)
+            return;
+    }
+    mPolicies.push_back(policy);
+}
+
+/*
+ * Hybrid parts expose one PMU per core type listing its cpus. Without
+ * that, only a policy far below the fastest is taken for an efficiency
+ * core: ITMT parts spread the max freqs of identical cores by a few bins.
+ */
+void CpuTopology::detectCoreTypes()
+{
+    CpuSet pcores, ecores;
+    unsigned long fastest = 0;
+    bool hybrid, split = false;
+
+    readCpuList(mDevicesRoot + "/cpu_core/cpus", pcores);
+    readCpuList(mDevicesRoot + "/cpu_atom/cpus", ecores);
+    hybrid = !pcores.empty() && !ecores.empty();
+
+    for (size_t i = 0; i < mPolicies.size(); i++)
+        fastest = std::max(fastest, mPolicies[i].maxFreq);
+    for (size_t i = 0; i < mPolicies.size(); i++)
+        split |= mPolicies[i].maxFreq < fastest / 100 * (100 - CORE_TYPE_FREQ_GAP);
+
+    for (size_t i = 0; i < mPolicies.size(); i++) {
+        CpufreqPolicy &policy = mPolicies[i];
+        int cpu = policy.cpus.first();
+
+        if (hybrid) {
+            if (pcores.test(cpu))
+                policy.coreType = CORE_TYPE_PERFORMANCE;
+            else if (ecores.test(cpu))
+                policy.coreType = CORE_TYPE_EFFICIENCY;
+        } else if (split) {
+            policy.coreType = policy.maxFreq < fastest / 100 * (100 - CORE_TYPE_FREQ_GAP) ?
+                CORE_TYPE_EFFICIENCY : CORE_TYPE_PERFORMANCE;
+        }
+    }
+}
+
+void CpuTopology::updateOnline()
+{
+    for (size_t i = 0; i < mPolicies.size(); i++) {
+        CpufreqPolicy &policy = mPolicies[i];
+
+        policy.online = !(policy.cpus & mOnline).empty();
+    }
+}
+
+int CpuTopology::scan()
+{
+    std::string dirPath = mCpuRoot + "/cpufreq";
+    struct dirent *de;
+    DIR *dir;
+
+    pthread_mutex_lock(&mLock);
+    mPolicies.clear();
+    if (readCpuList(mCpuRoot + "/possible", mPossible) ||
+        readCpuList(mCpuRoot + "/online", mOnline)) {
+        ALOGE("Could not read cpu masks under %s", mCpuRoot.c_str());
+        pthread_mutex_unlock(&mLock);
+        return -1;
+    }
+
+    dir = SysfsIo::opendir(dirPath.c_str());
+    if (dir != NULL) {
+        while ((de = readdir(dir))) {
+            if (strncmp(de->d_name, "policy", strlen("policy")))
+                continue;
+            addPolicy(dirPath + "/" + de->d_name);
+        }
+        closedir(dir);
+    }
+
+    /* kernels without policyN directories */
+    if (mPolicies.empty()) {
+        for (int cpu = mPossible.first(); cpu >= 0; cpu = mPossible.next(cpu + 1))
+            addPolicy(mCpuRoot + "/cpu" + std::to_string(cpu) + "/cpufreq");
+    }
+
+    std::sort(mPolicies.begin(), mPolicies.end(),
+              [](const CpufreqPolicy &a, const CpufreqPolicy &b) { return a.cpus.first() < b.cpus.first(); });
+    detectCoreTypes();
+    updateOnline();
+
+    ALOGI("cpu topology: %d possible, %d online cpus, %zu cpufreq policies",
+          mPossible.count(), mOnline.count(), mPolicies.size());
+    pthread_mutex_unlock(&mLock);
+    return 0;
+}
+
+/*
+ * Picks up cpu hotplug. A policy that comes online gets the current cap
+ * re-applied, since the kernel resets scaling_max_freq on re-init.
+ */
+int CpuTopology::refresh()
+{
+    CpuSet online;
+    int ret = 0;
+
+    if (readCpuList(mCpuRoot + "/online", online))
+        return -1;
+
+    pthread_mutex_lock(&mLock);
+    if (online == mOnline) {
+        pthread_mutex_unlock(&mLock);
+        return 0;
+    }
+    pthread_mutex_unlock(&mLock);
+
+    if (scan())
+        return -1;
+
+    pthread_mutex_lock(&mLock);
+    if (mCapPercent != 100)
+        ret = applyCap();
+    pthread_mutex_unlock(&mLock);
+    return ret;
+}
+
+int CpuTopology::applyCap()
+{
+    int ret = 0;
+
+    for (size_t i = 0; i < mPolicies.size(); i++) {
+        const CpufreqPolicy &policy = mPolicies[i];
+        unsigned long freq;
+
+        if (!policy.online)
+            continue;
+
+        freq = policy.maxFreq / 100 * mCapPercent;
+        if (!policy.freqs.empty()) {
+            /* highest operating point at or below the cap */
+            std::vector<unsigned long>::const_iterator it =
+                std::upper_bound(policy.freqs.begin(), policy.freqs.end(), freq);
+            freq = it == policy.freqs.begin() ? *it : *(it - 1);
+        }
+        if (freq < policy.minFreq)
+            freq = policy.minFreq;
+        if (sysfs_write((policy.path + "/scaling_max_freq").c_str(),
+                        std::to_string(freq).c_str())) {
+            ret = -1;
+            continue;
+        }
+        ALOGI("%s scaling_max_freq = %lu\n", policy.path.c_str(), freq);
+    }
+
+    return ret;
+}
+
+std::vector<CpufreqPolicy> CpuTopology::policies() const
+{
+    std::vector<CpufreqPolicy> policies;
+
+    pthread_mutex_lock(&mLock);
+    policies = mPolicies;
+    pthread_mutex_unlock(&mLock);
+    return policies;
+}
+
+CpuSet CpuTopology::possibleCpus() const
+{
+    CpuSet cpus;
+
+    pthread_mutex_lock(&mLock);
+    cpus = mPossible;
+    pthread_mutex_unlock(&mLock);
+    return cpus;
+}
+
+CpuSet CpuTopology::onlineCpus() const
+{
+    CpuSet cpus;
+
+    pthread_mutex_lock(&mLock);
+    cpus = mOnline;
+    pthread_mutex_unlock(&mLock);
+    return cpus;
+}
+
+/* Caps every online policy at a percentage of its own cpuinfo_max_freq. */
+int CpuTopology::capMaxFreq(unsigned int percent)
+{
+    int ret;
+
+    if (percent > 100)
+        percent = 100;
+
+    pthread_mutex_lock(&mLock);
+    mCapPercent = percent;
+    ret = applyCap();
+    pthread_mutex_unlock(&mLock);
+    return ret;
+}
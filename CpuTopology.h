@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_CPU_TOPOLOGY_H
+#define ANDROID_CPU_TOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+#include "CpuSet.h"
+
+/* max freq gap, percent, that tells core types apart without PMUs */
+#define CORE_TYPE_FREQ_GAP 30
+
+enum cpu_core_type {
+    CORE_TYPE_UNKNOWN = 0,
+    CORE_TYPE_PERFORMANCE,
+    CORE_TYPE_EFFICIENCY,
+};
+
+struct CpufreqPolicy {
+    std::string path;               /* .../cpufreq/policyN */
+    CpuSet cpus;                    /* related_cpus */
+    unsigned long minFreq;          /* cpuinfo_min_freq, kHz */
+    unsigned long maxFreq;          /* cpuinfo_max_freq, kHz */
+    std::vector<unsigned long> freqs; /* scaling_available_frequencies, ascending */
+    enum cpu_core_type coreType;
+    bool online;                    /* at least one related cpu is online */
+};
+
+/**
+ * CPU and cpufreq policy layout read from sysfs. The sysfs root is a
+ * parameter so the model can be built from a synthetic tree.
+ */
+class CpuTopology {
+
+  public:
+      CpuTopology(const char *sysfsRoot = "/sys");
+      virtual ~CpuTopology() {};
+      int scan();
+      int refresh();
+      int capMaxFreq(unsigned int percent);
+      unsigned int capPercent() const { return mCapPercent; };
+      /* copies, a hotplug rescan replaces the model under the caller */
+      std::vector<CpufreqPolicy> policies() const;
+      CpuSet possibleCpus() const;
+      CpuSet onlineCpus() const;
+
+  private:
+      std::string mCpuRoot;
+      std::string mDevicesRoot;
+      CpuSet mPossible;
+      CpuSet mOnline;
+      std::vector<CpufreqPolicy> mPolicies;
+      unsigned int mCapPercent;
+      mutable pthread_mutex_t mLock;
+
+      int readCpuList(const std::string &path, CpuSet &cpus);
+      void addPolicy(const std::string &path);
+      void detectCoreTypes();
+      void updateOnline();
+      int applyCap();
+};
+#endif  // ANDROID_CPU_TOPOLOGY_H
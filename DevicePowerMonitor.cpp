@@ -18,96 +18,447 @@
 
 #include "DevicePowerMonitor.h"
 
+#include <algorithm>
+
 #include <cutils/log.h>
+#include <cutils/properties.h>
 #include <errno.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#include "PropertyCache.h"
+#include "SysfsIo.h"
 
 static const char* HAL_DIR = "/sys/power/power_HAL_suspend";
 static const char* DEVICE_CONTROL_FILE = "power_HAL_suspend";
+static const char* DEVICE_CONFIG_FILE = "/vendor/etc/powerhal_devices.conf";
+static const char* DEVICE_PARALLEL_PROPERTY = "vendor.powerhal.device_parallel";
+static CachedProperty parallelProperty(DEVICE_PARALLEL_PROPERTY, "1");
 
-void DevicePowerMonitor::scanPaths()
+#define MAX_POWER_WORKERS 4
+
+/* quiet time after a uevent before the device set is rescanned */
+#define RESCAN_DELAY_MS 100
+/* retries for a new device whose control file is not there yet */
+#define MAX_ADD_RETRIES 10
+
+struct DeviceJob {
+    PowerDevice *device;
+    const char *value;
+    int err;
+    int64_t ns;
+};
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void device_write(void *arg)
+{
+    DeviceJob *job = (DeviceJob *) arg;
+    int64_t start = now_ns();
+
+    /* let the device finish what it is doing before it goes down */
+    if (job->device->suspendDelayMs && job->value[0] == '1')
+        usleep(job->device->suspendDelayMs * 1000);
+
+    job->err = 0;
+    if (SysfsIo::pwrite(job->device->fd, job->value, 1, 0, job->device->path.c_str()) < 0)
+        job->err = errno;
+    job->ns = now_ns() - start;
+}
+
+static bool node_gone(int err)
+{
+    return err == ENOENT || err == ENODEV || err == ESTALE;
+}
+
+DevicePowerMonitor::DevicePowerMonitor():
+    mDevices(), mPolicy(DEVICE_CONFIG_FILE), mScanNeeded(true), mParallel(true),
+    mPool(MAX_POWER_WORKERS - 1), mPoolStarted(false),
+    mWatchFd(-1), mUeventFd(-1), mWatching(false), mWatchStarted(false),
+    mRescanPending(false), mPending()
+{
+    pthread_mutex_init(&mLock, NULL);
+}
+
+DevicePowerMonitor::~DevicePowerMonitor()
+{
+    cleanPaths();
+}
+
+void DevicePowerMonitor::cleanPaths()
+{
+    for (size_t i = 0; i < mDevices.size(); i++) {
+        if (mDevices[i].fd >= 0)
+            close(mDevices[i].fd);
+    }
+    mDevices.clear();
+}
+
+void DevicePowerMonitor::loadConfig()
+{
+    mPolicy.load();
+    mParallel = parallelProperty.intValue() != 0;
+}
+
+/* Opens and records one device directory; false if it cannot be used (yet). */
+bool DevicePowerMonitor::addDevice(const char *name)
 {
     char deviceNamePath[PATH_MAX];
+
+    if(name[0] == '.')
+        return true;
+
+    for (size_t i = 0; i < mDevices.size(); i++) {
+        if (mDevices[i].name == name)
+            return true;
+    }
+
+    struct DevicePolicy policy;
+    mPolicy.lookup(name, &policy);
+    if(policy.skip){
+        ALOGD("Found device: %s in blacklist", name);
+        return true;
+    }
+
+    snprintf(deviceNamePath, sizeof(deviceNamePath), "%s/%s/%s", HAL_DIR, name, DEVICE_CONTROL_FILE);
+    int fd = SysfsIo::open(deviceNamePath, O_WRONLY | O_CLOEXEC);
+    if(fd < 0){
+        ALOGE("Could not open file '%s': %s", deviceNamePath, strerror(errno));
+        return false;
+    }
+
+    /* keep the node open, setState() only has to write to it */
+    PowerDevice device;
+    device.name = name;
+    device.path = deviceNamePath;
+    device.fd = fd;
+    device.order = policy.order;
+    device.suspendDelayMs = policy.suspendDelayMs;
+    mDevices.push_back(device);
+    return true;
+}
+
+void DevicePowerMonitor::removeDevice(const char *name)
+{
+    for (size_t i = 0; i < mDevices.size(); i++) {
+        if (mDevices[i].name == name) {
+            close(mDevices[i].fd);
+            mDevices.erase(mDevices.begin() + i);
+            return;
+        }
+    }
+}
+
+void DevicePowerMonitor::scanPaths()
+{
     DIR *dir;
     struct dirent *de;
-    int cnt = 0;
 
     if(!mScanNeeded)
         return;
 
-    mDevicePaths.erase(mDevicePaths.begin(), mDevicePaths.end());
-    dir = opendir(HAL_DIR);
+    loadConfig();
+    cleanPaths();
+    dir = SysfsIo::opendir(HAL_DIR);
     if(dir == NULL){
         ALOGE("Could not open directory '%s': %s", HAL_DIR, strerror(errno));
         return;
     }
     while((de = readdir(dir))) {
-        if(de->d_name[0] == '.')
-            continue;
+        addDevice(de->d_name);
+    }
+    /* with a live watch an empty directory is not worth rescanning */
+    if(mDevices.size() > 0 || mWatching){
+        mScanNeeded = false;
+    }
 
-        snprintf(deviceNamePath, sizeof(deviceNamePath), "%s/%s/%s", HAL_DIR, de->d_name, DEVICE_CONTROL_FILE);
-        int fd = ::open(deviceNamePath, O_WRONLY);
-        if(fd < 0){
-            ALOGE("Could not open file '%s': %s", deviceNamePath, strerror(errno));
-            continue;
+    closedir(dir);
+}
+
+/*
+ * Keeps the device set current from a background thread, so setState()
+ * never has to rescan. inotify reports directories created or removed
+ * from userspace; sysfs does not report kernel-side changes that way, so
+ * the uevents of the devices concerned add or drop them as well.
+ */
+int DevicePowerMonitor::startWatch()
+{
+    struct sockaddr_nl addr;
+    pthread_t thread;
+
+    mWatchStarted = true;
+
+    mWatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mWatchFd >= 0 &&
+        SysfsIo::addWatch(mWatchFd, HAL_DIR, IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                          IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR) < 0) {
+        ALOGW("Could not watch '%s': %s", HAL_DIR, strerror(errno));
+        close(mWatchFd);
+        mWatchFd = -1;
+    }
+
+    mUeventFd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (mUeventFd >= 0) {
+        memset(&addr, 0, sizeof(addr));
+        addr.nl_family = AF_NETLINK;
+        addr.nl_groups = 1;
+        if (bind(mUeventFd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+            ALOGW("Could not bind uevent socket: %s", strerror(errno));
+            close(mUeventFd);
+            mUeventFd = -1;
         }
-        close(fd);
-
-        bool blacklist = false;
-        unsigned int i;
-        for(i = 0;  i < DevicePowerMonitorInfo::numDev; i++){
-            if(!strncmp(DevicePowerMonitorInfo::deviceBlackList[i], de->d_name,
-	       strlen(DevicePowerMonitorInfo::deviceBlackList[i]))){
-                ALOGD("Found device: %s in blacklist", de->d_name);
-                blacklist = true;
-                break;
+    }
+
+    if (mWatchFd < 0 && mUeventFd < 0)
+        return -1;
+
+    if (pthread_create(&thread, NULL, watchLoop, this)) {
+        ALOGE("%s: could not create watch thread", __func__);
+        return -1;
+    }
+    pthread_setname_np(thread, "powerhal_devwatch");
+
+    mWatching = true;
+    return 0;
+}
+
+/* Called with mLock held */
+void DevicePowerMonitor::handleInotify()
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *event;
+    ssize_t len;
+
+    while ((len = read(mWatchFd, buf, sizeof(buf))) > 0) {
+        for (char *ptr = buf; ptr < buf + len; ptr += sizeof(*event) + event->len) {
+            event = (const struct inotify_event *) ptr;
+
+            if (event->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                mRescanPending = true;
+            } else if (event->len && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+                if (!addDevice(event->name))
+                    mPending.push_back(std::make_pair(std::string(event->name), 0));
+            } else if (event->len && (event->mask & (IN_DELETE | IN_MOVED_FROM))) {
+                removeDevice(event->name);
             }
         }
+    }
+}
+
+/*
+ * Called with mLock held. Only uevents about a device with an entry in the
+ * HAL directory matter, and the entry carries the device's name: the last
+ * DEVPATH component. A driver adds the entry on probe, so it is looked for
+ * on add and on bind; a removal is matched against the known devices.
+ */
+void DevicePowerMonitor::handleUevent()
+{
+    char buf[2048];
+    char path[PATH_MAX];
+    const char *name;
+    ssize_t len;
+    bool added;
 
-        if(!blacklist){
-            snprintf(deviceNamePath, sizeof(deviceNamePath), "%s/%s/%s", HAL_DIR, de->d_name, DEVICE_CONTROL_FILE);
-            mDevicePaths.push_back(deviceNamePath);
+    while ((len = recv(mUeventFd, buf, sizeof(buf) - 1, 0)) > 0) {
+        buf[len] = '\0';
+        /* "action@devpath", then the environment */
+        name = strrchr(buf, '/');
+        if (name == NULL || strchr(buf, '@') == NULL)
+            continue;
+        name++;
+
+        added = !strncmp(buf, "add@", 4) || !strncmp(buf, "bind@", 5);
+        if (added) {
+            snprintf(path, sizeof(path), "%s/%s", HAL_DIR, name);
+            if (SysfsIo::access(path, F_OK))
+                continue;
+            if (!addDevice(name))
+                mPending.push_back(std::make_pair(std::string(name), 0));
+        } else if (!strncmp(buf, "remove@", 7) || !strncmp(buf, "unbind@", 7)) {
+            removeDevice(name);
         }
     }
-    if(mDevicePaths.size() > 0){
-        mScanNeeded = false;
+}
+
+void *DevicePowerMonitor::watchLoop(void *arg)
+{
+    DevicePowerMonitor *self = (DevicePowerMonitor *) arg;
+    struct pollfd fds[2];
+    int timeout;
+
+    fds[0].fd = self->mWatchFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = self->mUeventFd;
+    fds[1].events = POLLIN;
+
+    while (1) {
+        pthread_mutex_lock(&self->mLock);
+        timeout = self->mRescanPending || !self->mPending.empty() ? RESCAN_DELAY_MS : -1;
+        pthread_mutex_unlock(&self->mLock);
+
+        int ret = poll(fds, 2, timeout);
+        if (ret < 0 && errno != EINTR) {
+            ALOGE("%s: poll failed: %s", __func__, strerror(errno));
+            break;
+        }
+
+        pthread_mutex_lock(&self->mLock);
+        if (ret > 0) {
+            if (fds[0].revents & POLLIN)
+                self->handleInotify();
+            if (fds[1].revents & POLLIN)
+                self->handleUevent();
+        } else if (ret == 0) {
+            /* things settled down */
+            if (self->mRescanPending) {
+                self->mRescanPending = false;
+                self->mPending.clear();
+                self->mScanNeeded = true;
+                self->scanPaths();
+                if (self->mWatchFd >= 0)
+                    SysfsIo::addWatch(self->mWatchFd, HAL_DIR, IN_CREATE | IN_DELETE |
+                                      IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF |
+                                      IN_MOVE_SELF | IN_ONLYDIR);
+            }
+            for (size_t i = 0; i < self->mPending.size(); ) {
+                if (self->addDevice(self->mPending[i].first.c_str()) ||
+                    ++self->mPending[i].second >= MAX_ADD_RETRIES)
+                    self->mPending.erase(self->mPending.begin() + i);
+                else
+                    i++;
+            }
+        }
+        pthread_mutex_unlock(&self->mLock);
     }
 
-    closedir(dir);
+    /* fall back to scanning from setState() */
+    pthread_mutex_lock(&self->mLock);
+    self->mWatching = false;
+    pthread_mutex_unlock(&self->mLock);
+    return NULL;
 }
 
-void DevicePowerMonitor::setState(int state)
+/*
+ * Writes the value to every device, one order group after the other.
+ * Devices within a group are written in parallel so a group takes as long
+ * as its slowest device. Returns false if a node has gone away.
+ */
+bool DevicePowerMonitor::writeAll(const char *value, bool resume)
 {
-    unsigned int quitLoop = 0;
-    ssize_t ret = 0;
-    scanPaths();
-    std::vector<std::string>::iterator it=mDevicePaths.begin();
-    while(it != mDevicePaths.end())
-    {
-        int fd = ::open((char*) it->c_str(), O_WRONLY);
-        if(fd < 0){
-            ALOGE("Could not open the file:%s", (char*) it->c_str());
-            /*
-                We might have issue that the kernel removed the node so we need to re-scan.
-                However if we have permission problem we do not want to be stuck forever in this loop
-            */
-            mScanNeeded = true;
-            scanPaths();
-            it = mDevicePaths.begin();
-            if(quitLoop++ > 0)
-                break;
-            continue;
+    std::vector<DeviceJob> jobs(mDevices.size());
+    std::vector<void *> args;
+    std::vector<int> orders;
+    int64_t start = now_ns();
+    bool gone = false;
+
+    for (size_t i = 0; i < mDevices.size(); i++) {
+        jobs[i].device = &mDevices[i];
+        jobs[i].value = value;
+        jobs[i].err = 0;
+        jobs[i].ns = 0;
+        orders.push_back(mDevices[i].order);
+    }
+    std::sort(orders.begin(), orders.end());
+    orders.erase(std::unique(orders.begin(), orders.end()), orders.end());
+    if (!resume)
+        std::reverse(orders.begin(), orders.end());
+
+    for (size_t step = 0; step < orders.size(); step++) {
+        int order = orders[step];
+
+        args.clear();
+        for (size_t i = 0; i < jobs.size(); i++) {
+            if (jobs[i].device->order == order)
+                args.push_back(&jobs[i]);
         }
 
-        if(state){
-            ret = write(fd, "0", 1);
+        if (mParallel && mPoolStarted && args.size() > 1) {
+            mPool.run(device_write, args.data(), args.size());
+        } else {
+            for (size_t i = 0; i < args.size(); i++)
+                device_write(args[i]);
         }
-        else{
-            ret = write(fd, "1", 1);
+    }
+
+    std::vector<std::string> removed;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (jobs[i].err) {
+            ALOGE("Error when trying to write to %s errno:%d", jobs[i].device->path.c_str(), jobs[i].err);
+            if (node_gone(jobs[i].err)) {
+                gone = true;
+                removed.push_back(jobs[i].device->name);
+            }
         }
-        if (ret < 0)
-            ALOGE("Error when trying to write to the file errno:%d", errno);
-        close(fd);
-        it++;
+        ALOGD("%s %s took %lld us", resume ? "resume" : "suspend",
+              jobs[i].device->name.c_str(), (long long)(jobs[i].ns / 1000));
+    }
+    ALOGD("%s of %zu devices took %lld us", resume ? "resume" : "suspend",
+          jobs.size(), (long long)((now_ns() - start) / 1000));
+
+    /* with a live watch the node just went away; forget it, nothing to rescan */
+    if (mWatching) {
+        for (size_t i = 0; i < removed.size(); i++)
+            removeDevice(removed[i].c_str());
+        return true;
+    }
+
+    return !gone;
+}
+
+size_t DevicePowerMonitor::devices()
+{
+    size_t count;
+
+    pthread_mutex_lock(&mLock);
+    count = mDevices.size();
+    pthread_mutex_unlock(&mLock);
+    return count;
+}
+
+/* Forgets the device list and reads the HAL directory again */
+size_t DevicePowerMonitor::rescan()
+{
+    size_t count;
+
+    pthread_mutex_lock(&mLock);
+    mScanNeeded = true;
+    scanPaths();
+    count = mDevices.size();
+    pthread_mutex_unlock(&mLock);
+    return count;
+}
+
+void DevicePowerMonitor::setState(int state)
+{
+    const char *value = state ? "0" : "1";
+
+    pthread_mutex_lock(&mLock);
+    if (!mWatchStarted)
+        startWatch();
+    /* the policy may have been retuned since the last transition */
+    if (!mScanNeeded && mPolicy.changed())
+        mScanNeeded = true;
+    scanPaths();
+    if (mParallel && !mPoolStarted && mDevices.size() > 1)
+        mPoolStarted = mPool.start() == 0;
 
+    if (!writeAll(value, state)) {
+        /*
+            We might have issue that the kernel removed the node so we need to re-scan.
+            However if we have permission problem we do not want to be stuck forever in this loop
+        */
+        mScanNeeded = true;
+        scanPaths();
+        writeAll(value, state);
     }
+    pthread_mutex_unlock(&mLock);
 }
@@ -23,15 +23,27 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdint.h>
+#include <utility>
 #include <vector>
 
 #include "DevicePowerMonitorInfo.h"
+#include "WorkerPool.h"
 
 #define DEVICE_NAME_MAX 256
 
 struct sensors_event_t;
 
+struct PowerDevice {
+    std::string name;
+    std::string path;
+    int fd;
+    /* devices with a lower order resume first and suspend last */
+    int order;
+    unsigned int suspendDelayMs;
+};
+
 /**
  * The class is used to remove/add input i2c devices through input sysfs system
  * so the devices would power down correctly
@@ -39,16 +51,37 @@ struct sensors_event_t;
 class DevicePowerMonitor {
 
   private:
-      std::vector<std::string> mDevicePaths;
+      std::vector<PowerDevice> mDevices;
+      DevicePolicyTable mPolicy;
       bool mScanNeeded;
+      bool mParallel;
+      WorkerPool mPool;
+      bool mPoolStarted;
+      pthread_mutex_t mLock;
+      int mWatchFd;
+      int mUeventFd;
+      bool mWatching;
+      bool mWatchStarted;
+      bool mRescanPending;
+      /* new devices whose control file did not exist yet, with retry count */
+      std::vector<std::pair<std::string, int> > mPending;
       void cleanPaths();
       void scanPaths();
+      bool addDevice(const char *name);
+      void removeDevice(const char *name);
+      int startWatch();
+      void handleInotify();
+      void handleUevent();
+      static void *watchLoop(void *arg);
+      void loadConfig();
+      bool writeAll(const char *value, bool resume);
 
   public:
-      DevicePowerMonitor():
-          mDevicePaths(),mScanNeeded(true){};
-      virtual ~DevicePowerMonitor(){};
+      DevicePowerMonitor();
+      virtual ~DevicePowerMonitor();
       void setState(int state);
+      size_t rescan();
+      size_t devices();
 
 };
 #endif  // ANDROID_I2C_POWER_MONITOR_H
@@ -14,11 +14,210 @@
  * limitations under the License.
  */
 
+#define LOG_TAG "PowerHAL"
+
 #include "DevicePowerMonitorInfo.h"
 
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <cutils/log.h>
+#include <cutils/properties.h>
+
+#include "PropertyCache.h"
+#include "SysfsIo.h"
+
 const char* DevicePowerMonitorInfo::deviceBlackList[] = {
     "0000:00:02.0" /* i915 to blacklist */
 };
 
 const unsigned int DevicePowerMonitorInfo::numDev = \
 	sizeof(DevicePowerMonitorInfo::deviceBlackList) / sizeof(char *);
+
+/* comma separated device name prefixes to leave alone */
+static const char* DEVICE_BLACKLIST_PROPERTY = "vendor.powerhal.device_blacklist";
+/* comma separated device name prefixes, in resume order */
+static const char* DEVICE_ORDER_PROPERTY = "vendor.powerhal.device_order";
+static CachedProperty blacklistProperty(DEVICE_BLACKLIST_PROPERTY);
+static CachedProperty orderProperty(DEVICE_ORDER_PROPERTY);
+
+DevicePolicyTable::DevicePolicyTable(const char *configPath):
+    mConfigPath(configPath)
+{
+    mConfigMtime.tv_sec = 0;
+    mConfigMtime.tv_nsec = 0;
+    clear();
+}
+
+void DevicePolicyTable::clear()
+{
+    TrieNode root;
+
+    root.policy = -1;
+    mNodes.clear();
+    mNodes.push_back(root);
+    mPolicies.clear();
+}
+
+static bool child_less(const std::pair<char, int> &a, char c)
+{
+    return a.first < c;
+}
+
+/* Returns the policy slot for a prefix, creating it with defaults if needed */
+DevicePolicy *DevicePolicyTable::insert(const char *prefix, size_t len)
+{
+    int node = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        std::vector<std::pair<char, int> > &children = mNodes[node].children;
+        std::vector<std::pair<char, int> >::iterator it =
+            std::lower_bound(children.begin(), children.end(), prefix[i], child_less);
+
+        if (it != children.end() && it->first == prefix[i]) {
+            node = it->second;
+            continue;
+        }
+
+        TrieNode child;
+        child.policy = -1;
+        int index = mNodes.size();
+        children.insert(it, std::make_pair(prefix[i], index));
+        mNodes.push_back(child);
+        node = index;
+    }
+
+    if (mNodes[node].policy < 0) {
+        DevicePolicy policy = { false, DEVICE_ORDER_LAST, 0 };
+        mNodes[node].policy = mPolicies.size();
+        mPolicies.push_back(policy);
+    }
+    return &mPolicies[mNodes[node].policy];
+}
+
+void DevicePolicyTable::lookup(const char *name, struct DevicePolicy *policy) const
+{
+    int node = 0;
+    int match = mNodes[0].policy;
+
+    for (const char *p = name; *p; p++) {
+        const std::vector<std::pair<char, int> > &children = mNodes[node].children;
+        std::vector<std::pair<char, int> >::const_iterator it =
+            std::lower_bound(children.begin(), children.end(), *p, child_less);
+
+        if (it == children.end() || it->first != *p)
+            break;
+        node = it->second;
+        if (mNodes[node].policy >= 0)
+            match = mNodes[node].policy;
+    }
+
+    if (match >= 0) {
+        *policy = mPolicies[match];
+    } else {
+        policy->skip = false;
+        policy->order = DEVICE_ORDER_LAST;
+        policy->suspendDelayMs = 0;
+    }
+}
+
+void DevicePolicyTable::loadConfig()
+{
+    char line[256];
+    char *token, *next;
+    FILE *file;
+    int count = 0;
+
+    file = SysfsIo::fopen(mConfigPath.c_str(), "re");
+    if (file == NULL)
+        return;
+
+    while (fgets(line, sizeof(line), file)) {
+        char *hash = strchr(line, '#');
+        if (hash)
+            *hash = '\0';
+
+        token = strtok_r(line, " \t\r\n", &next);
+        if (token == NULL)
+            continue;
+
+        DevicePolicy *policy = insert(token, strlen(token));
+        while ((token = strtok_r(NULL, " \t\r\n", &next))) {
+            if (!strcmp(token, "skip"))
+                policy->skip = true;
+            else if (!strncmp(token, "order=", 6))
+                policy->order = atoi(token + 6);
+            else if (!strncmp(token, "delay_ms=", 9))
+                policy->suspendDelayMs = atoi(token + 9);
+            else
+                ALOGW("%s: unknown device policy '%s'", mConfigPath.c_str(), token);
+        }
+        count++;
+    }
+    fclose(file);
+
+    ALOGI("loaded %d device policies from %s", count, mConfigPath.c_str());
+}
+
+void DevicePolicyTable::loadProperties()
+{
+    char value[PROPERTY_VALUE_MAX];
+    char *token, *next;
+    int order = 0;
+
+    if (blacklistProperty.isSet()) {
+        snprintf(value, sizeof(value), "%s", blacklistProperty.value().c_str());
+        for (token = strtok_r(value, ",", &next); token; token = strtok_r(NULL, ",", &next))
+            insert(token, strlen(token))->skip = true;
+    }
+
+    if (orderProperty.isSet()) {
+        snprintf(value, sizeof(value), "%s", orderProperty.value().c_str());
+        for (token = strtok_r(value, ",", &next); token; token = strtok_r(NULL, ",", &next))
+            insert(token, strlen(token))->order = order++;
+    }
+}
+
+std::string DevicePolicyTable::readProperties()
+{
+    return blacklistProperty.value() + ';' + orderProperty.value();
+}
+
+int DevicePolicyTable::load()
+{
+    struct stat st;
+
+    clear();
+    for (unsigned int i = 0; i < DevicePowerMonitorInfo::numDev; i++) {
+        const char *prefix = DevicePowerMonitorInfo::deviceBlackList[i];
+        insert(prefix, strlen(prefix))->skip = true;
+    }
+
+    if (SysfsIo::stat(mConfigPath.c_str(), &st) == 0)
+        mConfigMtime = st.st_mtim;
+    else
+        mConfigMtime.tv_sec = mConfigMtime.tv_nsec = 0;
+    loadConfig();
+
+    mProperties = readProperties();
+    loadProperties();
+    return 0;
+}
+
+/* Cheap check whether a load() would give a different table */
+bool DevicePolicyTable::changed()
+{
+    struct timespec mtime = { 0, 0 };
+    struct stat st;
+
+    if (SysfsIo::stat(mConfigPath.c_str(), &st) == 0)
+        mtime = st.st_mtim;
+    if (mtime.tv_sec != mConfigMtime.tv_sec || mtime.tv_nsec != mConfigMtime.tv_nsec)
+        return true;
+
+    return readProperties() != mProperties;
+}
@@ -17,6 +17,12 @@
 #ifndef ANDROID_DEVICE_POWER_MONITOR_INFO_H
 #define ANDROID_DEVICE_POWER_MONITOR_INFO_H
 
+#include <string>
+#include <vector>
+
+#include <limits.h>
+#include <time.h>
+
 class DevicePowerMonitorInfo {
 private:
     DevicePowerMonitorInfo() {};
@@ -25,4 +31,52 @@ public:
     static const unsigned int numDev;
     static const char* deviceBlackList[];
 };
+
+struct DevicePolicy {
+    bool skip;
+    /* devices with a lower order resume first and suspend last */
+    int order;
+    unsigned int suspendDelayMs;
+};
+
+#define DEVICE_ORDER_LAST INT_MAX
+
+/**
+ * Per-device policy keyed by device name prefix, compiled into a trie so a
+ * lookup costs one step per character of the name. The longest matching
+ * prefix wins. Sources, later ones overriding earlier ones:
+ *   - the built-in DevicePowerMonitorInfo::deviceBlackList
+ *   - the vendor config file, one "prefix [skip] [order=N] [delay_ms=N]"
+ *     entry per line
+ *   - the blacklist and resume order properties
+ */
+class DevicePolicyTable {
+
+  public:
+      DevicePolicyTable(const char *configPath);
+      virtual ~DevicePolicyTable() {};
+      int load();
+      bool changed();
+      void lookup(const char *name, struct DevicePolicy *policy) const;
+      size_t size() const { return mPolicies.size(); };
+
+  private:
+      struct TrieNode {
+          /* sorted by character */
+          std::vector<std::pair<char, int> > children;
+          int policy;
+      };
+
+      std::string mConfigPath;
+      struct timespec mConfigMtime;
+      std::string mProperties;
+      std::vector<TrieNode> mNodes;
+      std::vector<DevicePolicy> mPolicies;
+
+      void clear();
+      DevicePolicy *insert(const char *prefix, size_t len);
+      void loadConfig();
+      void loadProperties();
+      std::string readProperties();
+};
 #endif //ANDROID_I2C_DEVICE_POWER_MONITOR_INFO
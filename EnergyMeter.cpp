@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "EnergyMeter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+#include "BoostArbiter.h"
+#include "PowerStats.h"
+#include "SysfsIo.h"
+
+#define ENERGY_STATES (1 << CLIENT_COUNT)
+/* Hints as PowerStats counts them, and one slot for no recent hint */
+#define HINT_NONE STATS_HINT_COUNT
+#define ENERGY_HINT_SLOTS (STATS_HINT_COUNT + 1)
+
+struct EnergyZone {
+    std::string label;          /* package-0, core-0, uncore-0, ... */
+    std::string path;           /* its energy_uj */
+    int fd;
+    uint64_t rangeUj;           /* max_energy_range_uj, 0 if unknown */
+    uint64_t lastUj;
+};
+
+/* Allocated by init() and kept for the life of the process, or until reset() */
+struct Meter {
+    std::vector<EnergyZone> zones;
+    pthread_mutex_t lock;
+    unsigned int clients;
+    int hint;
+    int64_t hintEndNs;          /* dispatch thread only */
+    int64_t hintStartNs;        /* when the time of hint was last closed */
+    int64_t hintPendingNs[ENERGY_HINT_SLOTS];  /* held since the last read */
+    std::atomic<int64_t> lastNs;
+    uint64_t stateUj[ENERGY_STATES][ENERGY_MAX_ZONES];
+    int64_t stateNs[ENERGY_STATES];
+    uint64_t hintUj[ENERGY_HINT_SLOTS][ENERGY_MAX_ZONES];
+    int64_t hintNs[ENERGY_HINT_SLOTS];
+};
+
+static std::atomic<Meter *> meter(NULL);
+
+static const char *client_names[CLIENT_COUNT] = {
+    "touch",
+    "interactive",
+    "launch",
+    "low_power",
+    "sustained",
+    "gpu_throttle",
+};
+
+static int read_u64(int fd, const char *path, uint64_t *value)
+{
+    char buf[32];
+    char *end;
+    ssize_t len;
+
+    len = SysfsIo::pread(fd, buf, sizeof(buf) - 1, 0, path);
+    if (len <= 0)
+        return -1;
+    buf[len] = '\0';
+    errno = 0;
+    *value = strtoull(buf, &end, 10);
+    if (errno || end == buf)
+        return -1;
+    return 0;
+}
+
+static int read_file(const std::string &path, char *buf, size_t size)
+{
+    int fd = SysfsIo::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    ssize_t len;
+
+    if (fd < 0)
+        return -1;
+    len = SysfsIo::pread(fd, buf, size - 1, 0, path.c_str());
+    close(fd);
+    if (len <= 0)
+        return -1;
+    buf[len] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+/*
+ * A zone directory is intel-rapl:<package> or intel-rapl:<package>:<sub>;
+ * subzones are labelled with their package so two sockets stay apart.
+ */
+static int add_zone(Meter *m, const std::string &root, const char *dir)
+{
+    std::string base = root + "/" + dir;
+    const char *package = dir + strlen("intel-rapl:");
+    char name[32];
+    char range[32];
+    char buf[80];
+    EnergyZone zone;
+
+    if (read_file(base + "/name", name, sizeof(name)))
+        return -1;
+    zone.label = name;
+    if (strchr(package, ':') != NULL)
+        zone.label += "-" + std::string(package, strcspn(package, ":"));
+    zone.path = base + "/energy_uj";
+    zone.rangeUj = 0;
+    if (read_file(base + "/max_energy_range_uj", range, sizeof(range)) == 0)
+        zone.rangeUj = strtoull(range, NULL, 10);
+
+    /* energy_uj is root only on newer kernels */
+    zone.fd = SysfsIo::open(zone.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (zone.fd < 0 || read_u64(zone.fd, zone.path.c_str(), &zone.lastUj)) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGW("%s: cannot read %s: %s", __func__, zone.path.c_str(), buf);
+        if (zone.fd >= 0)
+            close(zone.fd);
+        return -1;
+    }
+    m->zones.push_back(zone);
+    return 0;
+}
+
+/* Adds the time since the last close to the current hint; lock held */
+static void close_hint(Meter *m, int64_t now)
+{
+    if (now > m->hintStartNs)
+        m->hintPendingNs[m->hint] += now - m->hintStartNs;
+    m->hintStartNs = now;
+}
+
+/*
+ * Charges the energy since the last read to the clients active until now,
+ * and to the hints in proportion to their time since then. A counter that
+ * is lower than last time has wrapped: it counts up to rangeUj inclusive
+ * and goes on from 0. Called with the meter lock held.
+ */
+static void sample(Meter *m, int64_t now)
+{
+    int64_t ns = now - m->lastNs.load(std::memory_order_relaxed);
+    int64_t hintNs = 0;
+
+    close_hint(m, now);
+    for (int slot = 0; slot < ENERGY_HINT_SLOTS; slot++)
+        hintNs += m->hintPendingNs[slot];
+
+    for (size_t i = 0; i < m->zones.size(); i++) {
+        EnergyZone &zone = m->zones[i];
+        uint64_t uj, delta;
+
+        if (read_u64(zone.fd, zone.path.c_str(), &uj))
+            continue;
+        if (uj >= zone.lastUj)
+            delta = uj - zone.lastUj;
+        else if (zone.rangeUj >= zone.lastUj)
+            delta = zone.rangeUj - zone.lastUj + uj + 1;
+        else
+            delta = 0;
+        zone.lastUj = uj;
+        m->stateUj[m->clients][i] += delta;
+        for (int slot = 0; slot < ENERGY_HINT_SLOTS && hintNs > 0; slot++)
+            m->hintUj[slot][i] += (uint64_t)((double)delta * m->hintPendingNs[slot] / hintNs);
+    }
+    m->stateNs[m->clients] += ns;
+    for (int slot = 0; slot < ENERGY_HINT_SLOTS; slot++) {
+        m->hintNs[slot] += m->hintPendingNs[slot];
+        m->hintPendingNs[slot] = 0;
+    }
+    m->lastNs.store(now, std::memory_order_relaxed);
+}
+
+int EnergyMeter::init(const char *root)
+{
+    std::vector<std::string> dirs;
+    Meter *m;
+    DIR *dir;
+    struct dirent *de;
+
+    if (meter.load(std::memory_order_acquire) != NULL)
+        return 0;
+
+    dir = SysfsIo::opendir(root);
+    if (dir == NULL)
+        return -1;
+    while ((de = readdir(dir))) {
+        if (!strncmp(de->d_name, "intel-rapl:", strlen("intel-rapl:")))
+            dirs.push_back(de->d_name);
+    }
+    closedir(dir);
+    std::sort(dirs.begin(), dirs.end());
+
+    m = new Meter();
+    for (size_t i = 0; i < dirs.size() && m->zones.size() < ENERGY_MAX_ZONES; i++)
+        add_zone(m, root, dirs[i].c_str());
+    if (m->zones.empty()) {
+        delete m;
+        return -1;
+    }
+
+    pthread_mutex_init(&m->lock, NULL);
+    m->clients = 0;
+    m->hint = HINT_NONE;
+    m->hintEndNs = 0;
+    m->hintStartNs = PowerStats::now();
+    m->lastNs.store(m->hintStartNs, std::memory_order_relaxed);
+    meter.store(m, std::memory_order_release);
+    ALOGI("energy meter: %zu rapl zones", m->zones.size());
+    return 0;
+}
+
+void EnergyMeter::setClients(unsigned int clients)
+{
+    Meter *m = meter.load(std::memory_order_acquire);
+
+    if (m == NULL)
+        return;
+    pthread_mutex_lock(&m->lock);
+    if (clients != m->clients) {
+        sample(m, PowerStats::now());
+        m->clients = clients % ENERGY_STATES;
+    }
+    pthread_mutex_unlock(&m->lock);
+}
+
+/* Internal hints, below zero, are not the framework's and are not charged */
+void EnergyMeter::setHint(int hint, int64_t nowNs)
+{
+    Meter *m = meter.load(std::memory_order_acquire);
+    int slot = hint < STATS_HINT_COUNT ? hint : STATS_HINT_COUNT - 1;
+
+    if (m == NULL || hint < 0)
+        return;
+    m->hintEndNs = nowNs + ENERGY_HINT_WINDOW_MS * 1000000LL;
+    if (slot == m->hint)
+        return;
+
+    pthread_mutex_lock(&m->lock);
+    close_hint(m, nowNs);
+    m->hint = slot;
+    pthread_mutex_unlock(&m->lock);
+}
+
+/* Returns the ns until the meter wants to be polled again */
+int64_t EnergyMeter::poll(int64_t nowNs)
+{
+    Meter *m = meter.load(std::memory_order_acquire);
+    int64_t next;
+
+    if (m == NULL)
+        return -1;
+
+    if (m->hint != HINT_NONE && nowNs >= m->hintEndNs) {
+        pthread_mutex_lock(&m->lock);
+        close_hint(m, m->hintEndNs);
+        m->hint = HINT_NONE;
+        pthread_mutex_unlock(&m->lock);
+    }
+    if (nowNs - m->lastNs.load(std::memory_order_relaxed) >= ENERGY_POLL_MS * 1000000LL) {
+        pthread_mutex_lock(&m->lock);
+        sample(m, nowNs);
+        pthread_mutex_unlock(&m->lock);
+    }
+
+    next = m->lastNs.load(std::memory_order_relaxed) + ENERGY_POLL_MS * 1000000LL - nowNs;
+    if (m->hint != HINT_NONE)
+        next = std::min(next, m->hintEndNs - nowNs);
+    return std::max(next, (int64_t)0);
+}
+
+uint64_t EnergyMeter::stateUj(unsigned int clients, size_t zone)
+{
+    Meter *m = meter.load(std::memory_order_acquire);
+    uint64_t uj;
+
+    if (m == NULL || zone >= m->zones.size())
+        return 0;
+    pthread_mutex_lock(&m->lock);
+    sample(m, PowerStats::now());
+    uj = m->stateUj[clients % ENERGY_STATES][zone];
+    pthread_mutex_unlock(&m->lock);
+    return uj;
+}
+
+/* Nothing else may be using the meter */
+void EnergyMeter::reset()
+{
+    Meter *m = meter.exchange(NULL, std::memory_order_acq_rel);
+
+    if (m == NULL)
+        return;
+    for (size_t i = 0; i < m->zones.size(); i++)
+        close(m->zones[i].fd);
+    pthread_mutex_destroy(&m->lock);
+    delete m;
+}
+
+static std::string clients_label(unsigned int clients)
+{
+    std::string label;
+
+    if (clients == 0)
+        return "none";
+    for (int i = 0; i < CLIENT_COUNT; i++) {
+        if (!(clients & (1u << i)))
+            continue;
+        if (!label.empty())
+            label += "+";
+        label += client_names[i];
+    }
+    return label;
+}
+
+/* Joules per zone and the mean power of the first, usually the package */
+static void dump_row(int fd, const char *label, const Meter *m, const uint64_t *uj, int64_t ns)
+{
+    if (ns <= 0)
+        return;
+    dprintf(fd, "  %-40s %10.3f", label, ns / 1e9);
+    for (size_t i = 0; i < m->zones.size(); i++)
+        dprintf(fd, " %12.3f", uj[i] / 1e6);
+    dprintf(fd, " %8.3f\n", uj[0] / 1e3 / (ns / 1e6));
+}
+
+static void dump_header(int fd, const char *title, const Meter *m)
+{
+    dprintf(fd, "%-42s %10s", title, "time s");
+    for (size_t i = 0; i < m->zones.size(); i++)
+        dprintf(fd, " %10s J", m->zones[i].label.c_str());
+    dprintf(fd, " %8s\n", "mean W");
+}
+
+/*
+ * Clients overlap, so their rows add up to more than the total; states
+ * are the exact sets of clients and partition it.
+ */
+int EnergyMeter::dump(int fd)
+{
+    Meter *m = meter.load(std::memory_order_acquire);
+    uint64_t uj[ENERGY_MAX_ZONES];
+    int64_t ns;
+
+    if (m == NULL) {
+        dprintf(fd, "energy: no rapl counters\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&m->lock);
+    sample(m, PowerStats::now());
+
+    dump_header(fd, "energy per client", m);
+    for (int client = 0; client < CLIENT_COUNT; client++) {
+        memset(uj, 0, sizeof(uj));
+        ns = 0;
+        for (int state = 0; state < ENERGY_STATES; state++) {
+            if (!(state & (1 << client)))
+                continue;
+            for (size_t i = 0; i < m->zones.size(); i++)
+                uj[i] += m->stateUj[state][i];
+            ns += m->stateNs[state];
+        }
+        dump_row(fd, client_names[client], m, uj, ns);
+    }
+
+    dump_header(fd, "energy per state", m);
+    for (int state = 0; state < ENERGY_STATES; state++)
+        dump_row(fd, clients_label(state).c_str(), m, m->stateUj[state], m->stateNs[state]);
+
+    dump_header(fd, "energy per hint", m);
+    for (int slot = 0; slot < ENERGY_HINT_SLOTS; slot++) {
+        const char *name = PowerStats::hintName(slot);
+        char label[24];
+
+        if (slot == HINT_NONE)
+            name = "none";
+        else if (slot == STATS_HINT_COUNT - 1)
+            name = "other";
+        if (name == NULL) {
+            snprintf(label, sizeof(label), "hint %d", slot);
+            name = label;
+        }
+        dump_row(fd, name, m, m->hintUj[slot], m->hintNs[slot]);
+    }
+    pthread_mutex_unlock(&m->lock);
+    return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_ENERGY_METER_H
+#define ANDROID_ENERGY_METER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define POWERCAP_ROOT "/sys/class/powercap"
+/* Packages and their subzones read, the rest are ignored */
+#define ENERGY_MAX_ZONES 8
+/* A hint keeps its energy this long after its last arrival */
+#define ENERGY_HINT_WINDOW_MS 1000
+/* Far below the wrap time of the counters at any real power */
+#define ENERGY_POLL_MS 60000
+
+/**
+ * Energy accounting from the powercap intel-rapl counters. Whenever the
+ * set of arbiter clients holding a request changes, the counters are read
+ * and the energy since the last read is charged to the clients that were
+ * active until then, so every state is charged for exactly the time it
+ * held. A hint change reads nothing: it only closes the time of the last
+ * hint, and each read splits its energy over the hints seen since the one
+ * before by the time each of them held.
+ *
+ * setClients() is called under the arbiter lock; setHint() and poll() run
+ * on the hint dispatch thread, so the common case of the same hint again
+ * needs no lock. poll() reads the counters every ENERGY_POLL_MS, so a
+ * counter cannot wrap twice between reads, and dump() reads them before
+ * printing. Without readable counters every call is a no-op.
+ */
+class EnergyMeter {
+
+  public:
+      static int init(const char *root = POWERCAP_ROOT);
+      static void setClients(unsigned int clients);
+      static void setHint(int hint, int64_t nowNs);
+      static int64_t poll(int64_t nowNs);
+      static int dump(int fd);
+      /* Reads the counters and returns a state's total for one zone */
+      static uint64_t stateUj(unsigned int clients, size_t zone);
+      /* For tests: drops the meter, so that init() probes again */
+      static void reset();
+
+  private:
+      EnergyMeter() {};
+};
+#endif  // ANDROID_ENERGY_METER_H
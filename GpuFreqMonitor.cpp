@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "GpuFreqMonitor.h"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+#include "SysfsIo.h"
+
+#define MAX_FAIL_TIMES        60
+
+GpuFreqMonitor::GpuFreqMonitor(const char *path, sample_handler_t onSample,
+                               exit_handler_t shouldExit):
+    mPath(path), mOnSample(onSample), mShouldExit(shouldExit),
+    mFastMs(100), mBaseMs(1000), mMaxMs(8000), mHeldMs(1000), mSamples(0)
+{
+    mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+GpuFreqMonitor::~GpuFreqMonitor()
+{
+    if (mWakeFd >= 0)
+        close(mWakeFd);
+}
+
+void GpuFreqMonitor::wake()
+{
+    uint64_t one = 1;
+
+    if (mWakeFd >= 0 && write(mWakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        ALOGW("%s: %s", __func__, strerror(errno));
+}
+
+void GpuFreqMonitor::setIntervals(unsigned int fastMs, unsigned int baseMs, unsigned int maxMs,
+                                  unsigned int heldMs)
+{
+    mFastMs = fastMs;
+    mBaseMs = baseMs < fastMs ? fastMs : baseMs;
+    mMaxMs = maxMs < mBaseMs ? mBaseMs : maxMs;
+    mHeldMs = std::min(std::max(heldMs, mBaseMs), mMaxMs);
+}
+
+int GpuFreqMonitor::readFreq(int fd)
+{
+    unsigned long freq;
+    char buf[16];
+    int ret;
+
+    ret = SysfsIo::pread(fd, buf, sizeof(buf) - 1, 0, mPath.c_str());
+    if (ret <= 0) {
+        ALOGE("read %s failed\n", mPath.c_str());
+        return -1;
+    }
+
+    buf[ret] = '\0';
+    errno = 0;
+    freq = strtoul(buf, NULL, 10);
+    if ((freq == ULONG_MAX && errno == ERANGE) || errno == EINVAL || freq > INT_MAX) {
+        ALOGE("read %s error %d\n", mPath.c_str(), errno);
+        return -1;
+    }
+
+    return freq;
+}
+
+unsigned int GpuFreqMonitor::nextInterval(unsigned int interval, enum gpu_sample_rate rate,
+                                          bool changed) const
+{
+    unsigned int limit = rate == GPU_SAMPLE_HELD ? mHeldMs : mMaxMs;
+
+    if (rate == GPU_SAMPLE_FAST)
+        return mFastMs;
+    if (changed || interval < mBaseMs)
+        return mBaseMs;
+    /* nothing is happening: back off */
+    return interval * 2 > limit ? limit : interval * 2;
+}
+
+static int arm_timer(int tfd, unsigned int ms)
+{
+    struct itimerspec spec;
+
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = ms / 1000;
+    spec.it_value.tv_nsec = (ms % 1000) * 1000000L;
+    return timerfd_settime(tfd, 0, &spec, NULL);
+}
+
+/* Runs until the exit handler asks to stop or the node keeps failing. */
+int GpuFreqMonitor::run()
+{
+    struct epoll_event ev;
+    unsigned int interval = mBaseMs;
+    uint64_t expirations;
+    int fd, tfd, efd;
+    int failures = 0;
+    int freq, old = -1;
+    int ret = -1;
+
+    fd = SysfsIo::open(mPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ALOGW("open %s failed\n", mPath.c_str());
+        return -1;
+    }
+
+    tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    efd = epoll_create1(EPOLL_CLOEXEC);
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = tfd;
+    /* take the first sample right away */
+    if (tfd < 0 || efd < 0 || epoll_ctl(efd, EPOLL_CTL_ADD, tfd, &ev) ||
+        arm_timer(tfd, 1)) {
+        ALOGE("%s: timer setup failed: %s", __func__, strerror(errno));
+        goto out;
+    }
+    ev.data.fd = mWakeFd;
+    if (mWakeFd >= 0 && epoll_ctl(efd, EPOLL_CTL_ADD, mWakeFd, &ev))
+        ALOGW("%s: no wake up, exit waits for a sample: %s", __func__, strerror(errno));
+
+    while (1) {
+        if (epoll_wait(efd, &ev, 1, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            ALOGE("%s: epoll_wait failed: %s", __func__, strerror(errno));
+            break;
+        }
+        if (ev.data.fd == mWakeFd) {
+            /* only ask the exit handler, the timer stays armed */
+            if (read(mWakeFd, &expirations, sizeof(expirations)) > 0 && mShouldExit()) {
+                ret = 0;
+                break;
+            }
+            continue;
+        }
+        if (read(tfd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+            continue;
+
+        if (mShouldExit()) {
+            ret = 0;
+            break;
+        }
+
+        mSamples++;
+        freq = readFreq(fd);
+        if (freq < 0) {
+            ALOGE("get_actual_freq failed (%d)\n", ++failures);
+            if (failures > MAX_FAIL_TIMES) {
+                ALOGE("%s exit since continous failure\n", __func__);
+                break;
+            }
+            interval = mBaseMs;
+        } else {
+            failures = 0;
+            interval = nextInterval(interval, mOnSample(freq), freq != old);
+            old = freq;
+        }
+
+        if (arm_timer(tfd, interval)) {
+            ALOGE("%s: timerfd_settime failed: %s", __func__, strerror(errno));
+            break;
+        }
+    }
+
+out:
+    if (efd >= 0)
+        close(efd);
+    if (tfd >= 0)
+        close(tfd);
+    close(fd);
+    return ret;
+}
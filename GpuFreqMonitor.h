@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_GPU_FREQ_MONITOR_H
+#define ANDROID_GPU_FREQ_MONITOR_H
+
+#include <string>
+
+enum gpu_sample_rate {
+    GPU_SAMPLE_IDLE = 0,        /* back off while the frequency is stable */
+    GPU_SAMPLE_HELD,            /* a cap is held: back off, up to the held interval */
+    GPU_SAMPLE_FAST,            /* close to a decision point */
+};
+
+/**
+ * Samples the GPU actual frequency on a timerfd/epoll loop. The sample
+ * handler reports whether the frequency is close to a decision point; the
+ * monitor then samples at the fast rate, otherwise it stays at the base
+ * rate while the frequency moves and backs off exponentially while it is
+ * stable. While a cap is held the back off stops at the held interval, so
+ * a release is not seen seconds late. wake() has the loop ask the exit
+ * handler at once, without waiting for the next sample.
+ */
+class GpuFreqMonitor {
+
+  public:
+      /* returns how soon the next sample is wanted */
+      typedef enum gpu_sample_rate (*sample_handler_t)(int freq);
+      /* returns true when the monitor should stop */
+      typedef bool (*exit_handler_t)(void);
+
+      GpuFreqMonitor(const char *path, sample_handler_t onSample, exit_handler_t shouldExit);
+      virtual ~GpuFreqMonitor();
+      void setIntervals(unsigned int fastMs, unsigned int baseMs, unsigned int maxMs,
+                        unsigned int heldMs);
+      int run();
+      /* safe from any thread */
+      void wake();
+      unsigned long samples() const { return mSamples; };
+      /* the sampling policy, on its own so it can be simulated */
+      unsigned int nextInterval(unsigned int interval, enum gpu_sample_rate rate,
+                                bool changed) const;
+
+  private:
+      std::string mPath;
+      sample_handler_t mOnSample;
+      exit_handler_t mShouldExit;
+      unsigned int mFastMs;
+      unsigned int mBaseMs;
+      unsigned int mMaxMs;
+      unsigned int mHeldMs;
+      unsigned long mSamples;
+      int mWakeFd;
+
+      int readFreq(int fd);
+};
+#endif  // ANDROID_GPU_FREQ_MONITOR_H
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "GpuThrottleController.h"
+
+#include <math.h>
+
+#include <cutils/log.h>
+
+/* Samples further apart than this restart the derivative and integral */
+#define MAX_SAMPLE_GAP_NS   (10 * 1000000000LL)
+
+/* Samples fast this close to the threshold the cap may move at next */
+#define NEAR_MHZ            100
+
+GpuThrottleController::GpuThrottleController():
+    mMode(THROTTLE_MODE_LEGACY), mCap(100)
+{
+    defaultParams(&mParams);
+    reset();
+}
+
+void GpuThrottleController::defaultParams(struct GpuThrottleParams *params)
+{
+    params->upThreshold = 600;
+    params->downThreshold = 200;
+    params->legacyCap = 50;
+    params->setpoint = 450;
+    params->deadband = 50;
+    params->alpha = 0.3;
+    params->kp = 0.1;
+    params->ki = 0.05;
+    params->kd = 0;
+    params->minCap = 50;
+    params->step = 10;
+}
+
+void GpuThrottleController::setMode(enum gpu_throttle_mode mode)
+{
+    mMode = mode;
+    reset();
+}
+
+void GpuThrottleController::setParams(const struct GpuThrottleParams &params)
+{
+    mParams = params;
+    if (mParams.minCap > 100)
+        mParams.minCap = 100;
+    if (mParams.step == 0)
+        mParams.step = 1;
+    if (mParams.alpha <= 0 || mParams.alpha > 1)
+        mParams.alpha = 1;
+    reset();
+}
+
+/* Forget the loop history; the cap itself is left to the caller to restore. */
+void GpuThrottleController::reset()
+{
+    mPrimed = false;
+    mSmoothed = 0;
+    mIntegral = 0;
+    mLastError = 0;
+    mLastNs = 0;
+}
+
+unsigned int GpuThrottleController::updateLegacy(int freq, bool *near)
+{
+    if (freq > mParams.upThreshold && mCap == 100)
+        mCap = mParams.legacyCap;   // throttle
+    if (freq < mParams.downThreshold && mCap != 100)
+        mCap = 100;                 // release throttle
+
+    if (mCap != 100)
+        *near = freq < mParams.downThreshold + NEAR_MHZ;
+    else
+        *near = freq > mParams.upThreshold - NEAR_MHZ;
+    return mCap;
+}
+
+/*
+ * Released with nothing integrated, the loop only acts once the smoothed
+ * frequency climbs past the deadband, so the distance to it decides; at
+ * the lowest cap only a fall back to it can move the cap. In between,
+ * leaving the deadband either way moves the cap: sample fast from half
+ * way to its edge.
+ */
+bool GpuThrottleController::pidNear() const
+{
+    double error = mSmoothed - mParams.setpoint;
+
+    if (mCap == 100 && mIntegral <= 0)
+        return error > -mParams.deadband - NEAR_MHZ;
+    if (mCap <= mParams.minCap && error > 0)
+        return error < mParams.deadband + NEAR_MHZ;
+    return fabs(error) > mParams.deadband / 2.0;
+}
+
+/*
+ * The error is how far the smoothed GPU frequency sits above the setpoint.
+ * The PID output is the number of percent taken off the cap. It is snapped
+ * to whole steps, and the cap only moves once the output is well past the
+ * step boundary, so samples around a boundary do not flip the cap.
+ */
+unsigned int GpuThrottleController::updatePid(int freq, int64_t nowNs, bool *near)
+{
+    double error, dt, derivative, output, target;
+    unsigned int step = mParams.step;
+    unsigned int range = 100 - mParams.minCap;
+    long snapped;
+
+    if (!mPrimed || nowNs - mLastNs > MAX_SAMPLE_GAP_NS || nowNs <= mLastNs) {
+        mSmoothed = freq;
+        mIntegral = 0;
+        mLastError = mSmoothed - mParams.setpoint;
+        mLastNs = nowNs;
+        mPrimed = true;
+        *near = pidNear();
+        return mCap;
+    }
+
+    dt = (nowNs - mLastNs) / 1e9;
+    mLastNs = nowNs;
+    mSmoothed += mParams.alpha * (freq - mSmoothed);
+
+    error = mSmoothed - mParams.setpoint;
+    if (fabs(error) < mParams.deadband)
+        error = 0;
+
+    derivative = (error - mLastError) / dt;
+    mLastError = error;
+
+    /* anti-windup: keep the integral term within the cap range */
+    mIntegral += error * dt;
+    if (mParams.ki > 0) {
+        if (mIntegral * mParams.ki > range)
+            mIntegral = range / mParams.ki;
+        if (mIntegral < 0)
+            mIntegral = 0;
+    }
+
+    output = mParams.kp * error + mParams.ki * mIntegral + mParams.kd * derivative;
+    if (output < 0)
+        output = 0;
+    if (output > range)
+        output = range;
+
+    target = 100 - output;
+    if (fabs(target - mCap) >= step * 0.75) {
+        snapped = lround(target / step) * step;
+        if (snapped < (long)mParams.minCap)
+            snapped = mParams.minCap;
+        if (snapped > 100)
+            snapped = 100;
+        mCap = snapped;
+    }
+
+    *near = pidNear();
+    return mCap;
+}
+
+/*
+ * Feed one GPU frequency sample (MHz). Returns the cap in percent and sets
+ * *near when the loop wants the next sample at the fast rate.
+ */
+unsigned int GpuThrottleController::update(int freq, int64_t nowNs, bool *near)
+{
+    if (mMode == THROTTLE_MODE_PID)
+        return updatePid(freq, nowNs, near);
+    return updateLegacy(freq, near);
+}
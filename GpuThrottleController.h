@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_GPU_THROTTLE_CONTROLLER_H
+#define ANDROID_GPU_THROTTLE_CONTROLLER_H
+
+#include <stdint.h>
+
+enum gpu_throttle_mode {
+    THROTTLE_MODE_LEGACY = 0,   /* two thresholds, two caps */
+    THROTTLE_MODE_PID,          /* smoothed PI(D) loop, stepped caps */
+};
+
+struct GpuThrottleParams {
+    /* legacy mode */
+    int upThreshold;            /* MHz */
+    int downThreshold;          /* MHz */
+    unsigned int legacyCap;     /* percent */
+    /* controller mode */
+    int setpoint;               /* MHz */
+    int deadband;               /* MHz around the setpoint with no action */
+    double alpha;               /* EWMA weight of a new sample */
+    double kp;                  /* percent of cap per MHz */
+    double ki;                  /* percent of cap per MHz*s */
+    double kd;                  /* percent of cap per MHz/s */
+    unsigned int minCap;        /* percent */
+    unsigned int step;          /* percent */
+};
+
+/**
+ * Turns GPU actual frequency samples into a CPU frequency cap, expressed
+ * as a percentage of each cpufreq policy's maximum.
+ */
+class GpuThrottleController {
+
+  public:
+      GpuThrottleController();
+      virtual ~GpuThrottleController() {};
+      void setMode(enum gpu_throttle_mode mode);
+      void setParams(const struct GpuThrottleParams &params);
+      const struct GpuThrottleParams &params() const { return mParams; };
+      unsigned int update(int freq, int64_t nowNs, bool *near);
+      unsigned int cap() const { return mCap; };
+      void reset();
+
+      static void defaultParams(struct GpuThrottleParams *params);
+
+  private:
+      enum gpu_throttle_mode mMode;
+      struct GpuThrottleParams mParams;
+      unsigned int mCap;
+      bool mPrimed;
+      double mSmoothed;
+      double mIntegral;
+      double mLastError;
+      int64_t mLastNs;
+
+      unsigned int updateLegacy(int freq, bool *near);
+      unsigned int updatePid(int freq, int64_t nowNs, bool *near);
+      bool pidNear() const;
+};
+#endif  // ANDROID_GPU_THROTTLE_CONTROLLER_H
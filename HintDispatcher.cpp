@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "HintDispatcher.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+#include "PowerStats.h"
+
+HintDispatcher::HintDispatcher(hint_handler_t handler):
+    mHandler(handler), mTimeoutHandler(NULL), mHead(0), mTail(0), mSleeping(false),
+    mDropped(0), mEventFd(-1)
+{
+    unsigned int i;
+
+    for (i = 0; i < QUEUE_SIZE; i++)
+        mSlots[i].seq.store(i, std::memory_order_relaxed);
+}
+
+int HintDispatcher::start()
+{
+    int fd;
+
+    if (mEventFd.load(std::memory_order_acquire) >= 0)
+        return 0;
+
+    fd = eventfd(0, EFD_CLOEXEC);
+    if (fd < 0) {
+        ALOGE("%s: eventfd failed: %s", __func__, strerror(errno));
+        return -1;
+    }
+
+    /* published before the thread exists; hints posted meanwhile wait in the ring */
+    mEventFd.store(fd, std::memory_order_release);
+    if (pthread_create(&mThread, NULL, threadLoop, this)) {
+        ALOGE("%s: could not create dispatch thread", __func__);
+        mEventFd.store(-1, std::memory_order_release);
+        close(fd);
+        return -1;
+    }
+    pthread_setname_np(mThread, "powerhal_hint");
+
+    return 0;
+}
+
+/*
+ * Bounded MPSC ring: every slot carries a sequence number telling producers
+ * whether it is free for the current lap and the consumer whether it has
+ * been filled.
+ */
+bool HintDispatcher::push(const struct HintRecord *rec)
+{
+    unsigned int pos = mHead.load(std::memory_order_relaxed);
+    Slot *slot;
+
+    for (;;) {
+        slot = &mSlots[pos & (QUEUE_SIZE - 1)];
+        unsigned int seq = slot->seq.load(std::memory_order_acquire);
+        int diff = (int)(seq - pos);
+
+        if (diff == 0) {
+            if (mHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = mHead.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->rec = *rec;
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool HintDispatcher::pop(struct HintRecord *rec)
+{
+    Slot *slot = &mSlots[mTail & (QUEUE_SIZE - 1)];
+    unsigned int seq = slot->seq.load(std::memory_order_acquire);
+
+    if ((int)(seq - (mTail + 1)) < 0)
+        return false;
+
+    *rec = slot->rec;
+    slot->seq.store(mTail + QUEUE_SIZE, std::memory_order_release);
+    mTail++;
+    return true;
+}
+
+/* Only pay for the eventfd write when the dispatch thread is parked. */
+void HintDispatcher::wake()
+{
+    uint64_t one = 1;
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!mSleeping.load(std::memory_order_relaxed))
+        return;
+
+    if (write(mEventFd.load(std::memory_order_acquire), &one, sizeof(one)) < 0)
+        ALOGE("%s: eventfd write failed: %s", __func__, strerror(errno));
+}
+
+bool HintDispatcher::post(int hint, void *data)
+{
+    struct HintRecord rec;
+
+    rec.hint = hint;
+    rec.data = (unsigned long)data;
+    clock_gettime(CLOCK_MONOTONIC, &rec.time);
+
+    /* Dispatch thread never came up: handle the hint in the caller */
+    if (mEventFd.load(std::memory_order_acquire) < 0) {
+        mHandler(&rec);
+        return true;
+    }
+
+    if (!push(&rec)) {
+        if (mDropped.fetch_add(1, std::memory_order_relaxed) == 0)
+            ALOGW("%s: hint queue full, dropping hints", __func__);
+        return false;
+    }
+
+    wake();
+    return true;
+}
+
+/*
+ * Hint latencies are taken against the clock read that follows a batch,
+ * which the deadlines need anyway, so a hint costs no clock read of its
+ * own. A hint early in a batch is charged for the ones after it.
+ */
+static void record_latencies(const int64_t *posted, unsigned int count,
+                             const struct timespec *now)
+{
+    int64_t nowNs = now->tv_sec * 1000000000LL + now->tv_nsec;
+
+    for (unsigned int i = 0; i < count; i++)
+        PowerStats::recordLatency(STAT_HINT, nowNs - posted[i]);
+}
+
+void *HintDispatcher::threadLoop(void *arg)
+{
+    HintDispatcher *self = (HintDispatcher *) arg;
+    struct HintRecord rec;
+    struct pollfd pfd;
+    struct timespec now;
+    int64_t posted[QUEUE_SIZE];
+    unsigned int batch = 0;
+    int fd = self->mEventFd.load(std::memory_order_acquire);
+    int64_t timeout;
+    uint64_t count;
+
+    ALOGI("thread %ld: %s start\n", pthread_self(), __func__);
+
+    while (1) {
+        while (self->pop(&rec)) {
+            self->mHandler(&rec);
+            posted[batch++] = rec.time.tv_sec * 1000000000LL + rec.time.tv_nsec;
+            if (batch == QUEUE_SIZE) {
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                record_latencies(posted, batch, &now);
+                batch = 0;
+            }
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        record_latencies(posted, batch, &now);
+        batch = 0;
+
+        timeout = -1;
+        if (self->mTimeoutHandler)
+            timeout = self->mTimeoutHandler(&now);
+
+        /* Announce we are going to sleep, then look again to close the race */
+        self->mSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (self->pop(&rec)) {
+            self->mSleeping.store(false, std::memory_order_relaxed);
+            self->mHandler(&rec);
+            posted[batch++] = rec.time.tv_sec * 1000000000LL + rec.time.tv_nsec;
+            continue;
+        }
+
+        /* round up so a deadline is never woken for early */
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, timeout < 0 ? -1 : (int)((timeout + 999999) / 1000000)) > 0 &&
+            read(fd, &count, sizeof(count)) < 0 && errno != EINTR)
+            ALOGE("%s: eventfd read failed: %s", __func__, strerror(errno));
+        self->mSleeping.store(false, std::memory_order_relaxed);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HINT_DISPATCHER_H
+#define ANDROID_HINT_DISPATCHER_H
+
+#include <atomic>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * A hint as seen by the dispatch thread. The caller's data pointer is only
+ * kept as a value, it is never dereferenced after powerHint() returns.
+ */
+struct HintRecord {
+    int hint;
+    unsigned long data;
+    struct timespec time;
+};
+
+/**
+ * Moves hint handling off the caller's thread. powerHint() only timestamps
+ * the hint and pushes it into a bounded lock-free MPSC ring; a dedicated
+ * thread drains the ring and runs the handler, including all sysfs and
+ * binder I/O.
+ */
+class HintDispatcher {
+
+  public:
+      typedef void (*hint_handler_t)(const struct HintRecord *rec);
+      /* runs deadlines due at now; returns ns until the next one or -1 */
+      typedef int64_t (*timeout_handler_t)(const struct timespec *now);
+
+      HintDispatcher(hint_handler_t handler);
+      virtual ~HintDispatcher() {};
+      void setTimeoutHandler(timeout_handler_t handler) { mTimeoutHandler = handler; };
+      int start();
+      bool post(int hint, void *data);
+      unsigned long dropped() const { return mDropped.load(std::memory_order_relaxed); };
+
+  private:
+      /* must be a power of two */
+      static const unsigned int QUEUE_SIZE = 256;
+
+      struct Slot {
+          std::atomic<unsigned int> seq;
+          struct HintRecord rec;
+      };
+
+      hint_handler_t mHandler;
+      timeout_handler_t mTimeoutHandler;
+      Slot mSlots[QUEUE_SIZE];
+      std::atomic<unsigned int> mHead;
+      unsigned int mTail;
+      std::atomic<bool> mSleeping;
+      std::atomic<unsigned long> mDropped;
+      /* set by start(), read by posting threads */
+      std::atomic<int> mEventFd;
+      pthread_t mThread;
+
+      bool push(const struct HintRecord *rec);
+      bool pop(struct HintRecord *rec);
+      void wake();
+      static void *threadLoop(void *arg);
+};
+#endif  // ANDROID_HINT_DISPATCHER_H
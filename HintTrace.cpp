@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "HintTrace.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+/* records per thread, must be a power of two */
+#define RING_SIZE 4096
+
+struct TraceSlot {
+    std::atomic<uint32_t> seq;
+    struct TraceRecord rec;
+};
+
+struct TraceRing {
+    std::atomic<uint32_t> head;
+    uint16_t tid;
+    struct TraceSlot slots[RING_SIZE];
+    TraceRing *next;
+};
+
+std::atomic<bool> HintTrace::sEnabled(false);
+
+static std::atomic<TraceRing *> rings(NULL);
+static thread_local TraceRing *threadRing;
+static std::vector<std::string> nodePaths;
+static pthread_mutex_t nodeLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Rings live as long as the process; binder threads are long-lived. */
+static TraceRing *ring_for_thread(void)
+{
+    TraceRing *ring = new TraceRing();
+
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tid = (uint16_t)syscall(SYS_gettid);
+    for (int i = 0; i < RING_SIZE; i++)
+        ring->slots[i].seq.store(0, std::memory_order_relaxed);
+
+    ring->next = rings.load(std::memory_order_relaxed);
+    while (!rings.compare_exchange_weak(ring->next, ring, std::memory_order_release))
+        ;
+    threadRing = ring;
+    return ring;
+}
+
+void HintTrace::record(enum trace_event event, int32_t arg, uint64_t data, int64_t timeNs)
+{
+    TraceRing *ring = threadRing;
+    struct timespec now;
+    uint32_t head;
+    TraceSlot *slot;
+
+    if (!enabled())
+        return;
+    if (ring == NULL)
+        ring = ring_for_thread();
+
+    if (timeNs == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        timeNs = now.tv_sec * 1000000000LL + now.tv_nsec;
+    }
+
+    /* odd seq marks a slot being written, dump() skips those */
+    head = ring->head.load(std::memory_order_relaxed);
+    slot = &ring->slots[head & (RING_SIZE - 1)];
+    slot->seq.store(head * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->rec.timeNs = timeNs;
+    slot->rec.event = event;
+    slot->rec.tid = ring->tid;
+    slot->rec.arg = arg;
+    slot->rec.data = data;
+    slot->seq.store(head * 2 + 2, std::memory_order_release);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+/* Called once per SysfsNode; the id indexes the path table of a dump. */
+int HintTrace::nodeId(const char *path)
+{
+    int id;
+
+    pthread_mutex_lock(&nodeLock);
+    id = nodePaths.size();
+    nodePaths.push_back(path);
+    pthread_mutex_unlock(&nodeLock);
+    return id;
+}
+
+std::string HintTrace::nodePath(int id)
+{
+    std::string path;
+
+    pthread_mutex_lock(&nodeLock);
+    if (id >= 0 && id < (int)nodePaths.size())
+        path = nodePaths[id];
+    pthread_mutex_unlock(&nodeLock);
+    return path;
+}
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+    const char *p = (const char *)buf;
+    ssize_t ret;
+
+    while (len) {
+        ret = write(fd, p, len);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return -1;
+        p += ret;
+        len -= ret;
+    }
+    return 0;
+}
+
+/*
+ * Writes every ring, merged in time order, to path. Recording may go on
+ * meanwhile; a record overwritten while being copied is left out.
+ */
+int HintTrace::dump(const char *path)
+{
+    std::vector<TraceRecord> records;
+    struct TraceHeader header;
+    char buf[80];
+    int fd, ret = 0;
+
+    for (TraceRing *ring = rings.load(std::memory_order_acquire); ring; ring = ring->next) {
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+        uint32_t first = head > RING_SIZE ? head - RING_SIZE : 0;
+
+        for (uint32_t i = first; i < head; i++) {
+            TraceSlot *slot = &ring->slots[i & (RING_SIZE - 1)];
+            struct TraceRecord rec;
+
+            if (slot->seq.load(std::memory_order_acquire) != i * 2 + 2)
+                continue;
+            rec = slot->rec;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->seq.load(std::memory_order_relaxed) != i * 2 + 2)
+                continue;
+            records.push_back(rec);
+        }
+    }
+    std::stable_sort(records.begin(), records.end(),
+                     [](const TraceRecord &a, const TraceRecord &b) { return a.timeNs < b.timeNs; });
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error opening trace file %s: %s\n", path, buf);
+        return -1;
+    }
+
+    pthread_mutex_lock(&nodeLock);
+    header.magic = HINT_TRACE_MAGIC;
+    header.version = HINT_TRACE_VERSION;
+    header.nodeCount = nodePaths.size();
+    header.recordCount = records.size();
+    if (write_all(fd, &header, sizeof(header)))
+        ret = -1;
+    for (size_t i = 0; i < nodePaths.size() && !ret; i++) {
+        uint16_t len = nodePaths[i].size();
+
+        if (write_all(fd, &len, sizeof(len)) || write_all(fd, nodePaths[i].data(), len))
+            ret = -1;
+    }
+    pthread_mutex_unlock(&nodeLock);
+    if (!ret && !records.empty() &&
+        write_all(fd, records.data(), records.size() * sizeof(TraceRecord)))
+        ret = -1;
+    close(fd);
+
+    if (ret)
+        ALOGE("Error writing trace file %s\n", path);
+    else
+        ALOGI("hint trace: %zu records written to %s", records.size(), path);
+    return ret;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HINT_TRACE_H
+#define ANDROID_HINT_TRACE_H
+
+#include <atomic>
+#include <string>
+
+#include <stdint.h>
+
+#define HINT_TRACE_MAGIC 0x52544850     /* "PHTR" */
+#define HINT_TRACE_VERSION 1
+
+enum trace_event {
+    TRACE_HINT = 0,         /* arg hint, data hint data, time posted */
+    TRACE_HINT_DONE,        /* arg hint, data ns from post to handled */
+    TRACE_INTERACTIVE,      /* arg on, data ns the transition took */
+    TRACE_SYSFS_WRITE,      /* arg node id, data first 8 bytes written */
+    TRACE_THROTTLE,         /* arg cpu cap percent, data gpu freq */
+    TRACE_BOOST,            /* arg arbiter resource, data its new value */
+};
+
+/* or'ed into a TRACE_BOOST arg while the resource is off its default */
+#define TRACE_BOOST_ACTIVE 0x100
+
+/* On disk as is, after a TraceHeader and the node path table */
+struct TraceRecord {
+    int64_t timeNs;         /* CLOCK_MONOTONIC */
+    uint16_t event;
+    uint16_t tid;
+    int32_t arg;
+    uint64_t data;
+};
+
+struct TraceHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nodeCount;     /* each a uint16_t length and the path bytes */
+    uint32_t recordCount;
+};
+
+/**
+ * Binary trace of hints and the sysfs writes they caused. Every thread
+ * records into its own ring, so recording is a few stores and never takes
+ * a lock; when tracing is off it costs one relaxed load.
+ */
+class HintTrace {
+
+  public:
+      static void setEnabled(bool enabled) { sEnabled.store(enabled, std::memory_order_relaxed); };
+      static bool enabled() { return sEnabled.load(std::memory_order_relaxed); };
+      static void record(enum trace_event event, int32_t arg, uint64_t data, int64_t timeNs = 0);
+      static int nodeId(const char *path);
+      static std::string nodePath(int id);
+      static int dump(const char *path);
+
+  private:
+      static std::atomic<bool> sEnabled;
+
+      HintTrace() {};
+};
+#endif  // ANDROID_HINT_TRACE_H
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "IntelPstateBackend.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+#include "SysfsIo.h"
+#include "SysfsNode.h"
+
+/* EPP asked for at each level, empty keeps the value found at probe */
+static const char *level_epp[PSTATE_LEVEL_COUNT] = {
+    "power",                    /* PSTATE_LOW_POWER */
+    "balance_power",            /* PSTATE_SUSTAINED */
+    NULL,                       /* PSTATE_DEFAULT */
+    "balance_performance",      /* PSTATE_INTERACTIVE */
+    "performance",              /* PSTATE_LAUNCH */
+};
+
+static bool read_string(const std::string &path, std::string &value)
+{
+    char buf[256];
+    int fd = SysfsIo::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    int len;
+
+    if (fd < 0)
+        return false;
+
+    len = SysfsIo::pread(fd, buf, sizeof(buf) - 1, 0, path.c_str());
+    close(fd);
+    if (len < 0)
+        return false;
+
+    while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == ' '))
+        len--;
+    value.assign(buf, len);
+    return true;
+}
+
+IntelPstateBackend::IntelPstateBackend(CpuTopology *topology, const char *sysfsRoot):
+    mTopology(topology),
+    mPstateRoot(std::string(sysfsRoot) + "/devices/system/cpu/intel_pstate"),
+    mCaps(0)
+{
+}
+
+/* Keep only the level preferences this part actually offers */
+void IntelPstateBackend::pickPreferences(const char *available)
+{
+    for (int i = 0; i < PSTATE_LEVEL_COUNT; i++) {
+        const char *epp = level_epp[i];
+        const char *p = available;
+        size_t len;
+
+        mEpp[i].clear();
+        if (epp == NULL)
+            continue;
+
+        len = strlen(epp);
+        while ((p = strstr(p, epp)) != NULL) {
+            if ((p == available || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0')) {
+                mEpp[i] = epp;
+                break;
+            }
+            p += len;
+        }
+    }
+}
+
+/*
+ * Works out what this intel_pstate instance can do and saves the current
+ * settings. Needs a scanned CpuTopology for the per policy knobs.
+ */
+int IntelPstateBackend::probe()
+{
+    std::vector<CpufreqPolicy> policies = mTopology->policies();
+    std::string status, value, available;
+
+    mCaps = 0;
+    mSaved.clear();
+
+    /* no status file on older kernels, where the driver is always active */
+    if (read_string(mPstateRoot + "/status", status) && status != "active") {
+        ALOGI("intel_pstate in %s mode, pstate backend disabled", status.c_str());
+        return -1;
+    }
+    if (!read_string(mPstateRoot + "/min_perf_pct", mSavedMinPerfPct))
+        return -1;
+    mCaps |= PSTATE_CAP_ACTIVE;
+
+    if (SysfsIo::access((mPstateRoot + "/hwp_dynamic_boost").c_str(), F_OK) == 0)
+        mCaps |= PSTATE_CAP_HWP;
+
+    for (size_t i = 0; i < policies.size(); i++) {
+        SavedPolicy saved;
+
+        saved.path = policies[i].path;
+        saved.maxFreq = policies[i].maxFreq;
+        saved.baseFreq = 0;
+        if (read_string(saved.path + "/base_frequency", value))
+            saved.baseFreq = strtoul(value.c_str(), NULL, 10);
+        read_string(saved.path + "/scaling_min_freq", saved.minFreq);
+        if (read_string(saved.path + "/energy_performance_preference", saved.epp)) {
+            mCaps |= PSTATE_CAP_HWP | PSTATE_CAP_EPP;
+            /* the performance governor pins EPP, writes fail with EBUSY */
+            if (read_string(saved.path + "/scaling_governor", value) && value == "performance")
+                saved.epp.clear();
+            if (available.empty())
+                read_string(saved.path + "/energy_performance_available_preferences", available);
+        }
+        mSaved.push_back(saved);
+    }
+    pickPreferences(available.c_str());
+
+    ALOGI("intel_pstate backend:%s%s, %zu policies, min_perf_pct %s",
+          mCaps & PSTATE_CAP_HWP ? " hwp" : "", mCaps & PSTATE_CAP_EPP ? " epp" : "",
+          mSaved.size(), mSavedMinPerfPct.c_str());
+    return 0;
+}
+
+int IntelPstateBackend::applyPolicy(const SavedPolicy &policy, int level, bool noTurbo)
+{
+    const std::string *epp = &policy.epp;
+    std::string minFreq = policy.minFreq;
+    unsigned long maxFreq = policy.maxFreq;
+    std::string value;
+    int ret = 0;
+
+    if (!policy.epp.empty() && !mEpp[level].empty())
+        epp = &mEpp[level];
+    if (!epp->empty() &&
+        sysfs_write((policy.path + "/energy_performance_preference").c_str(), epp->c_str()))
+        ret = -1;
+
+    /* stay under a max freq cap, a min above max is rejected */
+    if (level == PSTATE_LAUNCH) {
+        if (noTurbo && policy.baseFreq)
+            maxFreq = std::min(maxFreq, policy.baseFreq);
+        else if (noTurbo && read_string(policy.path + "/scaling_max_freq", value))
+            maxFreq = std::min(maxFreq, strtoul(value.c_str(), NULL, 10));
+        minFreq = std::to_string(maxFreq / 100 * mTopology->capPercent());
+    }
+    if (!minFreq.empty() &&
+        sysfs_write((policy.path + "/scaling_min_freq").c_str(), minFreq.c_str()))
+        ret = -1;
+
+    return ret;
+}
+
+int IntelPstateBackend::apply(int level)
+{
+    std::vector<CpufreqPolicy> policies = mTopology->policies();
+    bool noTurbo = false;
+    std::string value;
+    int ret = 0;
+
+    if (!(mCaps & PSTATE_CAP_ACTIVE) || level < 0 || level >= PSTATE_LEVEL_COUNT)
+        return -1;
+
+    if (!(mCaps & PSTATE_CAP_HWP))
+        return sysfs_write((mPstateRoot + "/min_perf_pct").c_str(),
+                           level == PSTATE_LAUNCH ? "100" : mSavedMinPerfPct.c_str());
+
+    /* turbo may be switched off at any time */
+    if (level == PSTATE_LAUNCH)
+        noTurbo = read_string(mPstateRoot + "/no_turbo", value) && value == "1";
+
+    for (size_t i = 0; i < mSaved.size(); i++) {
+        bool online = false;
+
+        /* policies without an online cpu reject writes */
+        for (size_t j = 0; j < policies.size(); j++) {
+            if (policies[j].path == mSaved[i].path) {
+                online = policies[j].online;
+                break;
+            }
+        }
+        if (online && applyPolicy(mSaved[i], level, noTurbo))
+            ret = -1;
+    }
+
+    ALOGD("intel_pstate level %d%s", level, ret ? " partially applied" : "");
+    return ret;
+}
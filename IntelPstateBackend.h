@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_INTEL_PSTATE_BACKEND_H
+#define ANDROID_INTEL_PSTATE_BACKEND_H
+
+#include <string>
+#include <vector>
+
+#include "CpuTopology.h"
+
+/* Ordered by performance so the boost arbiter can floor and ceil them */
+enum pstate_level {
+    PSTATE_LOW_POWER = 0,
+    PSTATE_SUSTAINED,
+    PSTATE_DEFAULT,
+    PSTATE_INTERACTIVE,
+    PSTATE_LAUNCH,
+    PSTATE_LEVEL_COUNT,
+};
+
+enum pstate_caps {
+    PSTATE_CAP_ACTIVE = 1 << 0,     /* intel_pstate in active mode */
+    PSTATE_CAP_HWP = 1 << 1,        /* hardware P-states, per policy min */
+    PSTATE_CAP_EPP = 1 << 2,        /* energy_performance_preference */
+};
+
+/**
+ * intel_pstate performance levels. With HWP every level is an EPP and a
+ * per policy scaling_min_freq pair; without it only min_perf_pct is moved.
+ * The values found at probe time are kept verbatim and written back for
+ * PSTATE_DEFAULT, so leaving the last level restores the exact settings.
+ * With turbo off the launch level stays at the base frequency, which is
+ * as high as scaling_max_freq then goes.
+ */
+class IntelPstateBackend {
+
+  public:
+      IntelPstateBackend(CpuTopology *topology, const char *sysfsRoot = "/sys");
+      virtual ~IntelPstateBackend() {};
+      int probe();
+      unsigned int caps() const { return mCaps; };
+      int apply(int level);
+      int restore() { return apply(PSTATE_DEFAULT); };
+
+  private:
+      struct SavedPolicy {
+          std::string path;
+          std::string epp;
+          std::string minFreq;
+          unsigned long maxFreq;
+          unsigned long baseFreq;   /* base_frequency, 0 if not there */
+      };
+
+      CpuTopology *mTopology;
+      std::string mPstateRoot;
+      unsigned int mCaps;
+      std::string mSavedMinPerfPct;
+      std::vector<SavedPolicy> mSaved;
+      std::string mEpp[PSTATE_LEVEL_COUNT];
+
+      void pickPreferences(const char *available);
+      int applyPolicy(const SavedPolicy &policy, int level, bool noTurbo);
+};
+#endif  // ANDROID_INTEL_PSTATE_BACKEND_H
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "LaunchBoost.h"
+
+#include <cutils/log.h>
+
+#include "IntelPstateBackend.h"
+
+#define DEFAULT_TIMEOUT_MS 5000
+#define DEFAULT_UCLAMP_PCT 60
+
+LaunchBoost::LaunchBoost(BoostArbiter *arbiter):
+    mArbiter(arbiter), mBackend(LAUNCH_BOOST_NONE),
+    mResource(RES_INTERACTIVE_BOOST), mLevel(1), mUclampLevel(DEFAULT_UCLAMP_PCT),
+    mTimeoutNs(DEFAULT_TIMEOUT_MS * 1000000LL), mRefs(0)
+{
+}
+
+void LaunchBoost::setBackend(enum launch_boost_backend backend)
+{
+    if (mRefs) {
+        mArbiter->cancel(CLIENT_LAUNCH, mResource);
+        mRefs = 0;
+    }
+
+    mBackend = backend;
+    if (backend == LAUNCH_BOOST_INTEL_PSTATE) {
+        mResource = RES_PSTATE_LEVEL;
+        mLevel = PSTATE_LAUNCH;
+    } else if (backend == LAUNCH_BOOST_UCLAMP) {
+        mResource = RES_UCLAMP_MIN_PCT;
+        mLevel = mUclampLevel;
+    } else {
+        mResource = RES_INTERACTIVE_BOOST;
+        mLevel = 1;
+    }
+}
+
+/* Applies from the next launch on, whenever the backend was chosen */
+void LaunchBoost::setUclampLevel(int pct)
+{
+    mUclampLevel = pct;
+    if (mBackend == LAUNCH_BOOST_UCLAMP)
+        mLevel = pct;
+}
+
+void LaunchBoost::setTimeout(unsigned int timeoutMs)
+{
+    mTimeoutNs = (int64_t)timeoutMs * 1000000LL;
+}
+
+/* Every launch ON hint also pushes the deadline out. */
+void LaunchBoost::acquire(const struct timespec *now)
+{
+    struct BoostRequest request;
+
+    if (mBackend == LAUNCH_BOOST_NONE)
+        return;
+
+    /* the arbiter dropped the request at its deadline */
+    if (mRefs && !mArbiter->active(CLIENT_LAUNCH, mResource)) {
+        ALOGW("PowerHAL HAL:App Boost timed out with %d launches pending", mRefs);
+        mRefs = 0;
+    }
+
+    if (mRefs++ == 0)
+        ALOGI("PowerHAL HAL:App Boost ON");
+
+    request.client = CLIENT_LAUNCH;
+    request.resource = mResource;
+    request.kind = BOOST_FLOOR;
+    request.level = mLevel;
+    request.priority = PRIORITY_NORMAL;
+    request.deadlineNs = now->tv_sec * 1000000000LL + now->tv_nsec + mTimeoutNs;
+    mArbiter->submit(request);
+}
+
+void LaunchBoost::release()
+{
+    if (mRefs == 0)
+        return;
+
+    if (--mRefs == 0) {
+        ALOGI("PowerHAL HAL:App Boost OFF");
+        mArbiter->cancel(CLIENT_LAUNCH, mResource);
+    }
+}
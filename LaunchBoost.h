@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_LAUNCH_BOOST_H
+#define ANDROID_LAUNCH_BOOST_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "BoostArbiter.h"
+
+enum launch_boost_backend {
+    LAUNCH_BOOST_NONE = 0,
+    LAUNCH_BOOST_INTERACTIVE,       /* cpufreq/interactive/boost */
+    LAUNCH_BOOST_INTEL_PSTATE,      /* intel_pstate backend */
+    LAUNCH_BOOST_UCLAMP,            /* foreground uclamp.min, at the set level */
+};
+
+/**
+ * App launch boost, a client of the boost arbiter. Overlapping launches
+ * are reference counted and every boost carries a hard deadline, so a lost
+ * OFF hint cannot leave the knob pinned. Not thread safe; driven from the
+ * hint dispatch thread.
+ */
+class LaunchBoost {
+
+  public:
+      LaunchBoost(BoostArbiter *arbiter);
+      virtual ~LaunchBoost() {};
+      void setBackend(enum launch_boost_backend backend);
+      void setTimeout(unsigned int timeoutMs);
+      void setUclampLevel(int pct);
+      void acquire(const struct timespec *now);
+      void release();
+
+  private:
+      BoostArbiter *mArbiter;
+      enum launch_boost_backend mBackend;
+      enum boost_resource mResource;
+      int mLevel;
+      int mUclampLevel;
+      int64_t mTimeoutNs;
+      int mRefs;
+};
+#endif  // ANDROID_LAUNCH_BOOST_H
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "PowerHalState.h"
+
+#include <stdio.h>
+
+#include <cutils/log.h>
+
+#define TOUCH_VSYNC_BOOST       (1 << 0)
+#define TOUCH_TIMER_SET         (1 << 1)
+#define TOUCH_BOOST_DISABLED    (1 << 2)
+
+PowerHalState::PowerHalState():
+    mTouchSeq(0), mLastTouchNs(0), mConsecutiveTouches(0), mVsyncCount(0),
+    mTouchFlags(0), mInteractive(true)
+{
+    pthread_mutex_init(&mInteractiveLock, NULL);
+}
+
+/*
+ * Retries while the writer is mid update. Field accesses are acquire and
+ * release instead of fenced relaxed ones; both are plain moves on x86.
+ */
+void PowerHalState::loadTouchState(struct TouchState *state) const
+{
+    unsigned int seq, flags;
+
+    do {
+        seq = mTouchSeq.load(std::memory_order_acquire);
+        if (seq & 1)
+            continue;
+        state->lastTouchNs = mLastTouchNs.load(std::memory_order_acquire);
+        state->consecutiveTouches = mConsecutiveTouches.load(std::memory_order_acquire);
+        state->vsyncCount = mVsyncCount.load(std::memory_order_acquire);
+        flags = mTouchFlags.load(std::memory_order_acquire);
+    } while ((seq & 1) || mTouchSeq.load(std::memory_order_relaxed) != seq);
+
+    state->vsyncBoost = flags & TOUCH_VSYNC_BOOST;
+    state->timerSet = flags & TOUCH_TIMER_SET;
+    state->touchboostDisabled = flags & TOUCH_BOOST_DISABLED;
+}
+
+/* Dispatch thread only. */
+void PowerHalState::storeTouchState(const struct TouchState &state)
+{
+    unsigned int seq = mTouchSeq.load(std::memory_order_relaxed);
+    unsigned int flags = (state.vsyncBoost ? TOUCH_VSYNC_BOOST : 0) |
+                         (state.timerSet ? TOUCH_TIMER_SET : 0) |
+                         (state.touchboostDisabled ? TOUCH_BOOST_DISABLED : 0);
+
+    mTouchSeq.store(seq + 1, std::memory_order_relaxed);
+    mLastTouchNs.store(state.lastTouchNs, std::memory_order_release);
+    mConsecutiveTouches.store(state.consecutiveTouches, std::memory_order_release);
+    mVsyncCount.store(state.vsyncCount, std::memory_order_release);
+    mTouchFlags.store(flags, std::memory_order_release);
+    mTouchSeq.store(seq + 2, std::memory_order_release);
+}
+
+/*
+ * The handler runs with the transition lock held, so overlapping calls are
+ * applied one after the other in arrival order. Repeating the current
+ * state is a no-op.
+ */
+void PowerHalState::setInteractive(bool on, interactive_handler_t handler)
+{
+    pthread_mutex_lock(&mInteractiveLock);
+    if (mInteractive.load(std::memory_order_relaxed) != on) {
+        handler(on);
+        mInteractive.store(on, std::memory_order_release);
+    }
+    pthread_mutex_unlock(&mInteractiveLock);
+}
+
+/* Any thread; the snapshot is taken without holding up the dispatch thread */
+int PowerHalState::dump(int fd) const
+{
+    struct TouchState touch;
+
+    loadTouchState(&touch);
+    dprintf(fd, "state\n");
+    dprintf(fd, "  %-24s %d\n", "interactive", interactive());
+    dprintf(fd, "  %-24s %lld\n", "last touch ns", (long long)touch.lastTouchNs);
+    dprintf(fd, "  %-24s %d\n", "consecutive touches", touch.consecutiveTouches);
+    dprintf(fd, "  %-24s %d\n", "vsync boosts left", touch.vsyncCount);
+    dprintf(fd, "  %-24s %s%s%s\n", "flags", touch.vsyncBoost ? "vsync " : "",
+            touch.timerSet ? "timer " : "", touch.touchboostDisabled ? "disabled" : "");
+    return 0;
+}
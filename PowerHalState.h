@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_POWER_HAL_STATE_H
+#define ANDROID_POWER_HAL_STATE_H
+
+#include <atomic>
+
+#include <pthread.h>
+#include <stdint.h>
+
+/* Touch/vsync boost state machine */
+struct TouchState {
+    int64_t lastTouchNs;            /* CLOCK_MONOTONIC of the last touch */
+    int consecutiveTouches;
+    int vsyncCount;                 /* vsync boosts left */
+    bool vsyncBoost;
+    bool timerSet;
+    bool touchboostDisabled;
+};
+
+/**
+ * State shared by the HAL entry points. The touch state has a single
+ * writer, the hint dispatch thread, and is published under a seqlock so
+ * the binder thread logging a screen-off and the property thread writing
+ * a stats dump take a consistent snapshot without stalling it. Interactive
+ * transitions are serialized among themselves only; hint delivery never
+ * waits on them.
+ */
+class PowerHalState {
+
+  public:
+      typedef void (*interactive_handler_t)(bool on);
+
+      PowerHalState();
+      virtual ~PowerHalState() {};
+      void loadTouchState(struct TouchState *state) const;
+      void storeTouchState(const struct TouchState &state);
+      bool interactive() const { return mInteractive.load(std::memory_order_acquire); };
+      void setInteractive(bool on, interactive_handler_t handler);
+      int dump(int fd) const;
+
+  private:
+      /* odd while the dispatch thread is writing the fields below */
+      std::atomic<unsigned int> mTouchSeq;
+      std::atomic<int64_t> mLastTouchNs;
+      std::atomic<int> mConsecutiveTouches;
+      std::atomic<int> mVsyncCount;
+      std::atomic<unsigned int> mTouchFlags;
+      std::atomic<bool> mInteractive;
+      pthread_mutex_t mInteractiveLock;
+};
+#endif  // ANDROID_POWER_HAL_STATE_H
@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "PowerHAL"
+
+#include "PowerStats.h"
+
+#include <string>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cutils/log.h>
+
+#include "BoostArbiter.h"
+#include "HintTrace.h"
+
+struct Histogram {
+    std::atomic<uint64_t> buckets[STATS_BUCKETS];
+    std::atomic<uint64_t> sumNs;
+    std::atomic<int64_t> maxNs;
+};
+
+struct Histograms {
+    Histogram latency[STAT_LATENCY_COUNT];
+    Histogram nodes[STATS_NODE_COUNT];
+};
+
+/* Written by its thread only; zeroed by new T() */
+struct StatsBlock {
+    std::atomic<uint64_t> hints[STATS_HINT_COUNT];
+    std::atomic<uint64_t> counters[STAT_COUNTER_COUNT];
+    std::atomic<Histograms *> histograms;
+    StatsBlock *next;
+};
+
+/* Written under the arbiter lock */
+struct BoostStats {
+    std::atomic<int> value;
+    std::atomic<int64_t> sinceNs;           /* 0 before the first write */
+    std::atomic<uint64_t> changes;
+    std::atomic<int64_t> levelNs[STATS_LEVEL_COUNT];
+};
+
+static std::atomic<StatsBlock *> blocks(NULL);
+static thread_local StatsBlock *threadBlock;
+static BoostStats boostStats[RES_COUNT];
+
+static const char *counter_names[STAT_COUNTER_COUNT] = {
+    "boost writes",
+    "boost write errors",
+    "touch boosts",
+    "throttle samples",
+    "throttle capped samples",
+    "sysfs write errors",
+};
+
+static const char *latency_names[STAT_LATENCY_COUNT] = {
+    "hint",
+    "interactive",
+    "devices",
+    "cpusets",
+    "migrate",
+};
+
+static const char *resource_names[RES_COUNT] = {
+    "interactive_boost",
+    "pstate_level",
+    "cpu_max_freq_pct",
+    "power_save",
+    "uclamp_min_pct",
+};
+
+static const char *hint_names[STATS_HINT_COUNT] = {
+    NULL, "vsync", "interaction", "video_encode", "video_decode", "low_power",
+    "sustained_performance", "vr_mode", "launch", "disable_touch",
+};
+
+/* Blocks live as long as the process, like the trace rings */
+static StatsBlock *block_for_thread(void)
+{
+    StatsBlock *block = threadBlock;
+
+    if (block != NULL)
+        return block;
+
+    block = new StatsBlock();
+    block->next = blocks.load(std::memory_order_relaxed);
+    while (!blocks.compare_exchange_weak(block->next, block, std::memory_order_release))
+        ;
+    threadBlock = block;
+    return block;
+}
+
+static Histograms *histograms_for_thread(void)
+{
+    StatsBlock *block = block_for_thread();
+    Histograms *histograms = block->histograms.load(std::memory_order_relaxed);
+
+    if (histograms == NULL) {
+        histograms = new Histograms();
+        block->histograms.store(histograms, std::memory_order_release);
+    }
+    return histograms;
+}
+
+/* Only the owning thread writes, so no read-modify-write is needed */
+static inline void bump(std::atomic<uint64_t> &counter, uint64_t n)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+static void record(Histogram &histogram, int64_t ns)
+{
+    if (ns < 0)
+        ns = 0;
+    bump(histogram.buckets[PowerStats::bucket(ns)], 1);
+    bump(histogram.sumNs, ns);
+    if (ns > histogram.maxNs.load(std::memory_order_relaxed))
+        histogram.maxNs.store(ns, std::memory_order_relaxed);
+}
+
+static int hint_slot(int hint)
+{
+    if (hint < 0 || hint >= STATS_HINT_COUNT)
+        return STATS_HINT_COUNT - 1;
+    return hint;
+}
+
+/* Values below 4 get a bucket each, then four per power of two */
+int PowerStats::bucket(int64_t ns)
+{
+    int exp, index;
+
+    if (ns < 4)
+        return ns < 0 ? 0 : ns;
+    exp = 63 - __builtin_clzll(ns);
+    index = (exp - 1) * 4 + ((ns >> (exp - 2)) & 3);
+    return index < STATS_BUCKETS ? index : STATS_BUCKETS - 1;
+}
+
+int64_t PowerStats::bucketStart(int bucket)
+{
+    if (bucket < 4)
+        return bucket;
+    return (int64_t)(4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+void PowerStats::countHint(int hint)
+{
+    bump(block_for_thread()->hints[hint_slot(hint)], 1);
+}
+
+void PowerStats::count(enum stat_counter counter, uint64_t n)
+{
+    bump(block_for_thread()->counters[counter], n);
+}
+
+void PowerStats::recordLatency(enum stat_latency latency, int64_t ns)
+{
+    record(histograms_for_thread()->latency[latency], ns);
+}
+
+void PowerStats::recordNode(int node, int64_t ns)
+{
+    if (node < 0 || node >= STATS_NODE_COUNT)
+        node = STATS_NODE_COUNT - 1;
+    record(histograms_for_thread()->nodes[node], ns);
+}
+
+/* Closes the interval at the previous value; rewrites of it are no change */
+void PowerStats::boostState(int resource, int value)
+{
+    BoostStats &stats = boostStats[resource];
+    int64_t since = stats.sinceNs.load(std::memory_order_relaxed);
+    int previous = stats.value.load(std::memory_order_relaxed);
+    int64_t now;
+
+    if (value < 0)
+        value = 0;
+    if (value >= STATS_LEVEL_COUNT)
+        value = STATS_LEVEL_COUNT - 1;
+    if (since && value == previous)
+        return;
+
+    now = PowerStats::now();
+    if (since) {
+        std::atomic<int64_t> &level = stats.levelNs[previous];
+
+        level.store(level.load(std::memory_order_relaxed) + now - since,
+                    std::memory_order_relaxed);
+    }
+    stats.value.store(value, std::memory_order_relaxed);
+    stats.sinceNs.store(now, std::memory_order_relaxed);
+    stats.changes.store(stats.changes.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+}
+
+uint64_t PowerStats::hintCount(int hint)
+{
+    uint64_t count = 0;
+
+    for (StatsBlock *block = blocks.load(std::memory_order_acquire); block; block = block->next)
+        count += block->hints[hint_slot(hint)].load(std::memory_order_relaxed);
+    return count;
+}
+
+/* NULL for hints without a name */
+const char *PowerStats::hintName(int hint)
+{
+    if (hint < 0 || hint >= STATS_HINT_COUNT)
+        return NULL;
+    return hint_names[hint];
+}
+
+/* Sums of every thread's histogram */
+struct Merged {
+    uint64_t buckets[STATS_BUCKETS];
+    uint64_t count;
+    uint64_t sumNs;
+    int64_t maxNs;
+};
+
+static void merge(Merged *merged, const Histogram &histogram)
+{
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        uint64_t n = histogram.buckets[i].load(std::memory_order_relaxed);
+
+        merged->buckets[i] += n;
+        merged->count += n;
+    }
+    merged->sumNs += histogram.sumNs.load(std::memory_order_relaxed);
+    if (histogram.maxNs.load(std::memory_order_relaxed) > merged->maxNs)
+        merged->maxNs = histogram.maxNs.load(std::memory_order_relaxed);
+}
+
+/* Middle of the bucket holding that fraction of the samples */
+static int64_t percentile(const Merged &merged, double fraction)
+{
+    uint64_t target = (uint64_t)(merged.count * fraction);
+    uint64_t seen = 0;
+
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        seen += merged.buckets[i];
+        if (seen > target) {
+            int64_t middle = (PowerStats::bucketStart(i) + PowerStats::bucketStart(i + 1)) / 2;
+
+            if (i == STATS_BUCKETS - 1 || middle > merged.maxNs)
+                return merged.maxNs;
+            return middle;
+        }
+    }
+    return merged.maxNs;
+}
+
+static const char *format_ns(char *buf, size_t len, int64_t ns)
+{
+    if (ns < 10000)
+        snprintf(buf, len, "%lldns", (long long)ns);
+    else if (ns < 10000000)
+        snprintf(buf, len, "%.1fus", ns / 1e3);
+    else if (ns < 10000000000LL)
+        snprintf(buf, len, "%.1fms", ns / 1e6);
+    else
+        snprintf(buf, len, "%.1fs", ns / 1e9);
+    return buf;
+}
+
+static void dump_histogram(int fd, const char *name, const Merged &merged)
+{
+    char mean[32], p50[32], p90[32], p99[32], max[32];
+
+    if (merged.count == 0)
+        return;
+    dprintf(fd, "  %-40s %8llu %9s %9s %9s %9s %9s\n", name, (unsigned long long)merged.count,
+            format_ns(mean, sizeof(mean), merged.sumNs / merged.count),
+            format_ns(p50, sizeof(p50), percentile(merged, 0.5)),
+            format_ns(p90, sizeof(p90), percentile(merged, 0.9)),
+            format_ns(p99, sizeof(p99), percentile(merged, 0.99)),
+            format_ns(max, sizeof(max), merged.maxNs));
+}
+
+/* Text for people; recording goes on meanwhile */
+int PowerStats::dump(int fd)
+{
+    StatsBlock *first = blocks.load(std::memory_order_acquire);
+    uint64_t counters[STAT_COUNTER_COUNT] = {};
+    Merged merged;
+    int64_t now = PowerStats::now();
+    char buf[32];
+
+    dprintf(fd, "hints\n");
+    for (int hint = 0; hint < STATS_HINT_COUNT; hint++) {
+        uint64_t count = hintCount(hint);
+
+        if (count == 0)
+            continue;
+        if (hint == STATS_HINT_COUNT - 1)
+            dprintf(fd, "  %-24s %llu\n", "other", (unsigned long long)count);
+        else if (hint_names[hint])
+            dprintf(fd, "  %-24s %llu\n", hint_names[hint], (unsigned long long)count);
+        else
+            dprintf(fd, "  hint %-19d %llu\n", hint, (unsigned long long)count);
+    }
+
+    for (StatsBlock *block = first; block; block = block->next) {
+        for (int i = 0; i < STAT_COUNTER_COUNT; i++)
+            counters[i] += block->counters[i].load(std::memory_order_relaxed);
+    }
+    dprintf(fd, "counters\n");
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++)
+        dprintf(fd, "  %-24s %llu\n", counter_names[i], (unsigned long long)counters[i]);
+
+    dprintf(fd, "%-42s %8s %9s %9s %9s %9s %9s\n", "latency", "count", "mean", "p50", "p90",
+            "p99", "max");
+    for (int i = 0; i < STAT_LATENCY_COUNT; i++) {
+        memset(&merged, 0, sizeof(merged));
+        for (StatsBlock *block = first; block; block = block->next) {
+            Histograms *histograms = block->histograms.load(std::memory_order_acquire);
+
+            if (histograms)
+                merge(&merged, histograms->latency[i]);
+        }
+        dump_histogram(fd, latency_names[i], merged);
+    }
+    for (int node = 0; node < STATS_NODE_COUNT; node++) {
+        std::string path = node == STATS_NODE_COUNT - 1 ? "other sysfs" : HintTrace::nodePath(node);
+
+        memset(&merged, 0, sizeof(merged));
+        for (StatsBlock *block = first; block; block = block->next) {
+            Histograms *histograms = block->histograms.load(std::memory_order_acquire);
+
+            if (histograms)
+                merge(&merged, histograms->nodes[node]);
+        }
+        /* the tail of a long path tells the knobs apart */
+        if (path.size() > 40)
+            path = "..." + path.substr(path.size() - 37);
+        dump_histogram(fd, path.c_str(), merged);
+    }
+
+    dprintf(fd, "boost state time\n");
+    for (int res = 0; res < RES_COUNT; res++) {
+        BoostStats &stats = boostStats[res];
+        int64_t since = stats.sinceNs.load(std::memory_order_relaxed);
+        int current = stats.value.load(std::memory_order_relaxed);
+
+        if (since == 0)
+            continue;
+        dprintf(fd, "  %-24s %llu changes,", resource_names[res],
+                (unsigned long long)stats.changes.load(std::memory_order_relaxed));
+        for (int level = 0; level < STATS_LEVEL_COUNT; level++) {
+            int64_t ns = stats.levelNs[level].load(std::memory_order_relaxed);
+
+            if (level == current)
+                ns += now - since;
+            if (ns)
+                dprintf(fd, " %d: %s", level, format_ns(buf, sizeof(buf), ns));
+        }
+        dprintf(fd, "\n");
+    }
+    return 0;
+}
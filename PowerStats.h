@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_POWER_STATS_H
+#define ANDROID_POWER_STATS_H
+
+#include <atomic>
+
+#include <stdint.h>
+#include <time.h>
+
+/* Hint ids counted per hint, larger ids share the last counter */
+#define STATS_HINT_COUNT 16
+/* SysfsNode ids with their own histogram, larger ids share the last one */
+#define STATS_NODE_COUNT 64
+/* Values kept apart per boost resource, larger ones share the last */
+#define STATS_LEVEL_COUNT 101
+/* Log-linear: four buckets per power of two up to 2^32 ns */
+#define STATS_BUCKETS 128
+
+enum stat_counter {
+    STAT_BOOST_WRITES = 0,      /* arbiter knob writes */
+    STAT_BOOST_ERRORS,          /* of which failed */
+    STAT_TOUCH_BOOSTS,          /* touch and vsync boosts issued */
+    STAT_THROTTLE_SAMPLES,      /* gpu frequency samples */
+    STAT_THROTTLE_CAPPED,       /* of which left the cpus capped */
+    STAT_SYSFS_ERRORS,          /* failed SysfsNode writes */
+    STAT_COUNTER_COUNT,
+};
+
+enum stat_latency {
+    STAT_HINT = 0,              /* powerHint() to its dispatch batch done */
+    STAT_INTERACTIVE,           /* a whole setInteractive() transition */
+    STAT_DEVICES,               /* DevicePowerMonitor::setState() */
+    STAT_CPUSETS,               /* CGroupCpusetController::setState() */
+    STAT_MIGRATE,               /* ProcessMigrator::setState() */
+    STAT_LATENCY_COUNT,
+};
+
+/**
+ * Always-on counters and latency histograms. Every thread updates its own
+ * block with plain relaxed loads and stores, no read-modify-write and no
+ * lock, and dump() sums the blocks; a dump racing an update may miss it.
+ * Histograms are allocated on a thread's first latency, so threads that
+ * only post hints stay small. Boost resources record the time spent at
+ * each value; they are updated under the arbiter lock.
+ */
+class PowerStats {
+
+  public:
+      static void countHint(int hint);
+      static void count(enum stat_counter counter, uint64_t n = 1);
+      static void recordLatency(enum stat_latency latency, int64_t ns);
+      static void recordNode(int node, int64_t ns);
+      static void boostState(int resource, int value);
+      static uint64_t hintCount(int hint);
+      static const char *hintName(int hint);
+      static int64_t now()
+      {
+          struct timespec ts;
+
+          clock_gettime(CLOCK_MONOTONIC, &ts);
+          return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+      };
+      static int bucket(int64_t ns);
+      static int64_t bucketStart(int bucket);
+      static int dump(int fd);
+
+  private:
+      PowerStats() {};
+};
+#endif  // ANDROID_POWER_STATS_H
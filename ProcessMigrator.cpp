@@ -0,0 +1,517 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "ProcessMigrator.h"
+
+#include <algorithm>
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/filter.h>
+#include <linux/netlink.h>
+
+#include <cutils/log.h>
+
+#include "SysfsIo.h"
+
+#define MIGRATE_CONFIG "/vendor/etc/powerhal_migrate.conf"
+#define NON_INTERACTIVE_CPUSET "non_interactive"
+#define EVENT_BUFFER_SIZE (1 << 20)
+
+ProcessMigrator::ProcessMigrator(const char *cpusetRoot):
+    mRoot(cpusetRoot), mGroup(NON_INTERACTIVE_CPUSET), mScanning(false), mHasNames(false),
+    mInteractive(true), mSocket(-1), mStopFd(-1), mListening(false), mResync(false)
+{
+    pthread_mutex_init(&mLock, NULL);
+    pthread_mutex_init(&mScanLock, NULL);
+}
+
+ProcessMigrator::~ProcessMigrator()
+{
+    uint64_t one = 1;
+
+    if (mStopFd >= 0) {
+        pthread_mutex_lock(&mLock);
+        mListening = false;
+        pthread_mutex_unlock(&mLock);
+        if (write(mStopFd, &one, sizeof(one)) == sizeof(one))
+            pthread_join(mThread, NULL);
+        close(mStopFd);
+    }
+    if (mSocket >= 0)
+        close(mSocket);
+    pthread_mutex_destroy(&mScanLock);
+    pthread_mutex_destroy(&mLock);
+}
+
+/* Lines of "name <glob>" or "cgroup <glob>", # comments */
+void ProcessMigrator::loadConfig(const char *path)
+{
+    char line[256];
+    char kind[16], pattern[192];
+    Target target;
+    FILE *file;
+
+    file = SysfsIo::fopen(path, "re");
+    if (file == NULL) {
+        /* what power_hal_helper used to look for */
+        target.cgroup = false;
+        target.pattern = "/system/bin/mediaserver";
+        mTargets.push_back(target);
+        return;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        char *hash = strchr(line, '#');
+
+        if (hash)
+            *hash = '\0';
+        if (sscanf(line, "%15s %191s", kind, pattern) != 2)
+            continue;
+
+        if (strcmp(kind, "name") && strcmp(kind, "cgroup")) {
+            ALOGW("%s: unknown target kind '%s'", path, kind);
+            continue;
+        }
+        target.cgroup = !strcmp(kind, "cgroup");
+        target.pattern = pattern;
+        mTargets.push_back(target);
+    }
+    fclose(file);
+}
+
+/* Matches the exec'd path, argv[0], against the name targets */
+bool ProcessMigrator::matchName(pid_t pid)
+{
+    char path[32];
+    char cmdline[256];
+    ssize_t len;
+    int fd;
+
+    snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
+    fd = SysfsIo::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    len = SysfsIo::pread(fd, cmdline, sizeof(cmdline) - 1, 0, path);
+    close(fd);
+    if (len <= 0)
+        return false;
+    cmdline[len] = '\0';
+    /* the fake tree has a trailing newline where the kernel has a NUL */
+    cmdline[strcspn(cmdline, "\n")] = '\0';
+
+    for (size_t i = 0; i < mTargets.size(); i++) {
+        if (!mTargets[i].cgroup && !fnmatch(mTargets[i].pattern.c_str(), cmdline, 0))
+            return true;
+    }
+    return false;
+}
+
+/* The cpuset a process is in, relative to the cpuset root */
+bool ProcessMigrator::cpusetOf(pid_t pid, std::string &cpuset)
+{
+    char path[32];
+    char buf[256];
+    ssize_t len;
+    int fd;
+
+    snprintf(path, sizeof(path), "/proc/%d/cpuset", pid);
+    fd = SysfsIo::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    len = SysfsIo::pread(fd, buf, sizeof(buf) - 1, 0, path);
+    close(fd);
+    if (len <= 0)
+        return false;
+
+    while (len > 0 && isspace(buf[len - 1]))
+        len--;
+    buf[len] = '\0';
+    cpuset = buf[0] == '/' ? buf + 1 : buf;
+    return true;
+}
+
+/* Members of every cpuset a cgroup target matches, read from cgroup.procs */
+void ProcessMigrator::collectCgroups(std::vector<std::pair<pid_t, std::string> > &procs)
+{
+    struct dirent *de;
+    DIR *dir;
+
+    dir = SysfsIo::opendir(mRoot.c_str());
+    if (dir == NULL)
+        return;
+
+    while ((de = readdir(dir))) {
+        bool match = false;
+        FILE *file;
+        int pid;
+
+        if (de->d_name[0] == '.' || mGroup == de->d_name)
+            continue;
+        for (size_t i = 0; i < mTargets.size() && !match; i++)
+            match = mTargets[i].cgroup && !fnmatch(mTargets[i].pattern.c_str(), de->d_name, 0);
+        if (!match)
+            continue;
+
+        file = SysfsIo::fopen((mRoot + "/" + de->d_name + "/cgroup.procs").c_str(), "re");
+        if (file == NULL)
+            continue;
+        while (fscanf(file, "%d", &pid) == 1)
+            procs.push_back(std::make_pair((pid_t)pid, std::string(de->d_name)));
+        fclose(file);
+    }
+    closedir(dir);
+}
+
+/* Moves every thread of a process; a process that exited is not an error */
+bool ProcessMigrator::move(pid_t pid, const std::string &cpuset)
+{
+    std::string path = mRoot + (cpuset.empty() ? "" : "/" + cpuset) + "/cgroup.procs";
+    char buf[16];
+    int len;
+    int fd;
+    int ret;
+
+    fd = SysfsIo::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ALOGE("Could not open %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    len = snprintf(buf, sizeof(buf), "%d", pid);
+    ret = SysfsIo::pwrite(fd, buf, len, 0, path.c_str());
+    close(fd);
+    if (ret < 0 && errno != ESRCH) {
+        ALOGE("Could not move %d to %s: %s", pid, path.c_str(), strerror(errno));
+        return false;
+    }
+    return ret >= 0;
+}
+
+/* Called with mLock held, screen off */
+void ProcessMigrator::migrate(pid_t pid)
+{
+    std::string cpuset;
+
+    if (mMigrated.count(pid) || !cpusetOf(pid, cpuset) || cpuset == mGroup)
+        return;
+    if (move(pid, mGroup))
+        mMigrated[pid] = cpuset;
+}
+
+size_t ProcessMigrator::scan()
+{
+    std::set<pid_t> tracked;
+    struct dirent *de;
+    size_t count;
+    DIR *dir;
+
+    /* taken before mLock, and held for the whole walk */
+    pthread_mutex_lock(&mScanLock);
+    pthread_mutex_lock(&mLock);
+    mExecd.clear();
+    mScanning = true;
+    pthread_mutex_unlock(&mLock);
+
+    dir = SysfsIo::opendir("/proc");
+    if (dir == NULL)
+        ALOGE("Could not open /proc: %s", strerror(errno));
+    while (dir && (de = readdir(dir))) {
+        pid_t pid;
+
+        if (!isdigit((unsigned char)de->d_name[0]))
+            continue;
+        pid = atoi(de->d_name);
+        if (matchName(pid))
+            tracked.insert(pid);
+    }
+    if (dir)
+        closedir(dir);
+
+    /* keep what was exec'd behind the walk's back */
+    pthread_mutex_lock(&mLock);
+    tracked.insert(mExecd.begin(), mExecd.end());
+    mTracked.swap(tracked);
+    mScanning = false;
+    count = mTracked.size();
+    pthread_mutex_unlock(&mLock);
+    pthread_mutex_unlock(&mScanLock);
+
+    return count;
+}
+
+bool ProcessMigrator::listening()
+{
+    bool ret;
+
+    pthread_mutex_lock(&mLock);
+    ret = mListening;
+    pthread_mutex_unlock(&mLock);
+    return ret;
+}
+
+/*
+ * Joins the proc connector multicast group. A socket filter keeps fork,
+ * uid and other events in the kernel, so only exec and exit (and the
+ * subscription ack) ever wake the listener.
+ */
+int ProcessMigrator::startListener()
+{
+    const unsigned int what = NLMSG_LENGTH(0) + offsetof(struct cn_msg, data) +
+                              offsetof(struct proc_event, what);
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, what),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(proc_event::PROC_EVENT_EXEC), 3, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(proc_event::PROC_EVENT_EXIT), 2, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(proc_event::PROC_EVENT_NONE), 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+        BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+    };
+    struct sock_fprog filter = { sizeof(code) / sizeof(code[0]), code };
+    char req[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))]
+        __attribute__((aligned(NLMSG_ALIGNTO)));
+    struct nlmsghdr *hdr = (struct nlmsghdr *) req;
+    struct cn_msg *msg = (struct cn_msg *) NLMSG_DATA(hdr);
+    enum proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+    struct sockaddr_nl addr;
+    int size = EVENT_BUFFER_SIZE;
+
+    mSocket = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (mSocket < 0)
+        goto error;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = CN_IDX_PROC;
+    addr.nl_pid = 0;
+    if (bind(mSocket, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+        goto error;
+    if (setsockopt(mSocket, SOL_SOCKET, SO_ATTACH_FILTER, &filter, sizeof(filter)) < 0)
+        ALOGW("Could not filter proc events: %s", strerror(errno));
+    setsockopt(mSocket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    memset(req, 0, sizeof(req));
+    hdr->nlmsg_len = NLMSG_LENGTH(sizeof(*msg) + sizeof(op));
+    hdr->nlmsg_type = NLMSG_DONE;
+    hdr->nlmsg_pid = getpid();
+    msg->id.idx = CN_IDX_PROC;
+    msg->id.val = CN_VAL_PROC;
+    msg->len = sizeof(op);
+    memcpy(msg->data, &op, sizeof(op));
+    if (send(mSocket, req, hdr->nlmsg_len, 0) < 0)
+        goto error;
+
+    mStopFd = eventfd(0, EFD_CLOEXEC);
+    if (mStopFd < 0)
+        goto error;
+    if (pthread_create(&mThread, NULL, listenLoop, this)) {
+        ALOGE("%s: could not create listener thread", __func__);
+        close(mStopFd);
+        mStopFd = -1;
+        close(mSocket);
+        mSocket = -1;
+        return -1;
+    }
+    pthread_setname_np(mThread, "powerhal_procmig");
+    return 0;
+
+error:
+    ALOGW("No proc connector (%s), walking /proc at screen-off", strerror(errno));
+    if (mSocket >= 0)
+        close(mSocket);
+    mSocket = -1;
+    return -1;
+}
+
+/* Reads one datagram of events; a hard error ends listening */
+void ProcessMigrator::handleEvents()
+{
+    char buf[4096] __attribute__((aligned(NLMSG_ALIGNTO)));
+    struct nlmsghdr *hdr;
+    ssize_t len;
+
+    len = recv(mSocket, buf, sizeof(buf), 0);
+    if (len < 0) {
+        if (errno == ENOBUFS) {
+            /* events were dropped, the tracked set can not be trusted */
+            pthread_mutex_lock(&mLock);
+            mResync = true;
+            pthread_mutex_unlock(&mLock);
+        } else if (errno != EINTR) {
+            ALOGE("%s: recv failed: %s", __func__, strerror(errno));
+            pthread_mutex_lock(&mLock);
+            mListening = false;
+            pthread_mutex_unlock(&mLock);
+        }
+        return;
+    }
+
+    for (hdr = (struct nlmsghdr *) buf; NLMSG_OK(hdr, (size_t)len); hdr = NLMSG_NEXT(hdr, len)) {
+        struct cn_msg *msg = (struct cn_msg *) NLMSG_DATA(hdr);
+        struct proc_event *event = (struct proc_event *) msg->data;
+
+        if (msg->id.idx != CN_IDX_PROC || msg->id.val != CN_VAL_PROC)
+            continue;
+
+        if (event->what == proc_event::PROC_EVENT_EXEC) {
+            pid_t pid = event->event_data.exec.process_tgid;
+
+            /* read outside the lock, the process may be gone by now anyway */
+            if (event->event_data.exec.process_pid != pid || !matchName(pid))
+                continue;
+            pthread_mutex_lock(&mLock);
+            mTracked.insert(pid);
+            if (mScanning)
+                mExecd.push_back(pid);
+            if (!mInteractive)
+                migrate(pid);
+            pthread_mutex_unlock(&mLock);
+            ALOGV("tracking %d", pid);
+        } else if (event->what == proc_event::PROC_EVENT_EXIT) {
+            pid_t pid = event->event_data.exit.process_tgid;
+
+            if (event->event_data.exit.process_pid != pid)
+                continue;
+            pthread_mutex_lock(&mLock);
+            mTracked.erase(pid);
+            mMigrated.erase(pid);
+            if (mScanning)
+                mExecd.erase(std::remove(mExecd.begin(), mExecd.end(), pid), mExecd.end());
+            pthread_mutex_unlock(&mLock);
+        }
+    }
+}
+
+void *ProcessMigrator::listenLoop(void *arg)
+{
+    ProcessMigrator *self = (ProcessMigrator *) arg;
+    struct pollfd fds[2];
+    bool resync;
+
+    fds[0].fd = self->mSocket;
+    fds[0].events = POLLIN;
+    fds[1].fd = self->mStopFd;
+    fds[1].events = POLLIN;
+
+    while (self->listening()) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            ALOGE("%s: poll failed: %s", __func__, strerror(errno));
+            break;
+        }
+        if (fds[1].revents & POLLIN)
+            return NULL;
+        if (fds[0].revents & POLLIN)
+            self->handleEvents();
+
+        pthread_mutex_lock(&self->mLock);
+        resync = self->mResync;
+        self->mResync = false;
+        pthread_mutex_unlock(&self->mLock);
+        if (resync)
+            self->scan();
+    }
+
+    pthread_mutex_lock(&self->mLock);
+    self->mListening = false;
+    pthread_mutex_unlock(&self->mLock);
+    ALOGW("proc connector lost, walking /proc at screen-off");
+    return NULL;
+}
+
+void ProcessMigrator::init()
+{
+    loadConfig(MIGRATE_CONFIG);
+    for (size_t i = 0; i < mTargets.size(); i++)
+        mHasNames |= !mTargets[i].cgroup;
+    if (!mHasNames)
+        return;
+
+    /* listen first so nothing exec'd during the walk is missed */
+    pthread_mutex_lock(&mLock);
+    mListening = true;
+    pthread_mutex_unlock(&mLock);
+    if (startListener()) {
+        pthread_mutex_lock(&mLock);
+        mListening = false;
+        pthread_mutex_unlock(&mLock);
+    }
+    ALOGI("tracking %zu processes to migrate", scan());
+}
+
+void ProcessMigrator::setState(int state)
+{
+    std::vector<std::pair<pid_t, std::string> > procs;
+    std::set<pid_t>::iterator it;
+    struct timespec start, end;
+    size_t count;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!state) {
+        if (mHasNames && !listening())
+            scan();
+        collectCgroups(procs);
+    }
+
+    pthread_mutex_lock(&mLock);
+    mInteractive = state;
+    if (state) {
+        std::map<pid_t, std::string>::iterator m;
+        std::string cpuset;
+
+        count = 0;
+        for (m = mMigrated.begin(); m != mMigrated.end(); m++) {
+            /* the framework moved it meanwhile, its choice stands */
+            if (!cpusetOf(m->first, cpuset) || cpuset != mGroup) {
+                ALOGV("%d no longer in %s, not restoring it", m->first, mGroup.c_str());
+                continue;
+            }
+            if (move(m->first, m->second))
+                count++;
+        }
+        mMigrated.clear();
+    } else {
+        for (it = mTracked.begin(); it != mTracked.end(); it++)
+            migrate(*it);
+        for (size_t i = 0; i < procs.size(); i++) {
+            if (!mMigrated.count(procs[i].first) && move(procs[i].first, mGroup))
+                mMigrated[procs[i].first] = procs[i].second;
+        }
+        count = mMigrated.size();
+    }
+    pthread_mutex_unlock(&mLock);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ALOGD("%s %zu processes in %ld us", state ? "restored" : "migrated", count,
+          (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_nsec - start.tv_nsec) / 1000);
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_PROCESS_MIGRATOR_H
+#define ANDROID_PROCESS_MIGRATOR_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/types.h>
+
+/**
+ * Moves selected processes into the non_interactive cpuset while the
+ * screen is off and back where they were when it comes on, unless
+ * something else moved them out of non_interactive in between. Processes are
+ * picked by the name they exec'd ("name <glob>") or by the cpuset they
+ * live in ("cgroup <glob>").
+ *
+ * Named processes are tracked from proc connector exec/exit events, so
+ * restarts are picked up and /proc is only walked once at init(), or again
+ * if events were lost. Cgroup members are read from the cgroup's own
+ * cgroup.procs at screen-off. Without the proc connector, /proc is walked
+ * at every screen-off instead.
+ */
+class ProcessMigrator {
+
+  public:
+      ProcessMigrator(const char *cpusetRoot = "/dev/cpuset");
+      virtual ~ProcessMigrator();
+      void init();
+      void setState(int state);
+      /* walks /proc for named processes; returns how many are tracked */
+      size_t scan();
+      bool listening();
+
+  private:
+      struct Target {
+          bool cgroup;
+          std::string pattern;
+      };
+
+      std::string mRoot;
+      std::string mGroup;
+      std::vector<Target> mTargets;
+      /* named processes by tgid */
+      std::set<pid_t> mTracked;
+      /* moved at screen-off, with the cpuset each came from */
+      std::map<pid_t, std::string> mMigrated;
+      /* exec'd while a walk of /proc was running */
+      std::vector<pid_t> mExecd;
+      bool mScanning;
+      bool mHasNames;
+      bool mInteractive;
+      pthread_mutex_t mLock;
+      /* one walk at a time: the listener resyncs while setState() may walk */
+      pthread_mutex_t mScanLock;
+      int mSocket;
+      int mStopFd;
+      pthread_t mThread;
+      bool mListening;
+      bool mResync;
+
+      void loadConfig(const char *path);
+      bool matchName(pid_t pid);
+      bool cpusetOf(pid_t pid, std::string &cpuset);
+      void collectCgroups(std::vector<std::pair<pid_t, std::string> > &procs);
+      bool move(pid_t pid, const std::string &cpuset);
+      void migrate(pid_t pid);
+      int startListener();
+      void handleEvents();
+      static void *listenLoop(void *arg);
+};
+#endif  // ANDROID_PROCESS_MIGRATOR_H
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "PowerHAL"
+
+#include "PropertyCache.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/system_properties.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+struct Subscription {
+    std::string prefix;
+    PropertyCache::listener_t listener;
+    void *cookie;
+};
+
+static pthread_mutex_t sLock = PTHREAD_MUTEX_INITIALIZER;
+static bool sStarted;
+
+/*
+ * Built on first use, as CachedProperty statics of other files register
+ * during static initialization, and never destroyed, as the watcher may
+ * still run while statics are torn down.
+ */
+static std::vector<CachedProperty *> &properties()
+{
+    static std::vector<CachedProperty *> *list = new std::vector<CachedProperty *>;
+
+    return *list;
+}
+
+static std::vector<Subscription> &subscriptions()
+{
+    static std::vector<Subscription> *list = new std::vector<Subscription>;
+
+    return *list;
+}
+
+/* As property_get_bool() reads it; anything else is false */
+static bool parse_bool(const char *value)
+{
+    return !strcmp(value, "1") || !strcmp(value, "y") || !strcmp(value, "yes") ||
+           !strcmp(value, "on") || !strcmp(value, "true");
+}
+
+CachedProperty::CachedProperty(const char *name, const char *defaultValue):
+    mName(name), mDefault(defaultValue ? defaultValue : ""), mInfo(NULL), mSerial(0),
+    mSet(false), mInt(0), mDouble(0), mBool(false)
+{
+    pthread_mutex_init(&mLock, NULL);
+    /* the serial first, so a write racing the read is seen next time */
+    mInfo = __system_property_find(mName);
+    if (mInfo)
+        mSerial = __system_property_serial(mInfo);
+    property_get(mName, mValue, "");
+    parse();
+    PropertyCache::add(this);
+}
+
+CachedProperty::~CachedProperty()
+{
+    PropertyCache::remove(this);
+    pthread_mutex_destroy(&mLock);
+}
+
+/* Called with mLock held, or before the property is published */
+void CachedProperty::parse()
+{
+    const char *value = mValue[0] ? mValue : mDefault;
+
+    mInt.store(atoi(value), std::memory_order_relaxed);
+    mDouble.store(atof(value), std::memory_order_relaxed);
+    mBool.store(parse_bool(value), std::memory_order_relaxed);
+    mSet.store(mValue[0] != '\0', std::memory_order_relaxed);
+}
+
+std::string CachedProperty::value() const
+{
+    std::string value;
+
+    pthread_mutex_lock(&mLock);
+    value = mValue[0] ? mValue : mDefault;
+    pthread_mutex_unlock(&mLock);
+    return value;
+}
+
+/*
+ * Rereads the property if its serial moved; true if the value changed.
+ * Only PropertyCache calls it, with its lock held.
+ */
+bool CachedProperty::refresh()
+{
+    char value[PROPERTY_VALUE_MAX];
+    bool changed;
+    uint32_t serial;
+
+    if (mInfo != NULL) {
+        serial = __system_property_serial(mInfo);
+        if (serial == mSerial)
+            return false;
+    } else {
+        /* properties are never deleted, one not found is still unset */
+        mInfo = __system_property_find(mName);
+        if (mInfo == NULL)
+            return false;
+        serial = __system_property_serial(mInfo);
+    }
+    mSerial = serial;
+
+    property_get(mName, value, "");
+    pthread_mutex_lock(&mLock);
+    changed = strcmp(value, mValue) != 0;
+    if (changed) {
+        strcpy(mValue, value);
+        parse();
+    }
+    pthread_mutex_unlock(&mLock);
+    return changed;
+}
+
+void PropertyCache::add(CachedProperty *property)
+{
+    pthread_mutex_lock(&sLock);
+    properties().push_back(property);
+    pthread_mutex_unlock(&sLock);
+}
+
+void PropertyCache::remove(CachedProperty *property)
+{
+    std::vector<CachedProperty *> &list = properties();
+
+    pthread_mutex_lock(&sLock);
+    list.erase(std::remove(list.begin(), list.end(), property), list.end());
+    pthread_mutex_unlock(&sLock);
+}
+
+void PropertyCache::subscribe(const char *prefix, listener_t listener, void *cookie)
+{
+    Subscription subscription = { prefix, listener, cookie };
+
+    pthread_mutex_lock(&sLock);
+    subscriptions().push_back(subscription);
+    pthread_mutex_unlock(&sLock);
+}
+
+/*
+ * Rereads the cached properties whose serial moved and runs the listeners
+ * of those that changed. Listeners run without the lock, so they may read properties
+ * and subscribe.
+ */
+void PropertyCache::refresh()
+{
+    std::vector<CachedProperty *> &list = properties();
+    std::vector<Subscription> &subscribed = subscriptions();
+    std::vector<Subscription> notify;
+    std::vector<bool> due;
+
+    pthread_mutex_lock(&sLock);
+    due.resize(subscribed.size());
+    for (size_t i = 0; i < list.size(); i++) {
+        if (!list[i]->refresh())
+            continue;
+        ALOGI("property %s changed", list[i]->name());
+        for (size_t j = 0; j < subscribed.size(); j++) {
+            const std::string &prefix = subscribed[j].prefix;
+
+            if (!strncmp(list[i]->name(), prefix.c_str(), prefix.size()))
+                due[j] = true;
+        }
+    }
+    for (size_t j = 0; j < subscribed.size(); j++) {
+        if (due[j])
+            notify.push_back(subscribed[j]);
+    }
+    pthread_mutex_unlock(&sLock);
+
+    for (size_t i = 0; i < notify.size(); i++)
+        notify[i].listener(notify[i].cookie);
+}
+
+/* Catches up with changes made before the HAL started, then watches */
+int PropertyCache::start()
+{
+    pthread_t thread;
+
+    refresh();
+
+    pthread_mutex_lock(&sLock);
+    if (sStarted) {
+        pthread_mutex_unlock(&sLock);
+        return 0;
+    }
+    if (pthread_create(&thread, NULL, watchLoop, NULL)) {
+        pthread_mutex_unlock(&sLock);
+        ALOGE("%s: could not create property watcher", __func__);
+        return -1;
+    }
+    pthread_detach(thread);
+    pthread_setname_np(thread, "powerhal_props");
+    sStarted = true;
+    pthread_mutex_unlock(&sLock);
+    return 0;
+}
+
+void *PropertyCache::watchLoop(void __attribute__((unused)) *arg)
+{
+    uint32_t serial = __system_property_area_serial();
+
+    /* a change between start()'s refresh and reading the serial */
+    refresh();
+    for (;;) {
+        if (!__system_property_wait(NULL, serial, &serial, NULL)) {
+            ALOGE("%s: property wait failed, polling", __func__);
+            sleep(1);
+            serial = __system_property_area_serial();
+        }
+        refresh();
+    }
+    return NULL;
+}
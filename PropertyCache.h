@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_PROPERTY_CACHE_H
+#define ANDROID_PROPERTY_CACHE_H
+
+#include <atomic>
+#include <string>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/system_properties.h>
+
+#include <cutils/properties.h>
+
+/**
+ * A property resolved once and kept parsed, so hot and polling paths read
+ * an atomic instead of calling property_get(). The default stands in while
+ * the property is unset or empty. PropertyCache refreshes every instance
+ * when properties change; one whose own serial did not move is not read.
+ */
+class CachedProperty {
+
+  public:
+      CachedProperty(const char *name, const char *defaultValue = "");
+      virtual ~CachedProperty();
+      const char *name() const { return mName; };
+      bool isSet() const { return mSet.load(std::memory_order_relaxed); };
+      int intValue() const { return mInt.load(std::memory_order_relaxed); };
+      double doubleValue() const { return mDouble.load(std::memory_order_relaxed); };
+      bool boolValue() const { return mBool.load(std::memory_order_relaxed); };
+      std::string value() const;
+      bool refresh();
+
+  private:
+      const char *mName;
+      const char *mDefault;
+      char mValue[PROPERTY_VALUE_MAX];
+      /* NULL until the property is first set; both owned by refresh() */
+      const prop_info *mInfo;
+      uint32_t mSerial;
+      mutable pthread_mutex_t mLock;
+      std::atomic<bool> mSet;
+      std::atomic<int> mInt;
+      std::atomic<double> mDouble;
+      std::atomic<bool> mBool;
+
+      void parse();
+};
+
+/**
+ * Keeps the CachedProperty instances current. A watcher thread sleeps on
+ * the property area serial and, after any property change, rereads those
+ * whose own serial moved, so unrelated churn costs a serial load each;
+ * listeners subscribed to a name or prefix then run on that thread, once
+ * per refresh however many of their properties changed. Listeners that
+ * touch state owned by another thread should hand the work over to it.
+ */
+class PropertyCache {
+
+  public:
+      typedef void (*listener_t)(void *cookie);
+
+      static int start();
+      static void refresh();
+      static void subscribe(const char *prefix, listener_t listener, void *cookie = NULL);
+      static void add(CachedProperty *property);
+      static void remove(CachedProperty *property);
+
+  private:
+      PropertyCache() {};
+      static void *watchLoop(void *arg);
+};
+#endif  // ANDROID_PROPERTY_CACHE_H
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "SysfsIo.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+std::string SysfsIo::sRoot;
+std::atomic<SysfsIo::fault_hook_t> SysfsIo::sFaultHook(NULL);
+
+void SysfsIo::setRoot(const char *root)
+{
+    sRoot = root ? root : "";
+    /* "/" and "" both mean no redirection */
+    while (!sRoot.empty() && sRoot[sRoot.size() - 1] == '/')
+        sRoot.erase(sRoot.size() - 1);
+    if (!sRoot.empty())
+        ALOGW("file system access redirected to %s", sRoot.c_str());
+}
+
+std::string SysfsIo::resolve(const char *path)
+{
+    if (sRoot.empty() || path[0] != '/')
+        return path;
+    return sRoot + path;
+}
+
+/* Sets errno and returns -1 when the hook wants the operation to fail */
+int SysfsIo::fault(const char *path, enum sysfs_op op)
+{
+    fault_hook_t hook = sFaultHook.load(std::memory_order_acquire);
+    int err;
+
+    if (hook == NULL || (err = hook(path, op)) == 0)
+        return 0;
+
+    errno = err;
+    return -1;
+}
+
+int SysfsIo::open(const char *path, int flags, mode_t mode)
+{
+    if (fault(path, SYSFS_OP_OPEN))
+        return -1;
+    if (sRoot.empty())
+        return ::open(path, flags, mode);
+    return ::open(resolve(path).c_str(), flags, mode);
+}
+
+ssize_t SysfsIo::pread(int fd, void *buf, size_t len, off_t off, const char *path)
+{
+    if (fault(path, SYSFS_OP_READ))
+        return -1;
+    return ::pread(fd, buf, len, off);
+}
+
+ssize_t SysfsIo::pwrite(int fd, const void *buf, size_t len, off_t off, const char *path)
+{
+    ssize_t ret;
+
+    if (fault(path, SYSFS_OP_WRITE))
+        return -1;
+    ret = ::pwrite(fd, buf, len, off);
+    /* a sysfs store replaces the value, a regular file keeps the old tail */
+    if (ret >= 0 && !sRoot.empty() && ftruncate(fd, off + ret) && errno != EINVAL)
+        return -1;
+    return ret;
+}
+
+DIR *SysfsIo::opendir(const char *path)
+{
+    if (fault(path, SYSFS_OP_OPEN))
+        return NULL;
+    return ::opendir(resolve(path).c_str());
+}
+
+FILE *SysfsIo::fopen(const char *path, const char *mode)
+{
+    if (fault(path, SYSFS_OP_OPEN))
+        return NULL;
+    return ::fopen(resolve(path).c_str(), mode);
+}
+
+int SysfsIo::access(const char *path, int mode)
+{
+    return ::access(resolve(path).c_str(), mode);
+}
+
+int SysfsIo::stat(const char *path, struct stat *st)
+{
+    return ::stat(resolve(path).c_str(), st);
+}
+
+int SysfsIo::addWatch(int fd, const char *path, uint32_t mask)
+{
+    return inotify_add_watch(fd, resolve(path).c_str(), mask);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SYSFS_IO_H
+#define ANDROID_SYSFS_IO_H
+
+#include <atomic>
+#include <string>
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+enum sysfs_op {
+    SYSFS_OP_OPEN = 0,
+    SYSFS_OP_READ,
+    SYSFS_OP_WRITE,
+};
+
+/**
+ * Every file the HAL touches goes through here. Paths in the HAL stay the
+ * absolute on-device ones and are only prefixed with the root at the
+ * syscall, so the whole HAL can run against a generated tree. A fault hook
+ * may add latency (by sleeping) or fail an operation with an errno.
+ *
+ * The root is set once, before power_init() starts any thread.
+ */
+class SysfsIo {
+
+  public:
+      /* returns 0, or the errno the operation should fail with */
+      typedef int (*fault_hook_t)(const char *path, enum sysfs_op op);
+
+      static void setRoot(const char *root);
+      static const std::string &root() { return sRoot; };
+      static std::string resolve(const char *path);
+      static void setFaultHook(fault_hook_t hook) { sFaultHook.store(hook, std::memory_order_release); };
+
+      static int open(const char *path, int flags, mode_t mode = 0);
+      static ssize_t pread(int fd, void *buf, size_t len, off_t off, const char *path);
+      static ssize_t pwrite(int fd, const void *buf, size_t len, off_t off, const char *path);
+      static DIR *opendir(const char *path);
+      static FILE *fopen(const char *path, const char *mode);
+      static int access(const char *path, int mode);
+      static int stat(const char *path, struct stat *st);
+      static int addWatch(int fd, const char *path, uint32_t mask);
+
+  private:
+      static std::string sRoot;
+      static std::atomic<fault_hook_t> sFaultHook;
+
+      SysfsIo() {};
+      static int fault(const char *path, enum sysfs_op op);
+};
+#endif  // ANDROID_SYSFS_IO_H
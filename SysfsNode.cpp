@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "SysfsNode.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+#include "HintTrace.h"
+#include "PowerStats.h"
+#include "SysfsIo.h"
+
+static bool node_gone(int err)
+{
+    return err == ESTALE || err == ENOENT || err == ENODEV;
+}
+
+SysfsNode::SysfsNode(const char *path):
+    mPath(path), mFd(-1), mTraceId(HintTrace::nodeId(path))
+{
+    pthread_mutex_init(&mLock, NULL);
+}
+
+SysfsNode::~SysfsNode()
+{
+    close();
+    pthread_mutex_destroy(&mLock);
+}
+
+int SysfsNode::open()
+{
+    char buf[80];
+    int fd;
+
+    pthread_mutex_lock(&mLock);
+    if (mFd >= 0) {
+        pthread_mutex_unlock(&mLock);
+        return 0;
+    }
+
+    fd = SysfsIo::open(mPath.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0 && errno == EACCES)
+        fd = SysfsIo::open(mPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error opening %s: %s\n", mPath.c_str(), buf);
+        pthread_mutex_unlock(&mLock);
+        return -1;
+    }
+    mFd = fd;
+    pthread_mutex_unlock(&mLock);
+    return 0;
+}
+
+void SysfsNode::close()
+{
+    pthread_mutex_lock(&mLock);
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+/* Drop a descriptor that went stale and open the node again. */
+int SysfsNode::reopen(int fd)
+{
+    pthread_mutex_lock(&mLock);
+    if (mFd == fd && fd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+    pthread_mutex_unlock(&mLock);
+    return open();
+}
+
+int SysfsNode::write(const char *s)
+{
+    char buf[80];
+    size_t len = strlen(s);
+    ssize_t ret;
+    int fd = mFd;
+    uint64_t traced = 0;
+    int64_t start;
+
+    if (HintTrace::enabled()) {
+        memcpy(&traced, s, len < sizeof(traced) ? len : sizeof(traced));
+        HintTrace::record(TRACE_SYSFS_WRITE, mTraceId, traced);
+    }
+
+    if (fd < 0) {
+        if (open())
+            return -1;
+        fd = mFd;
+    }
+
+    start = PowerStats::now();
+    ret = SysfsIo::pwrite(fd, s, len, 0, mPath.c_str());
+    if (ret < 0 && node_gone(errno)) {
+        if (reopen(fd))
+            return -1;
+        ret = SysfsIo::pwrite(mFd, s, len, 0, mPath.c_str());
+    }
+    PowerStats::recordNode(mTraceId, PowerStats::now() - start);
+    if (ret < 0) {
+        PowerStats::count(STAT_SYSFS_ERRORS);
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error writing to %s: %s\n", mPath.c_str(), buf);
+        return -1;
+    }
+
+    return 0;
+}
+
+int SysfsNode::read(char *s, int length)
+{
+    char buf[80];
+    ssize_t ret;
+    int fd = mFd;
+
+    if (fd < 0) {
+        if (open())
+            return -1;
+        fd = mFd;
+    }
+
+    ret = SysfsIo::pread(fd, s, length, 0, mPath.c_str());
+    if (ret < 0 && node_gone(errno)) {
+        if (reopen(fd))
+            return -1;
+        ret = SysfsIo::pread(mFd, s, length, 0, mPath.c_str());
+    }
+    if (ret < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error reading from %s: %s\n", mPath.c_str(), buf);
+        return -1;
+    }
+
+    return ret;
+}
+
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* function-local so static SysfsNode pointers may be set up at load time */
+static std::map<std::string, SysfsNode *> &registry_nodes(void)
+{
+    static std::map<std::string, SysfsNode *> nodes;
+
+    return nodes;
+}
+
+SysfsNode *SysfsNodeRegistry::get(const char *path)
+{
+    std::map<std::string, SysfsNode *> &nodes = registry_nodes();
+    SysfsNode *node;
+
+    pthread_mutex_lock(&registryLock);
+    std::map<std::string, SysfsNode *>::iterator it = nodes.find(path);
+    if (it != nodes.end()) {
+        node = it->second;
+    } else {
+        node = new SysfsNode(path);
+        nodes[path] = node;
+    }
+    pthread_mutex_unlock(&registryLock);
+
+    return node;
+}
+
+/* Every node opens its file again on next use, e.g. under a new root */
+void SysfsNodeRegistry::closeAll()
+{
+    std::map<std::string, SysfsNode *> &nodes = registry_nodes();
+
+    pthread_mutex_lock(&registryLock);
+    for (std::map<std::string, SysfsNode *>::iterator it = nodes.begin(); it != nodes.end(); ++it)
+        it->second->close();
+    pthread_mutex_unlock(&registryLock);
+}
+
+int sysfs_write(const char *path, const char *s)
+{
+    return SysfsNodeRegistry::get(path)->write(s);
+}
+
+int sysfs_read(const char *path, char *s, int length)
+{
+    return SysfsNodeRegistry::get(path)->read(s, length) < 0 ? -1 : 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SYSFS_NODE_H
+#define ANDROID_SYSFS_NODE_H
+
+#include <atomic>
+#include <string>
+#include <map>
+
+#include <pthread.h>
+#include <sys/types.h>
+
+/**
+ * A sysfs knob that is opened once and then accessed with pread/pwrite.
+ * The descriptor is reopened transparently if the kernel node went away
+ * (ESTALE/ENOENT/ENODEV) underneath us.
+ */
+class SysfsNode {
+
+  public:
+      SysfsNode(const char *path);
+      virtual ~SysfsNode();
+      int open();
+      void close();
+      int write(const char *s);
+      int read(char *s, int length);
+      bool isOpen() const { return mFd >= 0; };
+      const char *path() const { return mPath.c_str(); };
+
+  private:
+      std::string mPath;
+      std::atomic<int> mFd;
+      int mTraceId;
+      pthread_mutex_t mLock;
+      int reopen(int fd);
+};
+
+/**
+ * Owns every SysfsNode the HAL touches, keyed by path. Nodes are never
+ * freed, so callers may cache the returned pointers.
+ */
+class SysfsNodeRegistry {
+
+  public:
+      static SysfsNode *get(const char *path);
+      static void closeAll();
+
+  private:
+      SysfsNodeRegistry() {};
+};
+
+int sysfs_write(const char *path, const char *s);
+int sysfs_read(const char *path, char *s, int length);
+
+#endif  // ANDROID_SYSFS_NODE_H
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "ThermalClient.h"
+
+#include <errno.h>
+#include <time.h>
+
+#include <cutils/log.h>
+
+ThermalClient::ThermalClient(Transport *transport):
+    mTransport(transport), mStarted(false), mStopping(false), mConnected(false),
+    mWanted(-1), mSent(-1), mDeaths(0), mMessages(0)
+{
+    pthread_condattr_t attr;
+
+    pthread_mutex_init(&mLock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+ThermalClient::~ThermalClient()
+{
+    if (mStarted) {
+        pthread_mutex_lock(&mLock);
+        mStopping = true;
+        pthread_cond_signal(&mCond);
+        pthread_mutex_unlock(&mLock);
+        pthread_join(mThread, NULL);
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mLock);
+}
+
+int ThermalClient::start()
+{
+    if (mTransport == NULL || mStarted)
+        return mStarted ? 0 : -1;
+
+    if (pthread_create(&mThread, NULL, connectLoop, this)) {
+        ALOGE("%s: could not create thermal client thread", __func__);
+        return -1;
+    }
+    pthread_setname_np(mThread, "powerhal_thd");
+    mStarted = true;
+    return 0;
+}
+
+/* Called with mLock held and connected */
+void ThermalClient::send()
+{
+    if (mWanted < 0 || mWanted == mSent)
+        return;
+
+    if (mTransport->sendPowerSave(mWanted)) {
+        ALOGE("%s: power save %d not delivered, reconnecting", __func__, mWanted);
+        mConnected = false;
+        mSent = -1;
+        pthread_cond_signal(&mCond);
+        return;
+    }
+    mSent = mWanted;
+    mMessages.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+ * Returns 0 when the state is, or will be once connected, with the daemon;
+ * -1 when there is no daemon to talk to.
+ */
+int ThermalClient::setPowerSave(bool on)
+{
+    if (mTransport == NULL)
+        return -1;
+
+    pthread_mutex_lock(&mLock);
+    mWanted = on;
+    if (mConnected)
+        send();
+    pthread_mutex_unlock(&mLock);
+    return 0;
+}
+
+void ThermalClient::onDeath()
+{
+    ALOGW("thermal daemon died, reconnecting");
+    pthread_mutex_lock(&mLock);
+    mConnected = false;
+    mSent = -1;
+    mDeaths++;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mLock);
+}
+
+bool ThermalClient::connected()
+{
+    bool ret;
+
+    pthread_mutex_lock(&mLock);
+    ret = mConnected;
+    pthread_mutex_unlock(&mLock);
+    return ret;
+}
+
+void *ThermalClient::connectLoop(void *arg)
+{
+    ThermalClient *self = (ThermalClient *) arg;
+    unsigned int backoffMs = MIN_BACKOFF_MS;
+    unsigned int attempts = 0;
+    unsigned int deaths;
+    struct timespec deadline;
+
+    pthread_mutex_lock(&self->mLock);
+    while (!self->mStopping) {
+        if (self->mConnected) {
+            pthread_cond_wait(&self->mCond, &self->mLock);
+            continue;
+        }
+
+        /* the lookup may block, keep hints flowing meanwhile */
+        deaths = self->mDeaths;
+        pthread_mutex_unlock(&self->mLock);
+        int ret = self->mTransport->connect(self);
+        pthread_mutex_lock(&self->mLock);
+
+        /* a death reported while connecting was about this connection */
+        if (ret == 0 && deaths == self->mDeaths) {
+            self->mConnected = true;
+            self->mSent = -1;
+            self->send();
+        }
+        if (self->mConnected) {
+            ALOGI("thermal daemon connected after %u attempts", attempts + 1);
+            backoffMs = MIN_BACKOFF_MS;
+            attempts = 0;
+            continue;
+        }
+
+        if (attempts++ == 0)
+            ALOGW("thermal daemon not published, retrying in the background");
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += backoffMs / 1000;
+        deadline.tv_nsec += (backoffMs % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (!self->mStopping &&
+               pthread_cond_timedwait(&self->mCond, &self->mLock, &deadline) != ETIMEDOUT)
+            ;
+        backoffMs = backoffMs * 2 > MAX_BACKOFF_MS ? MAX_BACKOFF_MS : backoffMs * 2;
+    }
+    pthread_mutex_unlock(&self->mLock);
+    return NULL;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_THERMAL_CLIENT_H
+#define ANDROID_THERMAL_CLIENT_H
+
+#include <atomic>
+
+#include <pthread.h>
+
+/**
+ * Connection to the thermal daemon that never blocks the HAL. A background
+ * thread looks the service up with backoff and again whenever it dies.
+ * setPowerSave() only records the wanted state: it is sent when it differs
+ * from what the daemon last got, as a oneway message, and sent again after
+ * every reconnect since a restarted daemon starts over.
+ *
+ * The transport hides binder, so the state handling builds and runs
+ * without it.
+ */
+class ThermalClient {
+
+  public:
+      class Transport {
+        public:
+          virtual ~Transport() {};
+          /* returns 0 once connected; a lost connection calls client->onDeath() */
+          virtual int connect(ThermalClient *client) = 0;
+          virtual int sendPowerSave(bool on) = 0;
+      };
+
+      ThermalClient(Transport *transport);
+      virtual ~ThermalClient();
+      int start();
+      int setPowerSave(bool on);
+      void onDeath();
+      bool connected();
+      /* false without a transport, in builds with no thermald */
+      bool available() const { return mTransport != NULL; };
+      unsigned long messages() const { return mMessages.load(std::memory_order_relaxed); };
+
+  private:
+      static const unsigned int MIN_BACKOFF_MS = 500;
+      static const unsigned int MAX_BACKOFF_MS = 30000;
+
+      Transport *mTransport;
+      pthread_mutex_t mLock;
+      pthread_cond_t mCond;
+      pthread_t mThread;
+      bool mStarted;
+      bool mStopping;
+      bool mConnected;
+      /* -1 until asked for / while the daemon's state is unknown */
+      int mWanted;
+      int mSent;
+      unsigned int mDeaths;
+      std::atomic<unsigned long> mMessages;
+
+      void send();
+      static void *connectLoop(void *arg);
+};
+
+#ifdef HAS_THD
+/* binder transport to thermald, in thd_binder_client.cpp */
+ThermalClient::Transport *thd_transport(void);
+#endif
+#endif  // ANDROID_THERMAL_CLIENT_H
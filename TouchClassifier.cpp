@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "TouchClassifier.h"
+
+#include <cutils/log.h>
+
+#define MS 1000000LL
+
+/*
+ * This parameter is to identify continuous touch/scroll events.
+ * Any two touch hints received between a 20 interval ms is
+ * considered as a scroll event.
+ */
+#define SHORT_TOUCH_TIME 20
+
+/*
+ * This parameter is to identify first touch events.
+ * Any two touch hints received after 100 ms is considered as
+ * a first touch event.
+ */
+#define LONG_TOUCH_TIME 100
+
+/*
+ * This parameter defines the number of vsync boost to be
+ * done after the finger release event.
+ */
+#define VSYNC_BOOST_COUNT 4
+
+/*
+ * This parameter defines the time between a touch and a vsync
+ * hint. the time if is > 30 ms, we do a vsync boost.
+ */
+#define VSYNC_TOUCH_TIME 30
+
+/* Continuous touches after which boosting stops, and the timer is set */
+#define SCROLL_TOUCHES 4
+#define FLING_TOUCHES 15
+
+/*
+ * The event period the legacy thresholds fit: an 80 Hz panel, with its
+ * usual jitter, gets SHORT_TOUCH_TIME and VSYNC_TOUCH_TIME back from the
+ * adaptive profile, and its event counts mean the same durations.
+ */
+#define REFERENCE_PERIOD_NS (12500 * 1000LL)
+
+static const struct TouchThresholds legacyThresholds = {
+    SHORT_TOUCH_TIME * MS,
+    LONG_TOUCH_TIME * MS,
+    SCROLL_TOUCHES,
+    FLING_TOUCHES,
+    VSYNC_TOUCH_TIME * MS,
+    VSYNC_BOOST_COUNT,
+};
+
+TouchClassifier::TouchClassifier():
+    mProfile(TOUCH_PROFILE_ADAPTIVE), mPeriodNs(0), mDeviationNs(0), mSamples(0),
+    mThresholds(legacyThresholds)
+{
+}
+
+const struct TouchThresholds &TouchClassifier::legacy()
+{
+    return legacyThresholds;
+}
+
+void TouchClassifier::setProfile(enum touch_profile profile)
+{
+    mProfile = profile;
+    update();
+}
+
+/* A known event period skips learning; 0 forgets what was learned */
+void TouchClassifier::seedPeriod(int64_t periodNs)
+{
+    if (periodNs <= 0) {
+        mSamples = 0;
+    } else {
+        mPeriodNs = periodNs;
+        mDeviationNs = periodNs / 8;
+        mSamples = LEARN_EVENTS;
+    }
+    update();
+}
+
+/*
+ * Gains of 1/8 and 1/4 as for TCP's srtt and rttvar. An interval far above
+ * the average is a pause or dropped events, not the panel's rate. The
+ * average starts from the shortest of the first few intervals, as a pause
+ * among them would set the outlier bound too high to ever catch it.
+ */
+void TouchClassifier::learn(int64_t intervalNs)
+{
+    int64_t err;
+
+    if (intervalNs <= 0)
+        return;
+    if (mSamples < SEED_EVENTS) {
+        if (mSamples == 0 || intervalNs < mPeriodNs) {
+            mPeriodNs = intervalNs;
+            mDeviationNs = intervalNs / 2;
+        }
+        mSamples++;
+        return;
+    }
+    if (intervalNs > 2 * mPeriodNs + 4 * mDeviationNs)
+        return;
+
+    err = intervalNs - mPeriodNs;
+    mPeriodNs += err / 8;
+    mDeviationNs += ((err < 0 ? -err : err) - mDeviationNs) / 4;
+    if (mSamples < LEARN_EVENTS && ++mSamples == LEARN_EVENTS)
+        ALOGI("touch events every %lld us, +-%lld us", (long long)mPeriodNs / 1000,
+              (long long)mDeviationNs / 1000);
+}
+
+/*
+ * Times follow the period with margin for its jitter; event counts are
+ * the legacy durations over the period. The gap that starts a gesture is
+ * a human pause, not a property of the panel, and stays.
+ */
+void TouchClassifier::update()
+{
+    struct TouchThresholds *t = &mThresholds;
+    int64_t period = mPeriodNs;
+
+    *t = legacyThresholds;
+    if (mProfile == TOUCH_PROFILE_LEGACY || !learned())
+        return;
+
+    t->shortNs = period + period / 4 + 4 * mDeviationNs;
+    if (t->shortNs > t->longNs / 2)
+        t->shortNs = t->longNs / 2;
+    t->releaseNs = t->shortNs + period;
+    t->scrollEvents = (SCROLL_TOUCHES * REFERENCE_PERIOD_NS + period / 2) / period;
+    if (t->scrollEvents < 1)
+        t->scrollEvents = 1;
+    t->flingEvents = (FLING_TOUCHES * REFERENCE_PERIOD_NS + period / 2) / period;
+    if (t->flingEvents <= t->scrollEvents)
+        t->flingEvents = t->scrollEvents + 1;
+}
+
+/* Returns whether this touch boosts */
+bool TouchClassifier::touch(struct TouchState *state, int64_t nowNs)
+{
+    const struct TouchThresholds &t = mThresholds;
+    int64_t diff = nowNs - state->lastTouchNs;
+
+    state->lastTouchNs = nowNs;
+    if (diff > t.longNs) {
+        state->vsyncBoost = false;
+        state->timerSet = false;
+        state->touchboostDisabled = false;
+        state->vsyncCount = 0;
+        state->consecutiveTouches = 0;
+        /* a new gesture picks up what was learned during the last */
+        update();
+        return true;
+    }
+
+    learn(diff);
+    if (diff < t.shortNs) {
+        state->consecutiveTouches++;
+        /* Simple touch: timer rate need not be changed here */
+        if (!state->touchboostDisabled && state->consecutiveTouches > t.scrollEvents)
+            state->touchboostDisabled = true;
+    }
+    /*
+     * Scrolling: timer rate reduced to increase sensitivity. No more touch
+     * boost after this
+     */
+    if (state->touchboostDisabled && state->consecutiveTouches > t.flingEvents)
+        state->timerSet = true;
+
+    return !state->touchboostDisabled;
+}
+
+/* Returns whether this vsync boosts: the first few after a scroll ends */
+bool TouchClassifier::vsync(struct TouchState *state, int64_t nowNs, bool on)
+{
+    if (state->touchboostDisabled && nowNs - state->lastTouchNs > mThresholds.releaseNs) {
+        state->timerSet = false;
+        state->vsyncBoost = true;
+        state->touchboostDisabled = false;
+        state->vsyncCount = mThresholds.vsyncBoosts;
+    }
+
+    if (!state->vsyncBoost || !on || state->vsyncCount <= 0)
+        return false;
+    if (--state->vsyncCount == 0)
+        state->vsyncBoost = false;
+    return true;
+}
+
+enum touch_gesture TouchClassifier::gesture(const struct TouchState &state)
+{
+    if (state.timerSet)
+        return TOUCH_FLING;
+    if (state.touchboostDisabled)
+        return TOUCH_SCROLL;
+    return TOUCH_TAP;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_TOUCH_CLASSIFIER_H
+#define ANDROID_TOUCH_CLASSIFIER_H
+
+#include <stdint.h>
+
+#include "PowerHalState.h"
+
+enum touch_profile {
+    TOUCH_PROFILE_ADAPTIVE = 0, /* thresholds follow the learned event rate */
+    TOUCH_PROFILE_LEGACY,       /* the fixed thresholds, whatever the rate */
+};
+
+enum touch_gesture {
+    TOUCH_TAP = 0,              /* every event boosts */
+    TOUCH_SCROLL,               /* boosting stopped until the finger lifts */
+    TOUCH_FLING,                /* a scroll that went on */
+};
+
+struct TouchThresholds {
+    int64_t shortNs;            /* closer events continue a gesture */
+    int64_t longNs;             /* a longer gap starts a new one */
+    int scrollEvents;           /* more continuing events are a scroll */
+    int flingEvents;            /* and more than this a fling */
+    int64_t releaseNs;          /* no event this long on a vsync: lifted */
+    int vsyncBoosts;            /* boosts on the vsyncs after a lift */
+};
+
+/**
+ * The tap/scroll/fling state machine behind touch and vsync boosts. The
+ * legacy thresholds were tuned for one touchscreen and, being fixed
+ * times and event counts, turn every gesture into a scroll on a faster
+ * digitizer. The adaptive profile keeps a moving average and mean
+ * deviation of the interval between events within a gesture, the way TCP
+ * estimates its round trip, and scales the thresholds with it so that
+ * they mean the same durations at any rate. Until enough events were seen
+ * it uses the legacy thresholds; new ones take effect at the next gesture.
+ *
+ * Dispatch thread only, like the touch state it updates.
+ */
+class TouchClassifier {
+
+  public:
+      TouchClassifier();
+      virtual ~TouchClassifier() {};
+      void setProfile(enum touch_profile profile);
+      void seedPeriod(int64_t periodNs);
+      bool touch(struct TouchState *state, int64_t nowNs);
+      bool vsync(struct TouchState *state, int64_t nowNs, bool on);
+      int64_t periodNs() const { return mPeriodNs; };
+      bool learned() const { return mSamples >= LEARN_EVENTS; };
+      const struct TouchThresholds &thresholds() const { return mThresholds; };
+      static enum touch_gesture gesture(const struct TouchState &state);
+      static const struct TouchThresholds &legacy();
+
+  private:
+      static const int SEED_EVENTS = 4;
+      static const int LEARN_EVENTS = 16;
+
+      enum touch_profile mProfile;
+      int64_t mPeriodNs;
+      int64_t mDeviationNs;
+      int mSamples;
+      struct TouchThresholds mThresholds;
+
+      void learn(int64_t intervalNs);
+      void update();
+};
+#endif  // ANDROID_TOUCH_CLASSIFIER_H
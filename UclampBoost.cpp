@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "UclampBoost.h"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+
+#include "SysfsIo.h"
+
+#ifndef SCHED_FLAG_KEEP_POLICY
+#define SCHED_FLAG_KEEP_POLICY 0x08
+#endif
+#ifndef SCHED_FLAG_KEEP_PARAMS
+#define SCHED_FLAG_KEEP_PARAMS 0x10
+#endif
+#ifndef SCHED_FLAG_UTIL_CLAMP_MIN
+#define SCHED_FLAG_UTIL_CLAMP_MIN 0x20
+#endif
+
+#define UCLAMP_CAPACITY 1024
+
+/* struct sched_attr as of the kernel's SCHED_ATTR_SIZE_VER1 */
+struct uclamp_attr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+    uint32_t sched_util_min;
+    uint32_t sched_util_max;
+};
+
+static UclampBoost::TaskClamp syscall_clamp;
+
+int UclampBoost::TaskClamp::get(pid_t tid, uint32_t *utilMin)
+{
+    struct uclamp_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    if (syscall(__NR_sched_getattr, tid, &attr, sizeof(attr), 0))
+        return -1;
+    *utilMin = attr.sched_util_min;
+    return 0;
+}
+
+/* Sets only the minimum clamp, leaving policy and priority alone */
+int UclampBoost::TaskClamp::set(pid_t tid, uint32_t utilMin)
+{
+    struct uclamp_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.sched_flags = SCHED_FLAG_KEEP_POLICY | SCHED_FLAG_KEEP_PARAMS | SCHED_FLAG_UTIL_CLAMP_MIN;
+    attr.sched_util_min = utilMin;
+    return syscall(__NR_sched_setattr, tid, &attr, 0);
+}
+
+UclampBoost::UclampBoost(const char *cpuctlRoot, const char *cpusetRoot, TaskClamp *clamp):
+    mCpuctlRoot(cpuctlRoot), mCpusetRoot(cpusetRoot), mMode(UCLAMP_NONE),
+    mClamp(clamp ? clamp : &syscall_clamp)
+{
+}
+
+/* The clamps only steer frequency through schedutil */
+bool UclampBoost::schedutil(const CpuTopology &topology)
+{
+    std::vector<CpufreqPolicy> policies = topology.policies();
+    char governor[32];
+
+    for (size_t i = 0; i < policies.size(); i++) {
+        std::string path = policies[i].path + "/scaling_governor";
+
+        if (sysfs_read(path.c_str(), governor, sizeof(governor)) == 0 &&
+            !strncmp(governor, "schedutil", 9))
+            return true;
+    }
+    return false;
+}
+
+int UclampBoost::probe(const char *groups, const CpuTopology &topology, bool force)
+{
+    std::string list(groups);
+    size_t start = 0;
+    pid_t self = syscall(__NR_gettid);
+    uint32_t utilMin;
+
+    mMode = UCLAMP_NONE;
+    mGroups.clear();
+    if (!force && !schedutil(topology)) {
+        ALOGI("uclamp boost: no schedutil policy, keeping global boost");
+        return -1;
+    }
+
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        std::string path;
+        Group group;
+        char buf[32];
+        int len;
+
+        if (end == std::string::npos)
+            end = list.size();
+        group.name = list.substr(start, end - start);
+        start = end + 1;
+        if (group.name.empty())
+            continue;
+
+        path = mCpuctlRoot + "/" + group.name + "/cpu.uclamp.min";
+        group.node = SysfsNodeRegistry::get(path.c_str());
+        if (!SysfsIo::access(path.c_str(), W_OK) &&
+            (len = group.node->read(buf, sizeof(buf) - 1)) > 0) {
+            buf[len] = '\0';
+            buf[strcspn(buf, "\n")] = '\0';
+            group.saved = buf;
+        }
+        mGroups.push_back(group);
+    }
+    if (mGroups.empty())
+        return -1;
+
+    mMode = UCLAMP_CGROUP;
+    for (size_t i = 0; i < mGroups.size(); i++) {
+        if (mGroups[i].saved.empty())
+            mMode = UCLAMP_TASK;
+    }
+
+    /* per-task clamps need CONFIG_UCLAMP_TASK; writes back our own clamp */
+    if (mMode == UCLAMP_TASK && (mClamp->get(self, &utilMin) || mClamp->set(self, utilMin))) {
+        ALOGI("uclamp boost: not supported (%s), keeping global boost", strerror(errno));
+        mMode = UCLAMP_NONE;
+        return -1;
+    }
+
+    ALOGI("uclamp boost: %s for %s", mMode == UCLAMP_CGROUP ? "cpu.uclamp.min" : "per task",
+          groups);
+    return 0;
+}
+
+/*
+ * Clamps every thread now in the groups' cpusets and puts back the clamp
+ * of the ones that left; threads started later are picked up on the next
+ * level change. A thread's own clamp is read when it is first boosted.
+ */
+int UclampBoost::applyTasks(int pct)
+{
+    std::vector<std::pair<pid_t, uint32_t> > boosted;
+    std::vector<std::pair<pid_t, uint32_t> >::iterator prev;
+    std::vector<pid_t> tids;
+    uint32_t level = pct * UCLAMP_CAPACITY / 100;
+    uint32_t saved;
+    int ret = 0;
+
+    for (size_t i = 0; pct && i < mGroups.size(); i++) {
+        std::string path = mCpusetRoot + "/" + mGroups[i].name + "/tasks";
+        FILE *file = SysfsIo::fopen(path.c_str(), "re");
+        int tid;
+
+        if (file == NULL)
+            continue;
+        while (fscanf(file, "%d", &tid) == 1)
+            tids.push_back(tid);
+        fclose(file);
+    }
+    std::sort(tids.begin(), tids.end());
+
+    for (size_t i = 0; i < mBoosted.size(); i++) {
+        if (!std::binary_search(tids.begin(), tids.end(), mBoosted[i].first))
+            mClamp->set(mBoosted[i].first, mBoosted[i].second);
+    }
+    for (size_t i = 0; i < tids.size(); i++) {
+        prev = std::lower_bound(mBoosted.begin(), mBoosted.end(),
+                                std::make_pair(tids[i], (uint32_t)0));
+        if (prev != mBoosted.end() && prev->first == tids[i]) {
+            saved = prev->second;
+        } else if (mClamp->get(tids[i], &saved)) {
+            /* threads may exit under us */
+            if (errno != ESRCH)
+                ret = -1;
+            continue;
+        }
+        if (mClamp->set(tids[i], std::max(saved, level))) {
+            if (errno != ESRCH)
+                ret = -1;
+            continue;
+        }
+        boosted.push_back(std::make_pair(tids[i], saved));
+    }
+    mBoosted.swap(boosted);
+    return ret;
+}
+
+int UclampBoost::apply(int pct)
+{
+    char value[16];
+    int ret = 0;
+
+    if (mMode == UCLAMP_NONE)
+        return -1;
+    if (pct < 0)
+        pct = 0;
+    if (pct > 100)
+        pct = 100;
+
+    if (mMode == UCLAMP_TASK) {
+        ret = applyTasks(pct);
+    } else {
+        snprintf(value, sizeof(value), "%d", pct);
+        for (size_t i = 0; i < mGroups.size(); i++) {
+            if (mGroups[i].node->write(pct ? value : mGroups[i].saved.c_str()))
+                ret = -1;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_UCLAMP_BOOST_H
+#define ANDROID_UCLAMP_BOOST_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "CpuTopology.h"
+#include "SysfsNode.h"
+
+enum uclamp_mode {
+    UCLAMP_NONE = 0,
+    UCLAMP_CGROUP,      /* cpu.uclamp.min of the cpu controller groups */
+    UCLAMP_TASK,        /* sched_setattr() on every thread of the cpusets */
+};
+
+/**
+ * Boosts only the foreground instead of the whole package: raises the
+ * minimum utilization clamp of the given groups (top-app by default), so
+ * schedutil runs their tasks faster and everything else keeps its own
+ * frequency. Uses the cpu controller's cpu.uclamp.min where the kernel
+ * has it, else per-task clamps on the threads of the matching cpusets.
+ *
+ * Levels are percent of capacity; 0 puts back what the groups held at
+ * probe(), or what each thread held when it was first clamped. A thread
+ * whose own clamp is above the level keeps it. Not thread safe; driven
+ * from the boost arbiter.
+ */
+class UclampBoost {
+
+  public:
+      /* per-task clamps in capacity units, sched_[gs]etattr() by default */
+      class TaskClamp {
+
+        public:
+          virtual ~TaskClamp() {};
+          virtual int get(pid_t tid, uint32_t *utilMin);
+          virtual int set(pid_t tid, uint32_t utilMin);
+      };
+
+      UclampBoost(const char *cpuctlRoot = "/dev/cpuctl", const char *cpusetRoot = "/dev/cpuset",
+                  TaskClamp *clamp = NULL);
+      virtual ~UclampBoost() {};
+      /* groups is a comma separated list; returns 0 when a mode works */
+      int probe(const char *groups, const CpuTopology &topology, bool force);
+      enum uclamp_mode mode() const { return mMode; };
+      int apply(int pct);
+
+  private:
+      struct Group {
+          std::string name;
+          SysfsNode *node;          /* cpu.uclamp.min */
+          std::string saved;
+      };
+
+      std::string mCpuctlRoot;
+      std::string mCpusetRoot;
+      enum uclamp_mode mMode;
+      std::vector<Group> mGroups;
+      TaskClamp *mClamp;
+      /* threads holding a per-task clamp with the one they had, by tid */
+      std::vector<std::pair<pid_t, uint32_t> > mBoosted;
+
+      bool schedutil(const CpuTopology &topology);
+      int applyTasks(int pct);
+};
+#endif  // ANDROID_UCLAMP_BOOST_H
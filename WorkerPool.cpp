@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHAL"
+
+#include "WorkerPool.h"
+
+#include <cutils/log.h>
+
+WorkerPool::WorkerPool(unsigned int threads):
+    mThreadCount(threads), mJob(NULL), mArgs(NULL),
+    mCount(0), mNext(0), mFinished(0), mBatch(0)
+{
+    pthread_mutex_init(&mLock, NULL);
+    pthread_cond_init(&mWork, NULL);
+    pthread_cond_init(&mDone, NULL);
+}
+
+int WorkerPool::start()
+{
+    pthread_t thread;
+
+    while (mThreads.size() < mThreadCount) {
+        if (pthread_create(&thread, NULL, threadLoop, this)) {
+            ALOGE("%s: could not create worker %zu", __func__, mThreads.size());
+            return mThreads.empty() ? -1 : 0;
+        }
+        pthread_setname_np(thread, "powerhal_worker");
+        mThreads.push_back(thread);
+    }
+
+    return 0;
+}
+
+/* Called with mLock held; drops it while the job runs. */
+bool WorkerPool::runOne(unsigned int batch)
+{
+    job_t job;
+    void *arg;
+
+    if (batch != mBatch || mNext >= mCount)
+        return false;
+
+    job = mJob;
+    arg = mArgs[mNext++];
+    pthread_mutex_unlock(&mLock);
+    job(arg);
+    pthread_mutex_lock(&mLock);
+
+    if (++mFinished == mCount)
+        pthread_cond_broadcast(&mDone);
+    return true;
+}
+
+void WorkerPool::run(job_t job, void **args, unsigned int count)
+{
+    unsigned int batch;
+
+    if (count == 0)
+        return;
+
+    pthread_mutex_lock(&mLock);
+    mJob = job;
+    mArgs = args;
+    mCount = count;
+    mNext = 0;
+    mFinished = 0;
+    batch = ++mBatch;
+    pthread_cond_broadcast(&mWork);
+
+    while (runOne(batch))
+        ;
+    while (mFinished < mCount)
+        pthread_cond_wait(&mDone, &mLock);
+    pthread_mutex_unlock(&mLock);
+}
+
+void *WorkerPool::threadLoop(void *arg)
+{
+    WorkerPool *self = (WorkerPool *) arg;
+    unsigned int batch = 0;
+
+    pthread_mutex_lock(&self->mLock);
+    while (1) {
+        while (self->mBatch == batch || self->mNext >= self->mCount) {
+            batch = self->mBatch;
+            pthread_cond_wait(&self->mWork, &self->mLock);
+        }
+        batch = self->mBatch;
+        while (self->runOne(batch))
+            ;
+    }
+    pthread_mutex_unlock(&self->mLock);
+
+    return NULL;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_WORKER_POOL_H
+#define ANDROID_WORKER_POOL_H
+
+#include <vector>
+
+#include <pthread.h>
+
+/**
+ * A small fixed pool of threads running one batch of jobs at a time.
+ * run() blocks until every job of the batch has finished; the calling
+ * thread takes jobs too.
+ */
+class WorkerPool {
+
+  public:
+      typedef void (*job_t)(void *arg);
+
+      WorkerPool(unsigned int threads);
+      virtual ~WorkerPool() {};
+      int start();
+      void run(job_t job, void **args, unsigned int count);
+
+  private:
+      unsigned int mThreadCount;
+      std::vector<pthread_t> mThreads;
+      pthread_mutex_t mLock;
+      pthread_cond_t mWork;
+      pthread_cond_t mDone;
+      job_t mJob;
+      void **mArgs;
+      unsigned int mCount;
+      unsigned int mNext;
+      unsigned int mFinished;
+      unsigned int mBatch;
+
+      bool runOne(unsigned int batch);
+      static void *threadLoop(void *arg);
+};
+#endif  // ANDROID_WORKER_POOL_H
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "FakeSysfs.h"
+
+#include <algorithm>
+
+#include <dirent.h>
+#include <errno.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CPU_ROOT "/sys/devices/system/cpu"
+#define HAL_DIR "/sys/power/power_HAL_suspend"
+#define POWERCAP_DIR "/sys/class/powercap"
+
+static void make_dirs(const std::string &path)
+{
+    for (size_t pos = path.find('/', 1); pos != std::string::npos; pos = path.find('/', pos + 1))
+        mkdir(path.substr(0, pos).c_str(), 0755);
+    mkdir(path.c_str(), 0755);
+}
+
+static int remove_entry(const char *path, const struct stat *, int, struct FTW *)
+{
+    return ::remove(path);
+}
+
+FakeSysfs::FakeSysfs():
+    mDevices(0)
+{
+    const char *tmp = getenv("TMPDIR");
+    std::string templ = std::string(tmp ? tmp : "/tmp") + "/powerhal-sysfs-XXXXXX";
+    char *dir = strdup(templ.c_str());
+
+    if (mkdtemp(dir) == NULL) {
+        perror("mkdtemp");
+        abort();
+    }
+    mRoot = dir;
+    free(dir);
+}
+
+FakeSysfs::~FakeSysfs()
+{
+    nftw(mRoot.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+void FakeSysfs::write(const std::string &path, const std::string &value)
+{
+    std::string full = mRoot + path;
+    FILE *f;
+
+    make_dirs(full.substr(0, full.rfind('/')));
+    f = fopen(full.c_str(), "w");
+    if (f == NULL) {
+        perror(full.c_str());
+        abort();
+    }
+    fprintf(f, "%s\n", value.c_str());
+    fclose(f);
+}
+
+/* The file's first line, "" if it cannot be read */
+std::string FakeSysfs::read(const std::string &path) const
+{
+    char buf[4096] = "";
+    FILE *f = fopen((mRoot + path).c_str(), "r");
+
+    if (f == NULL)
+        return "";
+    if (fgets(buf, sizeof(buf), f) == NULL)
+        buf[0] = '\0';
+    fclose(f);
+    buf[strcspn(buf, "\n")] = '\0';
+    return buf;
+}
+
+void FakeSysfs::remove(const std::string &path)
+{
+    nftw((mRoot + path).c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+void FakeSysfs::addCpus(int cpus, int cpusPerPolicy)
+{
+    std::string all = "0-" + std::to_string(cpus - 1);
+
+    write(CPU_ROOT "/possible", all);
+    write(CPU_ROOT "/online", all);
+    for (int first = 0; first < cpus; first += cpusPerPolicy) {
+        std::string policy = CPU_ROOT "/cpufreq/policy" + std::to_string(first);
+        int last = std::min(first + cpusPerPolicy, cpus) - 1;
+
+        write(policy + "/related_cpus", std::to_string(first) + "-" + std::to_string(last));
+        write(policy + "/cpuinfo_min_freq", "800000");
+        write(policy + "/cpuinfo_max_freq", "3000000");
+        write(policy + "/scaling_min_freq", "800000");
+        write(policy + "/scaling_max_freq", "3000000");
+        write(policy + "/scaling_governor", "powersave");
+    }
+}
+
+void FakeSysfs::addInteractiveGovernor()
+{
+    write(CPU_ROOT "/cpufreq/interactive/touchboostpulse", "0");
+    write(CPU_ROOT "/cpufreq/interactive/boostpulse_duration", "80000");
+    write(CPU_ROOT "/cpufreq/interactive/boost", "0");
+}
+
+void FakeSysfs::addIntelPstate(bool hwp)
+{
+    DIR *dir = opendir((mRoot + CPU_ROOT "/cpufreq").c_str());
+    struct dirent *de;
+
+    write(CPU_ROOT "/intel_pstate/status", "active");
+    write(CPU_ROOT "/intel_pstate/min_perf_pct", "20");
+    if (!hwp || dir == NULL) {
+        if (dir)
+            closedir(dir);
+        return;
+    }
+
+    write(CPU_ROOT "/intel_pstate/hwp_dynamic_boost", "0");
+    /* policies are named after their first cpu, so not numbered 0, 1, ... */
+    while ((de = readdir(dir))) {
+        std::string policy = CPU_ROOT "/cpufreq/" + std::string(de->d_name);
+
+        if (strncmp(de->d_name, "policy", 6))
+            continue;
+
+        write(policy + "/energy_performance_preference", "balance_performance");
+        write(policy + "/energy_performance_available_preferences",
+              "default performance balance_performance balance_power power");
+    }
+    closedir(dir);
+}
+
+void FakeSysfs::addCpusets(const char *cpus)
+{
+    write("/dev/cpuset/cpus", cpus);
+    write("/dev/cpuset/non_interactive/cpus", cpus);
+}
+
+/* Devices under power_HAL_suspend, named dev0, dev1, ... */
+void FakeSysfs::setDevices(int count)
+{
+    for (int i = mDevices; i < count; i++)
+        write(HAL_DIR "/dev" + std::to_string(i) + "/power_HAL_suspend", "0");
+    for (int i = count; i < mDevices; i++)
+        remove(HAL_DIR "/dev" + std::to_string(i));
+    mDevices = count;
+}
+
+void FakeSysfs::addGpu(int freq)
+{
+    write("/sys/class/drm/card0/gt_act_freq_mhz", std::to_string(freq));
+}
+
+/*
+ * A /proc of count processes from pid 1000 on, all in the foreground
+ * cpuset; the first matching of them run mediaserver.
+ */
+void FakeSysfs::setProcesses(int count, int matching)
+{
+    std::string procs;
+
+    remove("/proc");
+    for (int i = 0; i < count; i++) {
+        std::string pid = std::to_string(1000 + i);
+
+        write("/proc/" + pid + "/cmdline", i < matching ? "/system/bin/mediaserver" : "/system/bin/app_process64");
+        write("/proc/" + pid + "/cpuset", "/foreground");
+        procs += pid + "\n";
+    }
+    write("/dev/cpuset/foreground/cgroup.procs", procs);
+    write("/dev/cpuset/non_interactive/cgroup.procs", "");
+}
+
+/*
+ * intel-rapl:N packages with core and uncore subzones as intel-rapl:N:0
+ * and :1, all counters at zero and wrapping at rangeUj.
+ */
+void FakeSysfs::addRapl(int packages, uint64_t rangeUj)
+{
+    static const char *subzones[] = { "core", "uncore" };
+
+    for (int p = 0; p < packages; p++) {
+        std::string zone = POWERCAP_DIR "/intel-rapl:" + std::to_string(p);
+
+        write(zone + "/name", "package-" + std::to_string(p));
+        write(zone + "/energy_uj", "0");
+        write(zone + "/max_energy_range_uj", std::to_string(rangeUj));
+        for (int i = 0; i < 2; i++) {
+            std::string sub = zone + ":" + std::to_string(i);
+
+            write(sub + "/name", subzones[i]);
+            write(sub + "/energy_uj", "0");
+            write(sub + "/max_energy_range_uj", std::to_string(rangeUj));
+        }
+    }
+}
+
+/* zone is the directory name, intel-rapl:0 or intel-rapl:0:1 */
+void FakeSysfs::setEnergy(const std::string &zone, uint64_t uj)
+{
+    write(POWERCAP_DIR "/" + zone + "/energy_uj", std::to_string(uj));
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef POWERHAL_BENCH_FAKE_SYSFS_H
+#define POWERHAL_BENCH_FAKE_SYSFS_H
+
+#include <string>
+
+#include <stdint.h>
+
+/**
+ * A generated /sys, /dev and /vendor tree in a temporary directory, for
+ * running the HAL through SysfsIo's root prefix. Removed on destruction.
+ */
+class FakeSysfs {
+
+  public:
+      FakeSysfs();
+      virtual ~FakeSysfs();
+      const std::string &root() const { return mRoot; };
+      void write(const std::string &path, const std::string &value);
+      std::string read(const std::string &path) const;
+      void remove(const std::string &path);
+      void addCpus(int cpus, int cpusPerPolicy);
+      void addInteractiveGovernor();
+      void addIntelPstate(bool hwp);
+      void addCpusets(const char *cpus);
+      void setDevices(int count);
+      void addGpu(int freq);
+      void setProcesses(int count, int matching);
+      void addRapl(int packages, uint64_t rangeUj);
+      void setEnergy(const std::string &zone, uint64_t uj);
+
+  private:
+      std::string mRoot;
+      int mDevices;
+};
+#endif  // POWERHAL_BENCH_FAKE_SYSFS_H
@@ -0,0 +1,696 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Microbenchmarks for the HAL hot paths, run against a generated sysfs
+ * tree. The HAL entry points are driven through the power.host module,
+ * the way the framework loads it; the building blocks are linked in.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+#include <cutils/properties.h>
+#include <hardware/power.h>
+
+#include "BoostArbiter.h"
+#include "CpuSet.h"
+#include "DevicePowerMonitor.h"
+#include "EnergyMeter.h"
+#include "FakeSysfs.h"
+#include "GpuFreqMonitor.h"
+#include "GpuThrottleController.h"
+#include "HintDispatcher.h"
+#include "PowerStats.h"
+#include "ProcessMigrator.h"
+#include "PropertyCache.h"
+#include "SysfsIo.h"
+#include "SysfsNode.h"
+#include "ThermalClient.h"
+
+static FakeSysfs *tree;
+static struct power_module *power;
+
+static int load_module(const char *path)
+{
+    void *handle = dlopen(path, RTLD_NOW);
+
+    if (handle == NULL) {
+        fprintf(stderr, "dlopen %s: %s\n", path, dlerror());
+        return -1;
+    }
+    power = (struct power_module *)dlsym(handle, HAL_MODULE_INFO_SYM_AS_STR);
+    if (power == NULL)
+        return -1;
+
+    property_set("vendor.powerhal.sysfs_root", tree->root().c_str());
+    power->init(power);
+    return 0;
+}
+
+/*
+ * Caller side cost of a hint, which is what the binder thread pays. Hints
+ * alternate between on and off where the hint has a state.
+ */
+static void BM_PowerHint(benchmark::State &state)
+{
+    power_hint_t hint = (power_hint_t)state.range(0);
+    unsigned long i = 0;
+
+    for (auto _ : state)
+        power->powerHint(power, hint, (void *)(uintptr_t)(++i & 1));
+}
+BENCHMARK(BM_PowerHint)
+    ->ArgName("hint")
+    ->Arg(POWER_HINT_VSYNC)
+    ->Arg(POWER_HINT_INTERACTION)
+    ->Arg(POWER_HINT_LOW_POWER)
+    ->Arg(POWER_HINT_SUSTAINED_PERFORMANCE)
+    ->Arg(POWER_HINT_LAUNCH);
+
+/*
+ * A touchboostpulse write as the boost path does it, on the cached node,
+ * against the open/write/close per call it replaced.
+ */
+static void BM_SysfsNodeWrite(benchmark::State &state)
+{
+    SysfsNode *node = SysfsNodeRegistry::get("/sys/devices/system/cpu/cpufreq/interactive/touchboostpulse");
+
+    for (auto _ : state)
+        node->write("1");
+}
+BENCHMARK(BM_SysfsNodeWrite);
+
+static void BM_SysfsOpenWrite(benchmark::State &state)
+{
+    const char *path = "/sys/devices/system/cpu/cpufreq/interactive/touchboostpulse";
+
+    for (auto _ : state) {
+        int fd = SysfsIo::open(path, O_WRONLY | O_CLOEXEC);
+
+        if (fd < 0) {
+            state.SkipWithError("open failed");
+            return;
+        }
+        benchmark::DoNotOptimize(write(fd, "1", 1));
+        close(fd);
+    }
+}
+BENCHMARK(BM_SysfsOpenWrite);
+
+/*
+ * Enqueue latency of a hint on a bare dispatcher with an empty handler,
+ * from threads posting at once, as percentiles over every post. Each
+ * post is timed between two clock reads; the cost of the reads is taken
+ * off.
+ */
+struct EnqueueRun {
+    HintDispatcher *dispatcher;
+    int posts;
+    int64_t clockNs;
+    std::vector<int64_t> ns;
+};
+
+static void enqueue_handler(const struct HintRecord *) {}
+
+static void *enqueue_thread(void *arg)
+{
+    EnqueueRun *run = (EnqueueRun *)arg;
+
+    run->ns.reserve(run->posts);
+    for (int i = 0; i < run->posts; i++) {
+        int64_t start = PowerStats::now();
+
+        run->dispatcher->post(POWER_HINT_INTERACTION, NULL);
+        run->ns.push_back(PowerStats::now() - start - run->clockNs);
+        /* hints come in bursts at input rates, not back to back */
+        if (i % 16 == 15)
+            usleep(1000);
+    }
+    return NULL;
+}
+
+static void BM_HintEnqueue(benchmark::State &state)
+{
+    const int threads = state.range(0);
+    const int posts = 8000;
+    HintDispatcher dispatcher(enqueue_handler);
+    std::vector<EnqueueRun> runs(threads);
+    std::vector<pthread_t> ids(threads);
+    std::vector<int64_t> all;
+    int64_t clockNs = INT64_MAX;
+
+    for (int i = 0; i < 1000; i++) {
+        int64_t start = PowerStats::now();
+
+        clockNs = std::min(clockNs, PowerStats::now() - start);
+    }
+    dispatcher.start();
+    for (auto _ : state) {
+        for (int i = 0; i < threads; i++) {
+            runs[i].dispatcher = &dispatcher;
+            runs[i].posts = posts;
+            runs[i].clockNs = clockNs;
+            runs[i].ns.clear();
+            pthread_create(&ids[i], NULL, enqueue_thread, &runs[i]);
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_join(ids[i], NULL);
+            all.insert(all.end(), runs[i].ns.begin(), runs[i].ns.end());
+        }
+    }
+
+    std::sort(all.begin(), all.end());
+    state.counters["p50_ns"] = all[all.size() / 2];
+    state.counters["p99_ns"] = all[all.size() * 99 / 100];
+    state.counters["max_ns"] = all.back();
+    state.counters["dropped"] = dispatcher.dropped();
+}
+BENCHMARK(BM_HintEnqueue)->ArgName("threads")->Arg(1)->Arg(2)->Arg(4)->Arg(8)
+    ->Iterations(3)->Unit(benchmark::kMillisecond);
+
+/*
+ * What the stats add to a hint: the caller's count and the dispatch
+ * thread's histogram update. The clock read is the one the dispatcher
+ * takes for its deadlines anyway. Each thread has its own counters, so the
+ * cost stays flat as binder threads are added.
+ */
+static void BM_StatsPerHint(benchmark::State &state)
+{
+    int64_t latency = 1000;
+
+    for (auto _ : state) {
+        PowerStats::countHint(POWER_HINT_INTERACTION);
+        PowerStats::recordLatency(STAT_HINT, latency);
+        latency = latency * 3 % 10000000 + 1;
+    }
+}
+BENCHMARK(BM_StatsPerHint)->ThreadRange(1, 8);
+
+/*
+ * What energy accounting adds: a change of boost state reads every rapl
+ * counter, while a repeat of the current hint only moves its window.
+ */
+static void BM_EnergyCharge(benchmark::State &state)
+{
+    unsigned int clients = 0;
+    int64_t now = PowerStats::now();
+
+    EnergyMeter::setHint(POWER_HINT_INTERACTION, now);
+    for (auto _ : state) {
+        if (state.range(0))
+            EnergyMeter::setClients(clients ^= 1u << CLIENT_TOUCH);
+        else
+            EnergyMeter::setHint(POWER_HINT_INTERACTION, now);
+    }
+}
+BENCHMARK(BM_EnergyCharge)->ArgName("state_change")->Arg(0)->Arg(1);
+
+/* One screen off and on again: devices, cpusets and boosts */
+static void BM_SetInteractive(benchmark::State &state)
+{
+    for (auto _ : state) {
+        power->setInteractive(power, 0);
+        power->setInteractive(power, 1);
+    }
+}
+BENCHMARK(BM_SetInteractive)->Unit(benchmark::kMicrosecond);
+
+static void BM_ScanPaths(benchmark::State &state)
+{
+    DevicePowerMonitor monitor;
+    size_t found = 0;
+
+    tree->setDevices(state.range(0));
+    for (auto _ : state)
+        found = monitor.rescan();
+    state.counters["devices"] = found;
+    tree->setDevices(8);
+}
+BENCHMARK(BM_ScanPaths)->ArgName("devices")->RangeMultiplier(4)->Range(1, 256)
+    ->Unit(benchmark::kMicrosecond);
+
+/* Device name prefixes as a vendor config lists them: i2c, PCI and input */
+static std::string policy_prefix(int i)
+{
+    char buf[32];
+
+    if (i % 3 == 0)
+        snprintf(buf, sizeof(buf), "i2c-ELAN%04X", i);
+    else if (i % 3 == 1)
+        snprintf(buf, sizeof(buf), "0000:%02x:%02x.%d", i / 256, i / 8 % 32, i % 8);
+    else
+        snprintf(buf, sizeof(buf), "input%d-", i);
+    return buf;
+}
+
+/* Half the names looked up match a prefix, half match none */
+static std::vector<std::string> policy_names(int prefixes)
+{
+    std::vector<std::string> names;
+
+    for (int i = 0; i < 64; i++) {
+        int n = i * 7919 % prefixes;
+
+        names.push_back(i % 2 ? policy_prefix(n) + ":00" : "spi-" + policy_prefix(n));
+    }
+    return names;
+}
+
+/* Policy lookup per device name, trie against longest prefix by linear scan */
+static void BM_TrieMatch(benchmark::State &state)
+{
+    std::string path = "/vendor/etc/bench_devices_" + std::to_string(state.range(0)) + ".conf";
+    std::vector<std::string> names = policy_names(state.range(0));
+    std::vector<std::string> prefixes;
+    DevicePolicyTable table(path.c_str());
+    std::string config;
+    size_t i = 0;
+
+    for (int p = 0; p < state.range(0); p++) {
+        prefixes.push_back(policy_prefix(p));
+        config += prefixes.back() + " order=" + std::to_string(p) + "\n";
+    }
+    tree->write(path, config);
+    table.load();
+
+    for (auto _ : state) {
+        const std::string &name = names[i++ % names.size()];
+        struct DevicePolicy policy;
+
+        if (state.range(1)) {
+            table.lookup(name.c_str(), &policy);
+        } else {
+            size_t best = 0;
+
+            policy.order = DEVICE_ORDER_LAST;
+            for (size_t p = 0; p < prefixes.size(); p++) {
+                if (prefixes[p].size() > best &&
+                    !strncmp(name.c_str(), prefixes[p].c_str(), prefixes[p].size())) {
+                    best = prefixes[p].size();
+                    policy.order = p;
+                }
+            }
+        }
+        benchmark::DoNotOptimize(policy);
+    }
+    state.counters["policies"] = table.size();
+    tree->remove(path);
+}
+BENCHMARK(BM_TrieMatch)->ArgNames({"prefixes", "trie"})
+    ->ArgsProduct({{16, 256, 4096}, {0, 1}});
+
+static int arbiter_write(int value)
+{
+    benchmark::DoNotOptimize(value);
+    return 0;
+}
+
+/*
+ * A touch floor submitted over the standing requests of the other clients,
+ * with a knob write every time (changed) or never.
+ */
+static void BM_ArbiterSubmit(benchmark::State &state)
+{
+    BoostArbiter arbiter;
+    struct BoostRequest request = { CLIENT_TOUCH, RES_UCLAMP_MIN_PCT, BOOST_FLOOR, 0,
+                                    PRIORITY_NORMAL, 0 };
+    int64_t now = 1000000000LL;
+    int i = 0;
+
+    arbiter.setResource(RES_UCLAMP_MIN_PCT, 0, arbiter_write);
+    for (int client = CLIENT_INTERACTIVE; client < CLIENT_COUNT; client++) {
+        struct BoostRequest other = request;
+
+        other.client = (enum boost_client) client;
+        other.kind = client == CLIENT_GPU_THROTTLE ? BOOST_CEILING : BOOST_FLOOR;
+        other.level = client == CLIENT_GPU_THROTTLE ? 100 : 10;
+        arbiter.submit(other);
+    }
+
+    for (auto _ : state) {
+        request.level = state.range(0) ? 20 + i++ % 2 * 10 : 20;
+        request.deadlineNs = now + 100000000LL;
+        arbiter.submit(request);
+        arbiter.expire(now);
+        now += 1000;
+    }
+}
+BENCHMARK(BM_ArbiterSubmit)->ArgName("changed")->Arg(0)->Arg(1);
+
+static void BM_GpuThrottleUpdate(benchmark::State &state)
+{
+    GpuThrottleController controller;
+    int64_t now = 0;
+    int freq = 100;
+    bool near;
+
+    for (auto _ : state) {
+        now += 100000000;
+        freq = (freq * 7 + 300) % 1200;
+        benchmark::DoNotOptimize(controller.update(freq, now, &near));
+    }
+}
+BENCHMARK(BM_GpuThrottleUpdate);
+
+/* cpulists of the shapes the kernel prints for large machines */
+static std::string cpu_list(int cpus, int kind)
+{
+    std::string list;
+    char buf[32];
+    int cpu;
+
+    switch (kind) {
+    case 0:     /* one range */
+        snprintf(buf, sizeof(buf), "0-%d", cpus - 1);
+        return buf;
+    case 1:     /* smt siblings of every core */
+        for (cpu = 0; cpu < cpus; cpu += 2) {
+            snprintf(buf, sizeof(buf), "%s%d", list.empty() ? "" : ",", cpu);
+            list += buf;
+        }
+        return list;
+    default:    /* strided groups */
+        snprintf(buf, sizeof(buf), "0-%d:3/4", cpus - 1);
+        return buf;
+    }
+}
+
+static void BM_CpuSetParse(benchmark::State &state)
+{
+    std::string list = cpu_list(state.range(0), state.range(1));
+    CpuSet cpus;
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cpus.parse(list.c_str()));
+    state.SetBytesProcessed(state.iterations() * list.size());
+}
+BENCHMARK(BM_CpuSetParse)->ArgNames({"cpus", "kind"})
+    ->ArgsProduct({{16, 256, 1024}, {0, 1, 2}});
+
+static void BM_CpuSetFormat(benchmark::State &state)
+{
+    CpuSet cpus;
+
+    cpus.parse(cpu_list(state.range(0), state.range(1)).c_str());
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cpus.format());
+}
+BENCHMARK(BM_CpuSetFormat)->ArgNames({"cpus", "kind"})
+    ->ArgsProduct({{16, 256, 1024}, {0, 1, 2}});
+
+/*
+ * A screen-off/on cycle over a /proc of that many processes, four of them
+ * targets. The walk is what power_hal_helper and the fallback pay on every
+ * screen-off; with the proc connector only the targets are touched.
+ */
+static void BM_MigrateProcWalk(benchmark::State &state)
+{
+    ProcessMigrator migrator;
+
+    tree->setProcesses(state.range(0), 4);
+    for (auto _ : state) {
+        migrator.scan();
+        migrator.setState(0);
+        migrator.setState(1);
+    }
+}
+BENCHMARK(BM_MigrateProcWalk)->ArgName("processes")->RangeMultiplier(4)->Range(64, 4096)
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_MigrateTracked(benchmark::State &state)
+{
+    ProcessMigrator migrator;
+
+    tree->setProcesses(state.range(0), 4);
+    migrator.init();
+    if (!migrator.listening()) {
+        state.SkipWithError("no proc connector");
+        return;
+    }
+    for (auto _ : state) {
+        migrator.setState(0);
+        migrator.setState(1);
+    }
+}
+BENCHMARK(BM_MigrateTracked)->ArgName("processes")->RangeMultiplier(4)->Range(64, 4096)
+    ->Unit(benchmark::kMicrosecond);
+
+/*
+ * A stand-in thermal daemon on a socketpair that takes serviceUs per
+ * message and is published publishMs after it is created. Synchronous
+ * sends wait for the reply like BpThermalAPI::sendPowerSaveMsg() did.
+ */
+class StubThermal : public ThermalClient::Transport {
+
+  public:
+      StubThermal(bool oneway, int serviceUs, int publishMs):
+          mOneway(oneway), mServiceUs(serviceUs)
+      {
+          struct timespec now;
+
+          clock_gettime(CLOCK_MONOTONIC, &now);
+          mPublishNs = now.tv_sec * 1000000000LL + now.tv_nsec + publishMs * 1000000LL;
+          socketpair(AF_UNIX, SOCK_SEQPACKET, 0, mFds);
+          pthread_create(&mThread, NULL, serve, this);
+      }
+
+      ~StubThermal()
+      {
+          close(mFds[0]);
+          pthread_join(mThread, NULL);
+          close(mFds[1]);
+      }
+
+      int connect(ThermalClient *)
+      {
+          struct timespec now;
+
+          clock_gettime(CLOCK_MONOTONIC, &now);
+          return now.tv_sec * 1000000000LL + now.tv_nsec >= mPublishNs ? 0 : -1;
+      }
+
+      int sendPowerSave(bool on)
+      {
+          char msg = on;
+
+          if (write(mFds[0], &msg, 1) != 1)
+              return -1;
+          if (!mOneway && read(mFds[0], &msg, 1) != 1)
+              return -1;
+          return 0;
+      }
+
+  private:
+      bool mOneway;
+      int mServiceUs;
+      int64_t mPublishNs;
+      int mFds[2];
+      pthread_t mThread;
+
+      static void *serve(void *arg)
+      {
+          StubThermal *self = (StubThermal *) arg;
+          char msg;
+
+          while (read(self->mFds[1], &msg, 1) == 1) {
+              usleep(self->mServiceUs);
+              if (!self->mOneway && write(self->mFds[1], &msg, 1) != 1)
+                  break;
+          }
+          return NULL;
+      }
+};
+
+/*
+ * How long power_init() is held up by a thermal daemon published 1 s
+ * after the HAL: the old getService() loop against ThermalClient.
+ */
+static void BM_ThermalInit(benchmark::State &state)
+{
+    for (auto _ : state) {
+        StubThermal stub(false, 200, 1000);
+
+        if (state.range(0)) {
+            ThermalClient client(&stub);
+
+            client.start();
+            state.PauseTiming();
+        } else {
+            for (int cnt = 0; stub.connect(NULL); ) {
+                usleep(500000);
+                if (cnt++ > 10)
+                    break;
+            }
+            state.PauseTiming();
+        }
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_ThermalInit)->ArgName("async")->Arg(0)->Arg(1)->Iterations(3)
+    ->Unit(benchmark::kMillisecond);
+
+/*
+ * A LOW_POWER hint's send, with a daemon taking 200 us per message. Hints
+ * are spaced 1 ms apart so the daemon is idle when each one arrives.
+ */
+static void BM_PowerSaveHint(benchmark::State &state)
+{
+    StubThermal stub(state.range(0), 200, 0);
+    ThermalClient client(&stub);
+    struct timespec start, end;
+    bool on = false;
+
+    client.start();
+    while (!client.connected())
+        usleep(1000);
+    for (auto _ : state) {
+        on = !on;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        client.setPowerSave(on);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        state.SetIterationTime((end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+        usleep(1000);
+    }
+}
+BENCHMARK(BM_PowerSaveHint)->ArgName("oneway")->Arg(0)->Arg(1)->UseManualTime()
+    ->Unit(benchmark::kMicrosecond);
+
+/* Repeating the state the daemon already has sends nothing */
+static void BM_PowerSaveRepeat(benchmark::State &state)
+{
+    StubThermal stub(false, 200, 0);
+    ThermalClient client(&stub);
+
+    client.start();
+    while (!client.connected())
+        usleep(1000);
+    for (auto _ : state)
+        client.setPowerSave(true);
+    state.counters["messages"] = client.messages();
+}
+BENCHMARK(BM_PowerSaveRepeat);
+
+/*
+ * What the GPU monitor loop paid per iteration to check the exit property,
+ * against reading it from the cache. The host property store is a locked
+ * map, bionic's is a trie walk; neither is a relaxed load.
+ */
+static void BM_PropertyRead(benchmark::State &state)
+{
+    CachedProperty cached("vendor.powerhal.throttle.exit", "0");
+    char value[PROPERTY_VALUE_MAX];
+
+    for (auto _ : state) {
+        if (state.range(0)) {
+            benchmark::DoNotOptimize(cached.boolValue());
+        } else {
+            property_get("vendor.powerhal.throttle.exit", value, "0");
+            benchmark::DoNotOptimize(strcmp(value, "1") == 0);
+        }
+    }
+}
+BENCHMARK(BM_PropertyRead)->ArgName("cached")->Arg(0)->Arg(1);
+
+/*
+ * A refresh after some other property changed, as system churn wakes the
+ * watcher, with this many cached properties on top of the HAL's own.
+ */
+static void BM_PropertyRefresh(benchmark::State &state)
+{
+    std::vector<CachedProperty *> cached;
+    std::vector<std::string> names;
+    int i = 0;
+
+    for (int n = 0; n < state.range(0); n++)
+        names.push_back("vendor.powerhal.bench." + std::to_string(n));
+    for (int n = 0; n < state.range(0); n++) {
+        property_set(names[n].c_str(), "1");
+        cached.push_back(new CachedProperty(names[n].c_str()));
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        property_set("sys.bench.unrelated", std::to_string(i++).c_str());
+        state.ResumeTiming();
+        PropertyCache::refresh();
+    }
+    for (size_t n = 0; n < cached.size(); n++)
+        delete cached[n];
+}
+BENCHMARK(BM_PropertyRefresh)->ArgName("cached")->Arg(16)->Arg(256);
+
+static std::atomic<int> gpuSamplesLeft;
+
+static enum gpu_sample_rate gpu_sample(int freq)
+{
+    benchmark::DoNotOptimize(freq);
+    gpuSamplesLeft--;
+    return GPU_SAMPLE_FAST;
+}
+
+static bool gpu_exit(void)
+{
+    return gpuSamplesLeft <= 0;
+}
+
+/* Loop overhead on top of the 1 ms fast interval, per sample */
+static void BM_GpuMonitorLoop(benchmark::State &state)
+{
+    const int samples = 20;
+
+    for (auto _ : state) {
+        GpuFreqMonitor monitor("/sys/class/drm/card0/gt_act_freq_mhz", gpu_sample, gpu_exit);
+
+        monitor.setIntervals(1, 1, 1, 1);
+        gpuSamplesLeft = samples;
+        monitor.run();
+    }
+    state.SetItemsProcessed(state.iterations() * samples);
+}
+BENCHMARK(BM_GpuMonitorLoop)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char **argv)
+{
+    FakeSysfs sysfs;
+    int ret;
+
+    sysfs.addCpus(8, 4);
+    sysfs.addInteractiveGovernor();
+    sysfs.addCpusets("0-7");
+    sysfs.setDevices(8);
+    sysfs.addGpu(300);
+    sysfs.addRapl(1, 262143328850ULL);
+    tree = &sysfs;
+    SysfsIo::setRoot(sysfs.root().c_str());
+    EnergyMeter::init();
+
+    benchmark::Initialize(&argc, argv);
+    if (load_module(POWERHAL_MODULE_PATH))
+        return 1;
+    ret = benchmark::RunSpecifiedBenchmarks() ? 0 : 1;
+    benchmark::Shutdown();
+    return ret;
+}
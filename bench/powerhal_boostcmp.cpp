@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares foreground-only (uclamp) boosting with the package wide knobs,
+ * on a device:
+ *
+ *   powerhal_boostcmp <power module .so> <global|uclamp> [rounds [work [background]]]
+ *
+ * Every round hints a launch, runs work million iterations of CPU bound
+ * work on a top-app thread while background threads run a duty cycled
+ * load, and ends the launch. Reported are the foreground completion time
+ * and the busy time of all cpus over the round, from /proc/stat. Run it
+ * once per mode and compare.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cutils/properties.h>
+#include <hardware/hardware.h>
+#include <hardware/power.h>
+
+#define BACKGROUND_CHUNK 2000000
+#define BACKGROUND_SLEEP_US 10000
+#define ROUND_GAP_US 500000
+
+static std::atomic<bool> stopBackground;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Puts the calling thread in the named cpuset and cpu controller group */
+static void join_group(const char *group)
+{
+    const char *roots[] = { "/dev/cpuset", "/dev/cpuctl" };
+    char tid[16];
+
+    snprintf(tid, sizeof(tid), "%ld", (long)syscall(__NR_gettid));
+    for (size_t i = 0; i < sizeof(roots) / sizeof(roots[0]); i++) {
+        std::string path = std::string(roots[i]) + "/" + group + "/tasks";
+        FILE *f = fopen(path.c_str(), "we");
+
+        if (f == NULL)
+            continue;
+        fputs(tid, f);
+        fclose(f);
+    }
+}
+
+static uint32_t spin(uint64_t iterations)
+{
+    volatile uint32_t x = 1;
+
+    for (uint64_t i = 0; i < iterations; i++)
+        x = x * 1664525u + 1013904223u;
+    return x;
+}
+
+static void *background_loop(void *)
+{
+    join_group("background");
+    while (!stopBackground) {
+        spin(BACKGROUND_CHUNK);
+        usleep(BACKGROUND_SLEEP_US);
+    }
+    return NULL;
+}
+
+/* Busy time of all cpus in ms, everything but idle and iowait */
+static int64_t busy_ms(void)
+{
+    unsigned long long v[8] = { 0 };
+    FILE *f = fopen("/proc/stat", "re");
+    unsigned long long total = 0;
+
+    if (f == NULL)
+        return 0;
+    if (fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu %llu", &v[0], &v[1], &v[2], &v[3],
+               &v[4], &v[5], &v[6], &v[7]) != 8) {
+        fclose(f);
+        return 0;
+    }
+    fclose(f);
+
+    for (int i = 0; i < 8; i++)
+        total += v[i];
+    return (int64_t)(total - v[3] - v[4]) * 1000 / sysconf(_SC_CLK_TCK);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: powerhal_boostcmp <power module .so> <global|uclamp> "
+            "[rounds [work [background]]]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 3 ? atoi(argv[3]) : 10;
+    uint64_t work = (argc > 4 ? atoll(argv[4]) : 200) * 1000000ULL;
+    int background = argc > 5 ? atoi(argv[5]) : 4;
+    std::vector<int64_t> taskNs;
+    std::vector<pthread_t> threads;
+    struct power_module *power;
+    int64_t busy = 0;
+    void *handle;
+
+    if (argc < 3 || (strcmp(argv[2], "global") && strcmp(argv[2], "uclamp")) || rounds <= 0)
+        usage();
+
+    /* read by power_init() */
+    property_set("vendor.powerhal.boost_mode", argv[2]);
+    handle = dlopen(argv[1], RTLD_NOW);
+    if (handle == NULL) {
+        fprintf(stderr, "dlopen %s: %s\n", argv[1], dlerror());
+        return 1;
+    }
+    power = (struct power_module *)dlsym(handle, HAL_MODULE_INFO_SYM_AS_STR);
+    if (power == NULL) {
+        fprintf(stderr, "%s has no %s\n", argv[1], HAL_MODULE_INFO_SYM_AS_STR);
+        return 1;
+    }
+    power->init(power);
+    power->setInteractive(power, 1);
+
+    for (int i = 0; i < background; i++) {
+        pthread_t thread;
+
+        if (!pthread_create(&thread, NULL, background_loop, NULL))
+            threads.push_back(thread);
+    }
+    join_group("top-app");
+
+    for (int i = 0; i < rounds; i++) {
+        int64_t start, busyStart;
+
+        usleep(ROUND_GAP_US);
+        busyStart = busy_ms();
+        start = now_ns();
+        power->powerHint(power, POWER_HINT_LAUNCH, (void *)1);
+        spin(work);
+        power->powerHint(power, POWER_HINT_LAUNCH, NULL);
+        taskNs.push_back(now_ns() - start);
+        busy += busy_ms() - busyStart;
+    }
+
+    stopBackground = true;
+    for (size_t i = 0; i < threads.size(); i++)
+        pthread_join(threads[i], NULL);
+
+    std::sort(taskNs.begin(), taskNs.end());
+    printf("%s: foreground median %.1f ms, min %.1f ms, max %.1f ms; "
+           "all cpus busy %.1f ms per round\n", argv[2],
+           taskNs[taskNs.size() / 2] / 1e6, taskNs.front() / 1e6, taskNs.back() / 1e6,
+           (double)busy / rounds);
+    return 0;
+}
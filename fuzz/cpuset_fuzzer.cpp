@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Feeds arbitrary bytes to the cpulist parser. Whatever it accepts must
+ * format back into a list that parses to the same set.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "CpuSet.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    std::string input((const char *)data, size);
+    CpuSet cpus, again;
+    std::string list;
+
+    if (cpus.parse(input.c_str())) {
+        if (!cpus.empty())
+            abort();
+        return 0;
+    }
+
+    list = cpus.format();
+    if (again.parse(list.c_str()) || again != cpus || again.format() != list)
+        abort();
+    if (cpus.count() && (cpus.first() < 0 || !cpus.test(cpus.first())))
+        abort();
+    return 0;
+}
@@ -130,6 +130,10 @@ void cgroup_walk_proc_for_processes()
     ALOGV("helper found %d processes\n", cnt);
 }
 
+/*
+ * The HAL now tracks and migrates these processes itself (ProcessMigrator);
+ * this stays for init scripts that still start it.
+ */
 int main()
 {
     /* find all interesting processes */
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef POWERHAL_HOST_ANDROID_BASE_PROPERTIES_H
+#define POWERHAL_HOST_ANDROID_BASE_PROPERTIES_H
+
+#include <chrono>
+#include <string>
+
+namespace android {
+namespace base {
+
+bool WaitForProperty(const std::string &key, const std::string &expected_value,
+                     std::chrono::milliseconds relative_timeout = std::chrono::milliseconds::max());
+
+}  // namespace base
+}  // namespace android
+
+#endif  // POWERHAL_HOST_ANDROID_BASE_PROPERTIES_H
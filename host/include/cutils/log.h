@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Host build: ALOG* go to stderr, filtered by POWERHAL_LOG (v, d, i, w, e) */
+
+#ifndef POWERHAL_HOST_CUTILS_LOG_H
+#define POWERHAL_HOST_CUTILS_LOG_H
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef LOG_TAG
+#define LOG_TAG NULL
+#endif
+
+enum host_log_priority {
+    HOST_LOG_VERBOSE = 2,
+    HOST_LOG_DEBUG,
+    HOST_LOG_INFO,
+    HOST_LOG_WARN,
+    HOST_LOG_ERROR,
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void host_log_print(int prio, const char *tag, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+#ifdef __cplusplus
+}
+#endif
+
+#define ALOGV(...) host_log_print(HOST_LOG_VERBOSE, LOG_TAG, __VA_ARGS__)
+#define ALOGD(...) host_log_print(HOST_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define ALOGI(...) host_log_print(HOST_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define ALOGW(...) host_log_print(HOST_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define ALOGE(...) host_log_print(HOST_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#endif  // POWERHAL_HOST_CUTILS_LOG_H
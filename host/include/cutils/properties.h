@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Host build: an in-process property store, see host/shims.cpp */
+
+#ifndef POWERHAL_HOST_CUTILS_PROPERTIES_H
+#define POWERHAL_HOST_CUTILS_PROPERTIES_H
+
+#include <stdint.h>
+
+#define PROPERTY_KEY_MAX 32
+#define PROPERTY_VALUE_MAX 92
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+int property_get(const char *key, char *value, const char *default_value);
+int property_set(const char *key, const char *value);
+int8_t property_get_bool(const char *key, int8_t default_value);
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // POWERHAL_HOST_CUTILS_PROPERTIES_H
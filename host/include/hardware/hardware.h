@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Host build: the parts of libhardware's hardware.h the HAL uses */
+
+#ifndef POWERHAL_HOST_HARDWARE_H
+#define POWERHAL_HOST_HARDWARE_H
+
+#include <stdint.h>
+
+#define MAKE_TAG_CONSTANT(A, B, C, D) (((A) << 24) | ((B) << 16) | ((C) << 8) | (D))
+#define HARDWARE_MODULE_TAG MAKE_TAG_CONSTANT('H', 'W', 'M', 'T')
+
+#define HARDWARE_MAKE_API_VERSION(maj, min) ((((maj) & 0xff) << 8) | ((min) & 0xff))
+#define HARDWARE_HAL_API_VERSION HARDWARE_MAKE_API_VERSION(1, 0)
+
+#define HAL_MODULE_INFO_SYM HMI
+#define HAL_MODULE_INFO_SYM_AS_STR "HMI"
+
+struct hw_module_t;
+struct hw_device_t;
+
+struct hw_module_methods_t {
+    int (*open)(const struct hw_module_t *module, const char *id, struct hw_device_t **device);
+};
+
+typedef struct hw_module_t {
+    uint32_t tag;
+    uint16_t module_api_version;
+    uint16_t hal_api_version;
+    const char *id;
+    const char *name;
+    const char *author;
+    struct hw_module_methods_t *methods;
+    void *dso;
+    uint32_t reserved[32 - 7];
+} hw_module_t;
+
+#endif  // POWERHAL_HOST_HARDWARE_H
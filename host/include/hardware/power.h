@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Host build: the power_module ABI 0.2 from libhardware's power.h */
+
+#ifndef POWERHAL_HOST_POWER_H
+#define POWERHAL_HOST_POWER_H
+
+#include <hardware/hardware.h>
+
+#define POWER_MODULE_API_VERSION_0_2 HARDWARE_MAKE_API_VERSION(0, 2)
+#define POWER_HARDWARE_MODULE_ID "power"
+
+typedef enum {
+    POWER_HINT_VSYNC = 0x00000001,
+    POWER_HINT_INTERACTION = 0x00000002,
+    POWER_HINT_VIDEO_ENCODE = 0x00000003,
+    POWER_HINT_VIDEO_DECODE = 0x00000004,
+    POWER_HINT_LOW_POWER = 0x00000005,
+    POWER_HINT_SUSTAINED_PERFORMANCE = 0x00000006,
+    POWER_HINT_VR_MODE = 0x00000007,
+    POWER_HINT_LAUNCH = 0x00000008,
+    POWER_HINT_DISABLE_TOUCH = 0x00000009,
+} power_hint_t;
+
+typedef struct power_module {
+    struct hw_module_t common;
+    void (*init)(struct power_module *module);
+    void (*setInteractive)(struct power_module *module, int on);
+    void (*powerHint)(struct power_module *module, power_hint_t hint, void *data);
+} power_module_t;
+
+#endif  // POWERHAL_HOST_POWER_H
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* Host build: the bionic property serial calls, see host/shims.cpp */
+
+#ifndef POWERHAL_HOST_SYS_SYSTEM_PROPERTIES_H
+#define POWERHAL_HOST_SYS_SYSTEM_PROPERTIES_H
+
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+typedef struct prop_info prop_info;
+
+uint32_t __system_property_area_serial(void);
+const prop_info *__system_property_find(const char *name);
+uint32_t __system_property_serial(const prop_info *pi);
+/* only pi == NULL, waiting on the area serial, is supported */
+bool __system_property_wait(const prop_info *pi, uint32_t old_serial, uint32_t *new_serial_ptr,
+                            const struct timespec *relative_timeout);
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // POWERHAL_HOST_SYS_SYSTEM_PROPERTIES_H
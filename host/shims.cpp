@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Host stand-ins for liblog, libcutils properties and libbase. Built as a
+ * shared library so the HAL module and the tool loading it see one
+ * property store.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <android-base/properties.h>
+#include <cutils/log.h>
+#include <cutils/properties.h>
+#include <sys/system_properties.h>
+
+/* never destroyed: HAL threads may still wait in WaitForProperty() at exit */
+static std::mutex &propertyLock = *new std::mutex;
+static std::condition_variable &propertyChanged = *new std::condition_variable;
+static std::map<std::string, std::string> properties;
+static uint32_t propertySerial;
+
+/* as bionic's, one per property set so far and never freed */
+struct prop_info {
+    std::atomic<uint32_t> serial;
+};
+static std::map<std::string, prop_info *> propertyInfos;
+
+static int read_log_threshold(void)
+{
+    const char *level = getenv("POWERHAL_LOG");
+    int threshold = HOST_LOG_ERROR + 1;
+
+    if (level != NULL) {
+        switch (level[0]) {
+        case 'v': threshold = HOST_LOG_VERBOSE; break;
+        case 'd': threshold = HOST_LOG_DEBUG; break;
+        case 'i': threshold = HOST_LOG_INFO; break;
+        case 'w': threshold = HOST_LOG_WARN; break;
+        case 'e': threshold = HOST_LOG_ERROR; break;
+        }
+    }
+    return threshold;
+}
+
+static int log_threshold(void)
+{
+    static const int threshold = read_log_threshold();
+
+    return threshold;
+}
+
+extern "C" void host_log_print(int prio, const char *tag, const char *fmt, ...)
+{
+    static const char letters[] = "??VDIWE";
+    va_list ap;
+
+    if (prio < log_threshold())
+        return;
+
+    va_start(ap, fmt);
+    fprintf(stderr, "%c %s: ", letters[prio], tag ? tag : "");
+    vfprintf(stderr, fmt, ap);
+    if (fmt[0] && fmt[strlen(fmt) - 1] != '\n')
+        fputc('\n', stderr);
+    va_end(ap);
+}
+
+extern "C" int property_get(const char *key, char *value, const char *default_value)
+{
+    std::lock_guard<std::mutex> guard(propertyLock);
+    std::map<std::string, std::string>::iterator it = properties.find(key);
+    const char *src = it != properties.end() ? it->second.c_str() : default_value;
+    int len;
+
+    if (src == NULL)
+        src = "";
+    len = snprintf(value, PROPERTY_VALUE_MAX, "%s", src);
+    return len < PROPERTY_VALUE_MAX ? len : PROPERTY_VALUE_MAX - 1;
+}
+
+extern "C" int property_set(const char *key, const char *value)
+{
+    {
+        std::lock_guard<std::mutex> guard(propertyLock);
+        prop_info *&info = propertyInfos[key];
+
+        if (info == NULL)
+            info = new prop_info();
+        properties[key] = value ? value : "";
+        /* bionic's low bit marks a write in progress */
+        info->serial.fetch_add(2, std::memory_order_release);
+        propertySerial++;
+    }
+    propertyChanged.notify_all();
+    return 0;
+}
+
+extern "C" int8_t property_get_bool(const char *key, int8_t default_value)
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    if (property_get(key, value, NULL) == 0)
+        return default_value;
+    if (!strcmp(value, "1") || !strcmp(value, "y") || !strcmp(value, "yes") ||
+        !strcmp(value, "on") || !strcmp(value, "true"))
+        return 1;
+    if (!strcmp(value, "0") || !strcmp(value, "n") || !strcmp(value, "no") ||
+        !strcmp(value, "off") || !strcmp(value, "false"))
+        return 0;
+    return default_value;
+}
+
+extern "C" uint32_t __system_property_area_serial(void)
+{
+    std::lock_guard<std::mutex> guard(propertyLock);
+
+    return propertySerial;
+}
+
+extern "C" const prop_info *__system_property_find(const char *name)
+{
+    std::lock_guard<std::mutex> guard(propertyLock);
+    std::map<std::string, prop_info *>::iterator it = propertyInfos.find(name);
+
+    return it != propertyInfos.end() ? it->second : NULL;
+}
+
+extern "C" uint32_t __system_property_serial(const prop_info *pi)
+{
+    return pi->serial.load(std::memory_order_acquire);
+}
+
+extern "C" bool __system_property_wait(const prop_info *pi, uint32_t old_serial,
+                                       uint32_t *new_serial_ptr,
+                                       const struct timespec *relative_timeout)
+{
+    std::unique_lock<std::mutex> lock(propertyLock);
+    auto changed = [&] { return propertySerial != old_serial; };
+
+    if (pi != NULL)
+        return false;
+    if (relative_timeout == NULL) {
+        propertyChanged.wait(lock, changed);
+    } else if (!propertyChanged.wait_for(lock, std::chrono::seconds(relative_timeout->tv_sec) +
+                                         std::chrono::nanoseconds(relative_timeout->tv_nsec),
+                                         changed)) {
+        return false;
+    }
+    *new_serial_ptr = propertySerial;
+    return true;
+}
+
+namespace android {
+namespace base {
+
+bool WaitForProperty(const std::string &key, const std::string &expected_value,
+                     std::chrono::milliseconds relative_timeout)
+{
+    std::unique_lock<std::mutex> lock(propertyLock);
+    auto matches = [&] {
+        std::map<std::string, std::string>::iterator it = properties.find(key);
+        return it != properties.end() && it->second == expected_value;
+    };
+
+    if (relative_timeout == std::chrono::milliseconds::max()) {
+        propertyChanged.wait(lock, matches);
+        return true;
+    }
+    return propertyChanged.wait_for(lock, relative_timeout, matches);
+}
+
+}  // namespace base
+}  // namespace android
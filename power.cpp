@@ -13,6 +13,8 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <atomic>
+
 #include <errno.h>
 #include <string.h>
 #include <sys/types.h>
@@ -28,154 +30,262 @@
 #define LOG_TAG "PowerHAL"
 #include <utils/Log.h>
 
+#include <android-base/properties.h>
 #include <cutils/log.h>
 #include <cutils/properties.h>
 #include <hardware/hardware.h>
+#include "BoostArbiter.h"
+#include "BoostCoalescer.h"
 #include "CGroupCpusetController.h"
+#include "CpuTopology.h"
 #include "DevicePowerMonitor.h"
-#ifdef HAS_THD
-#include <thd_binder_client.h>
-#endif
+#include "EnergyMeter.h"
+#include "GpuFreqMonitor.h"
+#include "GpuThrottleController.h"
+#include "LaunchBoost.h"
+#include "HintDispatcher.h"
+#include "HintTrace.h"
+#include "IntelPstateBackend.h"
+#include "PowerHalState.h"
+#include "PowerStats.h"
+#include "ProcessMigrator.h"
+#include "PropertyCache.h"
+#include "SysfsIo.h"
+#include "SysfsNode.h"
+#include "ThermalClient.h"
+#include "TouchClassifier.h"
+#include "UclampBoost.h"
 
 #define ENABLE 1
 #define TOUCHBOOST_PULSE_SYSFS "/sys/devices/system/cpu/cpufreq/interactive/touchboostpulse"
+#define TOUCHBOOST_DURATION_SYSFS "/sys/devices/system/cpu/cpufreq/interactive/boostpulse_duration"
+#define TOUCHBOOST_COALESCE_PROPERTY "vendor.powerhal.boost.coalesce_ms"
+static CachedProperty touchCoalesceMs(TOUCHBOOST_COALESCE_PROPERTY);
 static const char cpufreq_boost_interactive[] = "/sys/devices/system/cpu/cpufreq/interactive/boost";
 static const char cpufreq_boost_intel_pstate[] = "/sys/devices/system/cpu/intel_pstate/min_perf_pct";
 
-/*
- * This parameter is to identify continuous touch/scroll events.
- * Any two touch hints received between a 20 interval ms is
- * considered as a scroll event.
- */
-#define SHORT_TOUCH_TIME 20
-
-/*
- * This parameter is to identify first touch events.
- * Any two touch hints received after 100 ms is considered as
- * a first touch event.
- */
-#define LONG_TOUCH_TIME 100
-
-/*
- * This parameter defines the number of vsync boost to be
- * done after the finger release event.
- */
-#define VSYNC_BOOST_COUNT 4
-
-/*
- * This parameter defines the time between a touch and a vsync
- * hint. the time if is > 30 ms, we do a vsync boost.
- */
-#define VSYNC_TOUCH_TIME 30
-
-#ifdef HAS_THD
-using namespace powerhal_api;
-#endif
-
+static CpuTopology cpuTopology;
 static CGroupCpusetController cgroupCpusetController;
+static ProcessMigrator processMigrator;
 static DevicePowerMonitor powerMonitor;
 #ifdef HAS_THD
-static android::sp<IThermalAPI> shw;
+static ThermalClient thermalClient(thd_transport());
+#else
+static ThermalClient thermalClient(NULL);
 #endif
-static bool serviceRegistered = false;
+static SysfsNode *touchboostPulse = SysfsNodeRegistry::get(TOUCHBOOST_PULSE_SYSFS);
+static BoostCoalescer touchBoost(touchboostPulse);
+static BoostArbiter boostArbiter;
+static UclampBoost uclampBoost;
+static IntelPstateBackend pstateBackend(&cpuTopology);
+
+/* Holds or drops a client's standing request on a knob */
+static void boost_request(enum boost_client client, enum boost_resource resource,
+                          enum boost_kind kind, int level, bool on)
+{
+    struct BoostRequest request;
+
+    if (!on) {
+        boostArbiter.cancel(client, resource);
+        return;
+    }
+
+    request.client = client;
+    request.resource = resource;
+    request.kind = kind;
+    request.level = level;
+    request.priority = PRIORITY_NORMAL;
+    request.deadlineNs = 0;
+    boostArbiter.submit(request);
+}
+
 static bool interactiveActive = false;
 static bool intelPStateActive = false;
+static bool uclampActive = false;
 
 struct intel_power_module{
     struct power_module container;
-    int touchboost_disable;
-    int timer_set;
-    int vsync_boost;
 };
 
-static int sysfs_write(const char *path, char *s)
-{
-    char buf[80];
-    int len;
-    int fd = open(path, O_WRONLY);
+static PowerHalState halState;
 
-    if (fd < 0) {
-        strerror_r(errno, buf, sizeof(buf));
-        ALOGE("Error opening %s: %s\n", path, buf);
-        return -1;
-    }
+#define TRACE_PROPERTY "vendor.powerhal.trace"
+#define TRACE_DEFAULT_FILE "/data/vendor/powerhal/hint_trace.bin"
+static CachedProperty traceEnabled(TRACE_PROPERTY, "0");
+static CachedProperty traceFile(TRACE_PROPERTY ".file", TRACE_DEFAULT_FILE);
 
-    len = write(fd, s, strlen(s));
-    if (len < 0) {
-        strerror_r(errno, buf, sizeof(buf));
-        ALOGE("Error writing to %s: %s\n", path, buf);
-        close(fd);
-        return -1;
-    }
+#define STATS_PROPERTY "vendor.powerhal.stats"
+#define STATS_DEFAULT_FILE "/data/vendor/powerhal/stats.txt"
+static CachedProperty statsDump(STATS_PROPERTY ".dump");
+static CachedProperty statsFile(STATS_PROPERTY ".file", STATS_DEFAULT_FILE);
+static void power_hint_handler(const struct HintRecord *rec);
+static HintDispatcher hintDispatcher(power_hint_handler);
 
-    close(fd);
-    return 0;
+/* Not a framework hint: boost properties changed, see boost_retune() */
+#define HINT_RETUNE (-1)
+
+#define BOOST_MODE_PROPERTY "vendor.powerhal.boost_mode"
+#define UCLAMP_GROUPS_PROPERTY "vendor.powerhal.uclamp.groups"
+#define UCLAMP_TOUCH_PROPERTY "vendor.powerhal.uclamp.touch_pct"
+#define UCLAMP_LAUNCH_PROPERTY "vendor.powerhal.uclamp.launch_pct"
+#define UCLAMP_TOUCH_PCT 30
+/* as long as the interactive governor's default boostpulse_duration */
+#define UCLAMP_TOUCH_NS 80000000LL
+
+static CachedProperty boostMode(BOOST_MODE_PROPERTY, "auto");
+static CachedProperty uclampGroups(UCLAMP_GROUPS_PROPERTY, "top-app");
+static CachedProperty uclampTouchPct(UCLAMP_TOUCH_PROPERTY);
+static CachedProperty uclampLaunchPct(UCLAMP_LAUNCH_PROPERTY);
+
+/*
+ * "global" keeps the package wide knobs, "uclamp" boosts only the
+ * foreground groups, "auto" (the default) uses uclamp where schedutil
+ * makes it steer frequency.
+ */
+static void uclamp_boost_init(void)
+{
+    std::string mode = boostMode.value();
+
+    if (mode == "global")
+        return;
+
+    uclampActive = !uclampBoost.probe(uclampGroups.value().c_str(), cpuTopology,
+                                      mode == "uclamp");
 }
 
-static int sysfs_read(const char *path, char *s, int length)
+#define TOUCH_PROPERTY_PREFIX "vendor.powerhal.touch."
+
+static CachedProperty touchProfile(TOUCH_PROPERTY_PREFIX "profile", "adaptive");
+static CachedProperty touchPeriodUs(TOUCH_PROPERTY_PREFIX "period_us");
+static TouchClassifier touchClassifier;
+
+/* "legacy" keeps the fixed thresholds; a known event period skips learning */
+static void touch_classifier_tune(void)
 {
-    char buf[80];
-    int len;
-    int fd = open(path, O_RDONLY);
+    touchClassifier.setProfile(touchProfile.value() == "legacy" ? TOUCH_PROFILE_LEGACY :
+                               TOUCH_PROFILE_ADAPTIVE);
+    if (touchPeriodUs.isSet())
+        touchClassifier.seedPeriod(touchPeriodUs.intValue() * 1000LL);
+}
 
-    if (fd < 0) {
-        strerror_r(errno, buf, sizeof(buf));
-        ALOGE("Error opening %s: %s\n", path, buf);
-        return -1;
-    }
+/*
+ * With uclamp a touch holds a floor on the foreground for as long as a
+ * governor pulse would last; re-arming is skipped for the first quarter
+ * of that, which keeps a fling from taking the arbiter lock per event.
+ */
+static void touch_boost(int hint, const struct timespec *time)
+{
+    static int64_t armedNs;
+    int64_t now = time->tv_sec * 1000000000LL + time->tv_nsec;
+    struct BoostRequest request;
 
-    len = read(fd, s, length);
-    if (len < 0) {
-        strerror_r(errno, buf, sizeof(buf));
-        ALOGE("Error reading from %s: %s\n", path, buf);
-        close(fd);
-        return -1;
+    if (!uclampActive) {
+        if (touchBoost.pulse(hint, time) > 0)
+            PowerStats::count(STAT_TOUCH_BOOSTS);
+        return;
     }
 
-    close(fd);
-    return 0;
+    if (now - armedNs < UCLAMP_TOUCH_NS / 4)
+        return;
+    armedNs = now;
+    PowerStats::count(STAT_TOUCH_BOOSTS);
+
+    request.client = CLIENT_TOUCH;
+    request.resource = RES_UCLAMP_MIN_PCT;
+    request.kind = BOOST_FLOOR;
+    request.level = uclampTouchPct.intValue() > 0 ? uclampTouchPct.intValue() : UCLAMP_TOUCH_PCT;
+    request.priority = PRIORITY_NORMAL;
+    request.deadlineNs = now + UCLAMP_TOUCH_NS;
+    boostArbiter.submit(request);
 }
 
 #ifdef APP_LAUNCH_BOOST
-static void app_launch_boost_interactive(void *hint_data)
-{
-    if (hint_data != NULL) {
-        ALOGI("PowerHAL HAL:App Boost ON");
-        sysfs_write(cpufreq_boost_interactive,(char *)"1");
-    } else {
-        ALOGI("PowerHAL HAL:App Boost OFF");
-        sysfs_write(cpufreq_boost_interactive,(char *)"0");
-    }
+#define LAUNCH_BOOST_TIMEOUT_PROPERTY "vendor.powerhal.launch_boost.timeout_ms"
+
+static LaunchBoost launchBoost(&boostArbiter);
+static CachedProperty launchTimeoutMs(LAUNCH_BOOST_TIMEOUT_PROPERTY);
+
+/* Unset properties keep what the boost has, its default or the last value */
+static void launch_boost_tune(void)
+{
+    if (uclampLaunchPct.intValue() > 0)
+        launchBoost.setUclampLevel(uclampLaunchPct.intValue());
+    if (launchTimeoutMs.intValue() > 0)
+        launchBoost.setTimeout(launchTimeoutMs.intValue());
 }
 
-static void app_launch_boost_intel_pstate(void *hint_data)
-{
-    static char old_min_perf_pct[4];
-    static bool boosted = false;
-
-    if (hint_data != NULL) {
-        ALOGI("PowerHAL HAL:App Boost ON");
-        if (boosted == false) {
-            if (!sysfs_read(cpufreq_boost_intel_pstate, old_min_perf_pct, sizeof(old_min_perf_pct))) {
-                sysfs_write(cpufreq_boost_intel_pstate,(char *)"100");
-                boosted = true;
-            }
-        }
-    } else {
-        ALOGI("PowerHAL HAL:App Boost OFF");
-        if (boosted == true) {
-            sysfs_write(cpufreq_boost_intel_pstate, old_min_perf_pct);
-            boosted = false;
-        }
-    }
+/*
+ * intel_pstate has no interactive governor, so whichever knob power_init()
+ * found decides the backend; uclamp goes first as it spares the rest.
+ */
+static void launch_boost_init(void)
+{
+    if (uclampActive)
+        launchBoost.setBackend(LAUNCH_BOOST_UCLAMP);
+    else if (intelPStateActive)
+        launchBoost.setBackend(LAUNCH_BOOST_INTEL_PSTATE);
+    else if (interactiveActive)
+        launchBoost.setBackend(LAUNCH_BOOST_INTERACTIVE);
+    launch_boost_tune();
 }
+#endif
+
+/* The sooner of the next boost deadline and the next energy read */
+static int64_t power_hint_timeout(const struct timespec *now)
+{
+    int64_t ns = now->tv_sec * 1000000000LL + now->tv_nsec;
+    int64_t boost = boostArbiter.expire(ns);
+    int64_t energy = EnergyMeter::poll(ns);
 
+    if (boost < 0 || (energy >= 0 && energy < boost))
+        return energy;
+    return boost;
+}
+
+#ifdef POWERHAL_DEBUG
+#define SYSFS_IO_PROPERTY_PREFIX "vendor.powerhal.sysfs_"
+
+static CachedProperty sysfsRoot(SYSFS_IO_PROPERTY_PREFIX "root");
+static CachedProperty sysfsLatency(SYSFS_IO_PROPERTY_PREFIX "latency_us", "0");
+static CachedProperty sysfsFail(SYSFS_IO_PROPERTY_PREFIX "fail_pct", "0");
+static unsigned int sysfsLatencyUs;
+static unsigned int sysfsFailPct;
+
+/* Slows down and fails file accesses as the debug properties ask */
+static int sysfs_fault_model(__attribute__((unused)) const char *path,
+                             __attribute__((unused)) enum sysfs_op op)
+{
+    static thread_local unsigned int seed = (unsigned int)pthread_self();
+
+    if (sysfsLatencyUs)
+        usleep(sysfsLatencyUs);
+    if (sysfsFailPct && (unsigned int)rand_r(&seed) % 100 < sysfsFailPct)
+        return EIO;
+    return 0;
+}
+
+/*
+ * Debug builds can run against a generated tree instead of the real
+ * /sys, /dev and /vendor, e.g. for powerhal_replay.
+ */
+static void sysfs_io_init(void)
+{
+    if (sysfsRoot.isSet())
+        SysfsIo::setRoot(sysfsRoot.value().c_str());
+
+    sysfsLatencyUs = sysfsLatency.intValue();
+    sysfsFailPct = sysfsFail.intValue();
+    if (sysfsLatencyUs || sysfsFailPct) {
+        ALOGW("sysfs fault model: %u us latency, %u%% failures", sysfsLatencyUs, sysfsFailPct);
+        SysfsIo::setFaultHook(sysfs_fault_model);
+    }
+}
 #endif
 
+static CachedProperty thermalMode("persist.vendor.thermal.mode", "thermald");
+
 static bool itux_or_dptf_enabled() {
-    char value[PROPERTY_VALUE_MAX];
-    int length = property_get("persist.vendor.thermal.mode", value, "thermald");
-    std::string mode(value);
+    std::string mode = thermalMode.value();
 
     if (mode == "itux" || mode == "ituxd" || mode == "dptf")
         return true;
@@ -183,104 +293,135 @@ static bool itux_or_dptf_enabled() {
     return false;
 }
 
-#ifdef POWER_THROTTLE
+/*
+ * A touchboostpulse keeps the interactive governor boosted for
+ * boostpulse_duration. Pulses within the first quarter of that are
+ * dropped: a later re-pulse extends the boost before it lapses, as the
+ * uclamp path re-arms. The window can be overridden through a property,
+ * where 0 or less turns coalescing off.
+ */
+static void touchboost_init_window(void)
+{
+    char buf[16] = "";
+    int ms = touchCoalesceMs.intValue();
 
-static int update_cpu_max_freq(bool is_limit)
-{
-    int fd0, fd1, fd2, fd3;
-    int ret0, ret1, ret2, ret3;
-    char buf[8] = "";
-    char max0[8] = "1200000";
-    char max1[8] = "2400000";
-
-    fd0 = open("/sys/devices/system/cpu/cpu0/cpufreq/scaling_max_freq", O_RDWR);
-    fd1 = open("/sys/devices/system/cpu/cpu1/cpufreq/scaling_max_freq", O_RDWR);
-    fd2 = open("/sys/devices/system/cpu/cpu2/cpufreq/scaling_max_freq", O_RDWR);
-    fd3 = open("/sys/devices/system/cpu/cpu3/cpufreq/scaling_max_freq", O_RDWR);
-
-    if (fd0 < 0 || fd1 < 0 || fd2 < 0 || fd3 < 0) {
-        ALOGE("open cpufreq scaling_max_freq failed (%d, %d, %d, %d)\n", fd0, fd1, fd2, fd3);
-        if (fd0 >= 0)
-            close(fd0);
-        if (fd1 >= 0)
-            close(fd1);
-        if (fd2 >= 0)
-            close(fd2);
-        if (fd3 >= 0)
-            close(fd3);
-        return -1;
+    if (touchCoalesceMs.isSet()) {
+        touchBoost.setWindow(ms > 0 ? (unsigned int)ms * 1000 : 0);
+    } else if (!sysfs_read(TOUCHBOOST_DURATION_SYSFS, buf, sizeof(buf) - 1)) {
+        touchBoost.setWindow(atoi(buf) / 4);
     }
+    ALOGI("touch boost coalescing window %u us\n", touchBoost.window());
+}
 
-    if (is_limit)
-        strncpy(buf, max0, sizeof(buf));
-    else
-        strncpy(buf, max1, sizeof(buf));
-
-    ret0 = write(fd0, buf, (sizeof(buf) - 1));
-    ret1 = write(fd1, buf, (sizeof(buf) - 1));
-    ret2 = write(fd2, buf, (sizeof(buf) - 1));
-    ret3 = write(fd3, buf, (sizeof(buf) - 1));
-
-    close(fd0);
-    close(fd1);
-    close(fd2);
-    close(fd3);
-
-    if ( ret0 < 0 || ret1 < 0 || ret2 < 0 || ret3 < 0 ) {
-        ALOGE("write cpufreq scaling_max_freq %s failed (%d, %d, %d, %d)\n", buf, ret0, ret1, ret2, ret3);
-        return -1;
-    }
+#ifdef POWER_THROTTLE
 
-    ALOGI("cpufreq scaling_max_freq = %s\n", buf);
-    return 0;
+#define THROTTLE_PROPERTY_PREFIX "vendor.powerhal.throttle."
+
+static GpuThrottleController gpuThrottle;
+static unsigned int gpu_cap = 100;
+static std::atomic<bool> gpuThrottleRetune;
+
+static CachedProperty throttleCapPct(THROTTLE_PROPERTY_PREFIX "cap_pct");
+static CachedProperty throttleSetpoint(THROTTLE_PROPERTY_PREFIX "setpoint");
+static CachedProperty throttleDeadband(THROTTLE_PROPERTY_PREFIX "deadband");
+static CachedProperty throttleAlpha(THROTTLE_PROPERTY_PREFIX "alpha");
+static CachedProperty throttleKp(THROTTLE_PROPERTY_PREFIX "kp");
+static CachedProperty throttleKi(THROTTLE_PROPERTY_PREFIX "ki");
+static CachedProperty throttleKd(THROTTLE_PROPERTY_PREFIX "kd");
+static CachedProperty throttleMinCap(THROTTLE_PROPERTY_PREFIX "min_cap");
+static CachedProperty throttleStep(THROTTLE_PROPERTY_PREFIX "step");
+static CachedProperty throttleMode(THROTTLE_PROPERTY_PREFIX "mode", "legacy");
+static CachedProperty throttleExit(THROTTLE_PROPERTY_PREFIX "exit", "0");
+
+static double throttle_property(const CachedProperty &property, double default_value)
+{
+    return property.isSet() ? property.doubleValue() : default_value;
 }
 
+/*
+ * The original two threshold switch between two caps is the default;
+ * "pid" selects the controller.
+ */
+static void gpu_throttle_init(void)
+{
+    struct GpuThrottleParams params;
+    bool legacy = throttleMode.value() != "pid";
+
+    GpuThrottleController::defaultParams(&params);
+    params.legacyCap = throttle_property(throttleCapPct, params.legacyCap);
+    if (params.legacyCap == 0 || params.legacyCap > 100)
+        params.legacyCap = 50;
+    params.setpoint = throttle_property(throttleSetpoint, params.setpoint);
+    params.deadband = throttle_property(throttleDeadband, params.deadband);
+    params.alpha = throttle_property(throttleAlpha, params.alpha);
+    params.kp = throttle_property(throttleKp, params.kp);
+    params.ki = throttle_property(throttleKi, params.ki);
+    params.kd = throttle_property(throttleKd, params.kd);
+    params.minCap = throttle_property(throttleMinCap, params.minCap);
+    params.step = throttle_property(throttleStep, params.step);
+    gpuThrottle.setParams(params);
+
+    gpuThrottle.setMode(legacy ? THROTTLE_MODE_LEGACY : THROTTLE_MODE_PID);
+    ALOGI("gpu throttle mode %s\n", legacy ? "legacy" : "pid");
+}
 
-int get_actual_freq(int fd)
+/*
+ * The controller belongs to the monitor thread, which picks this up; the
+ * monitor is woken so that an exit is not left to the next sample.
+ */
+static void gpu_throttle_listener(void *cookie)
 {
-    unsigned long freq = 0;
-    char buf[4] = "";
-    int ret;
+    gpuThrottleRetune.store(true, std::memory_order_relaxed);
+    static_cast<GpuFreqMonitor *>(cookie)->wake();
+}
 
-    ret = read(fd, buf, (sizeof(buf) - 1));
-    if (ret < 0) {
-        ALOGE("read gt_act_freq_mhz failed\n");
-        return -1;
-    }
+static void update_cpu_max_freq(unsigned int cap)
+{
+    gpu_cap = cap;
+    boost_request(CLIENT_GPU_THROTTLE, RES_CPU_MAX_FREQ_PCT, BOOST_CEILING, cap, cap < 100);
+}
 
-    buf[ret] = '\0';
-    errno = 0;
-    freq = strtoul(buf, NULL, 10);
-    if ((freq == ULONG_MAX && errno == ERANGE) || errno == EINVAL) {
-        ALOGE("read gt_act_freq_mhz error %d\n", errno);
-        return -1;
-    }
+static enum gpu_sample_rate gpu_freq_sample(int freq)
+{
+    struct timespec now;
+    unsigned int cap;
+    bool near = false;
+
+    if (gpuThrottleRetune.exchange(false, std::memory_order_relaxed))
+        gpu_throttle_init();
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    cap = gpuThrottle.update(freq, now.tv_sec * 1000000000LL + now.tv_nsec, &near);
+    HintTrace::record(TRACE_THROTTLE, cap, freq);
+    PowerStats::count(STAT_THROTTLE_SAMPLES);
+    if (cap < 100)
+        PowerStats::count(STAT_THROTTLE_CAPPED);
+    if (cap != gpu_cap)
+        update_cpu_max_freq(cap);
+    else if (gpu_cap != 100)
+        cpuTopology.refresh();  /* re-apply the cap to cpus hotplugged meanwhile */
+
+    if (near)
+        return GPU_SAMPLE_FAST;
+    return cap < 100 ? GPU_SAMPLE_HELD : GPU_SAMPLE_IDLE;
+}
 
-    ret = lseek(fd, 0, SEEK_SET);
-    errno = 0;
-    if (ret < 0) {
-        ALOGE("lseek gt_act_freq_mhz error %d\n", errno);
-        return -1;
+static bool gpu_throttle_exit(void)
+{
+    if (throttleExit.boolValue()) {
+        if (gpu_cap != 100) // if decide turn off and being throttled, store the maxfreq back
+            update_cpu_max_freq(100);
+        ALOGW("Power throttle exit\n");
+        return true;
     }
 
-    return freq;
+    return false;
 }
 
-
-#define MAX_FAIL_TIMES        60
-#define UP_THRESHOLD          600
-#define DOWN_THRESHOLD        200
-
 static void *monitor_gpu_thread(void __attribute__((unused)) *data)
 {
-    int freq = 0;
-    int old = 0;
-    bool is_limit = 0;
-    int i = 0;
-    char prop_value[92];
-    char throttle_off[92];
-    bool boot = 0;
-    int fd;
+    /* static, the property listener keeps it after the thread is gone */
+    static GpuFreqMonitor monitor("/sys/class/drm/card0/gt_act_freq_mhz",
+                                  gpu_freq_sample, gpu_throttle_exit);
 
     ALOGI("thread %ld: %s start\n", pthread_self(), __func__);
 
@@ -288,55 +429,12 @@ static void *monitor_gpu_thread(void __attribute__((unused)) *data)
      * Block the freq limitatiion until the system boot complete,
      * othwerwise it could influence system boot up latency
      */
-    while (1) {
-        property_get("vendor.boot_completed", prop_value, "0");
-        boot = atoi(prop_value);
-        if (boot)
-            break;
-        sleep (1);
-    }
-
-    fd = open("/sys/class/drm/card0/gt_act_freq_mhz", O_RDONLY);
-    if (fd < 0) {
-        ALOGW("open gt_act_freq_mhz failed\n");
-        pthread_exit(0);
-    }
+    android::base::WaitForProperty("vendor.boot_completed", "1");
 
-    while (1) {
-        property_get("vendor.powerhal.throttle.exit", throttle_off, "0");
-        if (strcmp(throttle_off, "1") == 0) {
-            if (is_limit) { // if decide turn off and being throttled, store the maxfreq back
-                update_cpu_max_freq(false);
-                is_limit = false;
-            }
-            ALOGW("Power throttle exit\n");
-            pthread_exit(0);
-        }
-
-        freq = get_actual_freq(fd);
-        if (freq < 0) {
-            ALOGE("get_actual_freq failed (%d)\n", ++i);
-            if (i > MAX_FAIL_TIMES) {
-                ALOGE("%s exit since continous failure\n", __func__);
-                close(fd);
-                pthread_exit(0);
-            }
-        } else {
-            i = 0;
-            if (old != freq) {
-                if (freq > UP_THRESHOLD && !is_limit) {
-                    update_cpu_max_freq(true);   // throttle
-                    is_limit = true;
-                }
-                if (freq < DOWN_THRESHOLD && is_limit) {
-                    update_cpu_max_freq(false);  // release throttle
-                    is_limit = false;
-                }
-                old = freq;
-            }
-        }
-        sleep(1);
-    }
+    PropertyCache::subscribe(THROTTLE_PROPERTY_PREFIX, gpu_throttle_listener, &monitor);
+    gpu_throttle_init();
+    monitor.run();
+    pthread_exit(0);
 }
 
 static void create_once(void)
@@ -351,139 +449,277 @@ static void create_once(void)
 pthread_once_t once = PTHREAD_ONCE_INIT;
 #endif
 
-static void power_init(__attribute__((unused))struct power_module *module)
+static int interactive_boost_write(int value)
 {
-#ifdef HAS_THD
-    sp<IServiceManager> sm = defaultServiceManager();
-    sp<IBinder> binder;
+    return sysfs_write(cpufreq_boost_interactive, value ? "1" : "0");
+}
+
+static int pstate_level_write(int value)
+{
+    return pstateBackend.apply(value);
+}
+
+static int cpu_max_freq_write(int value)
+{
+    if (cpuTopology.capMaxFreq(value)) {
+        ALOGE("cap cpufreq scaling_max_freq at %d%% failed\n", value);
+        return -1;
+    }
+
+    ALOGI("cpufreq scaling_max_freq capped at %d%%\n", value);
+    return 0;
+}
+
+static int uclamp_write(int pct)
+{
+    return uclampBoost.apply(pct);
+}
+
+static int power_save_write(int on)
+{
+    return thermalClient.setPowerSave(on);
+}
+
+/* Only knobs power_init() found get a writer */
+static void boost_arbiter_init(void)
+{
+    if (interactiveActive)
+        boostArbiter.setResource(RES_INTERACTIVE_BOOST, 0, interactive_boost_write);
+    if (intelPStateActive) {
+        boostArbiter.setResource(RES_PSTATE_LEVEL, PSTATE_DEFAULT, pstate_level_write);
+        /* the HAL starts out interactive */
+        boost_request(CLIENT_INTERACTIVE, RES_PSTATE_LEVEL, BOOST_FLOOR, PSTATE_INTERACTIVE, true);
+    }
+    boostArbiter.setResource(RES_CPU_MAX_FREQ_PCT, 100, cpu_max_freq_write);
+    /* itux and dptf take no power save hint, as there is no thermald */
+    if (thermalClient.available() && !itux_or_dptf_enabled())
+        boostArbiter.setResource(RES_POWER_SAVE, 0, power_save_write);
+    if (uclampActive)
+        boostArbiter.setResource(RES_UCLAMP_MIN_PCT, 0, uclamp_write);
+}
+
+/* Runs on the hint dispatch thread, which owns the boosts */
+static void boost_retune(void)
+{
+    touch_classifier_tune();
+    if (interactiveActive)
+        touchboost_init_window();
+#ifdef APP_LAUNCH_BOOST
+    launch_boost_tune();
+#endif
+}
+
+static void boost_listener(__attribute__((unused)) void *cookie)
+{
+    hintDispatcher.post(HINT_RETUNE, NULL);
+}
+
+/* Turning tracing on is immediate; off waits for the screen-off dump */
+static void trace_listener(__attribute__((unused)) void *cookie)
+{
+    if (traceEnabled.boolValue())
+        HintTrace::setEnabled(true);
+}
+
+/* Any new value of the dump property writes out the stats */
+static void stats_listener(__attribute__((unused)) void *cookie)
+{
+    std::string path = statsFile.value();
+    char buf[80];
+    int fd;
+
+    if (!statsDump.isSet())
+        return;
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error opening stats file %s: %s\n", path.c_str(), buf);
+        return;
+    }
+    halState.dump(fd);
+    PowerStats::dump(fd);
+    EnergyMeter::dump(fd);
+    close(fd);
+    ALOGI("power stats written to %s", path.c_str());
+}
+
+/*
+ * Boost mode, uclamp groups and the sysfs root are probed once; boost
+ * levels, windows and the touch profile follow their properties live, as
+ * do the cpusets and the throttle, which subscribe on their own.
+ */
+static void property_listeners_init(void)
+{
+    PropertyCache::subscribe(TOUCHBOOST_COALESCE_PROPERTY, boost_listener);
+    PropertyCache::subscribe(UCLAMP_LAUNCH_PROPERTY, boost_listener);
+    PropertyCache::subscribe(TOUCH_PROPERTY_PREFIX, boost_listener);
+#ifdef APP_LAUNCH_BOOST
+    PropertyCache::subscribe(LAUNCH_BOOST_TIMEOUT_PROPERTY, boost_listener);
 #endif
-    int cnt = 0;
+    PropertyCache::subscribe(TRACE_PROPERTY, trace_listener);
+    PropertyCache::subscribe(STATS_PROPERTY ".dump", stats_listener);
+}
+
+static void power_init(__attribute__((unused))struct power_module *module)
+{
     char buf[1];
 
     ALOGI("%s enter\n", __func__);
+    PropertyCache::start();
+#ifdef POWERHAL_DEBUG
+    sysfs_io_init();
+#endif
+    HintTrace::setEnabled(traceEnabled.boolValue());
+    cpuTopology.scan();
+    /* before the first boost, so every state is charged from the start */
+    EnergyMeter::init();
 #ifdef POWER_THROTTLE
     pthread_once(&once, create_once);
 #endif
 
+    /* Keep the hint hot path down to a single pwrite() per boost */
+    touchboostPulse->open();
+
     /* Enable all devices by default */
     powerMonitor.setState(ENABLE);
+    cgroupCpusetController.init(cpuTopology);
     cgroupCpusetController.setState(ENABLE);
+    processMigrator.init();
 
-    if (!sysfs_read(TOUCHBOOST_PULSE_SYSFS, buf, 1))
+    if (!sysfs_read(TOUCHBOOST_PULSE_SYSFS, buf, 1)) {
         interactiveActive = true;
-    if (!sysfs_read(cpufreq_boost_intel_pstate, buf, 1))
-	intelPStateActive = true;
+        touchboost_init_window();
+    }
+    if (!sysfs_read(cpufreq_boost_intel_pstate, buf, 1) && !pstateBackend.probe())
+        intelPStateActive = true;
+    uclamp_boost_init();
+    touch_classifier_tune();
+    boost_arbiter_init();
+#ifdef APP_LAUNCH_BOOST
+    launch_boost_init();
+#endif
+    hintDispatcher.setTimeoutHandler(power_hint_timeout);
+    property_listeners_init();
 
-    if (itux_or_dptf_enabled()) //we do not need the connection
-        return;
+    /* hint state is set up, hand hints over to the dispatch thread */
+    hintDispatcher.start();
 
-#ifdef HAS_THD
-    do {
-        binder = sm->getService(android::String16(SERVICE_NAME));
-        if (binder != 0)
-            break;
-        ALOGE("thd_binder_service not published, waiting...");
-        usleep(500000); // 0.5 s
-        if (cnt++ > 10) //do not wait forever
-            return;
-    } while (true);
-#endif
-    serviceRegistered = true;
-#ifdef HAS_THD
-    shw = android::interface_cast<IThermalAPI>(binder);
-#endif
+    /* connects in the background, power save requests wait for it */
+    if (!itux_or_dptf_enabled())
+        thermalClient.start();
 }
 
-static void power_set_interactive(__attribute__((unused))struct power_module *module, int on)
+/* Tracing follows the property; every screen-off writes out the session */
+static void trace_update(bool on)
 {
+    if (!on && HintTrace::enabled())
+        HintTrace::dump(traceFile.value().c_str());
+    HintTrace::setEnabled(traceEnabled.boolValue());
+}
+
+static void interactive_transition(bool on)
+{
+    int64_t start;
+
+    if (!on) {
+        ALOGD("hints: touch %lu vsync %lu launch %lu low power %lu, %lu dropped\n",
+              PowerStats::hintCount(POWER_HINT_INTERACTION), PowerStats::hintCount(POWER_HINT_VSYNC),
+              PowerStats::hintCount(POWER_HINT_LAUNCH), PowerStats::hintCount(POWER_HINT_LOW_POWER),
+              hintDispatcher.dropped());
+    }
+    if (!on && interactiveActive) {
+        ALOGD("touch boost: touch %lu issued %lu coalesced, vsync %lu issued %lu coalesced\n",
+              touchBoost.issued(POWER_HINT_INTERACTION), touchBoost.suppressed(POWER_HINT_INTERACTION),
+              touchBoost.issued(POWER_HINT_VSYNC), touchBoost.suppressed(POWER_HINT_VSYNC));
+    }
+    if (!on && (interactiveActive || uclampActive)) {
+        struct TouchState touch;
+
+        /* the dispatch thread may be mid update, the seqlock retries */
+        halState.loadTouchState(&touch);
+        ALOGD("touch: gesture %d after %d consecutive touches at screen off\n",
+              TouchClassifier::gesture(touch), touch.consecutiveTouches);
+    }
+
+    boost_request(CLIENT_INTERACTIVE, RES_PSTATE_LEVEL, BOOST_FLOOR, PSTATE_INTERACTIVE, on);
+    start = PowerStats::now();
     powerMonitor.setState(on);
+    PowerStats::recordLatency(STAT_DEVICES, PowerStats::now() - start);
+    start = PowerStats::now();
     cgroupCpusetController.setState(on);
+    PowerStats::recordLatency(STAT_CPUSETS, PowerStats::now() - start);
+    start = PowerStats::now();
+    processMigrator.setState(on);
+    PowerStats::recordLatency(STAT_MIGRATE, PowerStats::now() - start);
+    trace_update(on);
 }
 
-static void power_hint_worker(void __attribute__((unused)) *hint_data)
+/* Hints keep flowing to the dispatch thread while a transition runs */
+static void power_set_interactive(__attribute__((unused))struct power_module *module, int on)
 {
-#ifdef HAS_THD
-    struct PowerSaveMessage data = { 1 , 50 };
-    status_t status;
-#endif
-    if (!serviceRegistered)
-        return;
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    halState.setInteractive(on, interactive_transition);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    PowerStats::recordLatency(STAT_INTERACTIVE, (end.tv_sec - start.tv_sec) * 1000000000LL +
+                              end.tv_nsec - start.tv_nsec);
+    HintTrace::record(TRACE_INTERACTIVE, on, (end.tv_sec - start.tv_sec) * 1000000000LL +
+                      end.tv_nsec - start.tv_nsec);
+}
 
-#ifdef HAS_THD
-    if (NULL == hint_data)
-        data.on = 0;
-    shw->sendPowerSaveMsg(&data);
-#endif
+static void power_save_hint(void *hint_data)
+{
+    boost_request(CLIENT_LOW_POWER, RES_POWER_SAVE, BOOST_FLOOR, 1, hint_data != NULL);
+    boost_request(CLIENT_LOW_POWER, RES_PSTATE_LEVEL, BOOST_CEILING, PSTATE_LOW_POWER,
+                  hint_data != NULL);
 }
 
-static void power_hint(struct power_module *module, power_hint_t hint,
-                       void *data)
+/*
+ * Runs on the hint dispatch thread, the only writer of the touch/vsync
+ * state. Timing uses the time the hint was posted.
+ */
+static void handle_power_hint(const struct HintRecord *rec)
 {
-    struct intel_power_module *intel = (struct intel_power_module *) module;
-    static struct timespec curr_time, prev_time = {0,0}, vsync_time;
-    double diff;
-    static int vsync_count;
-    static int consecutive_touch_int;
+    struct TouchState touch;
+    int64_t now = rec->time.tv_sec * 1000000000LL + rec->time.tv_nsec;
+    void *data = (void *)rec->data;
 
-    switch(hint) {
+    EnergyMeter::setHint(rec->hint, now);
+    switch(rec->hint) {
     case POWER_HINT_INTERACTION:
-        if (!interactiveActive)
+        if (!interactiveActive && !uclampActive)
             return;
-        clock_gettime(CLOCK_MONOTONIC, &curr_time);
-        diff = (curr_time.tv_sec - prev_time.tv_sec) * 1000 +
-               (double)(curr_time.tv_nsec - prev_time.tv_nsec) / 1e6;
-        prev_time = curr_time;
-        if (diff < SHORT_TOUCH_TIME) {
-            consecutive_touch_int++;
-        }
-        else if (diff > LONG_TOUCH_TIME) {
-            intel->vsync_boost = 0;
-            intel->timer_set = 0;
-            intel->touchboost_disable = 0;
-            vsync_count = 0;
-            consecutive_touch_int = 0;
-        }
-        /* Simple touch: timer rate need not be changed here */
-        if ((diff < SHORT_TOUCH_TIME) && (intel->touchboost_disable == 0)
-                        && (consecutive_touch_int > 4))
-            intel->touchboost_disable = 1;
-        /*
-         * Scrolling: timer rate reduced to increase sensitivity. No more touch
-         * boost after this
-         */
-        if ((intel->touchboost_disable == 1) && (consecutive_touch_int > 15)
-                        && (intel->timer_set == 0)) {
-           intel->timer_set = 1;
-        }
-        if (!intel->touchboost_disable) {
-            sysfs_write(TOUCHBOOST_PULSE_SYSFS, (char *)"1");
-        }
+        halState.loadTouchState(&touch);
+        if (touchClassifier.touch(&touch, now))
+            touch_boost(POWER_HINT_INTERACTION, &rec->time);
+        halState.storeTouchState(touch);
         break;
     case POWER_HINT_VSYNC:
-        if (!interactiveActive)
+        if (!interactiveActive && !uclampActive)
             return;
-        if (intel->touchboost_disable == 1) {
-            clock_gettime(CLOCK_MONOTONIC, &vsync_time);
-            diff = (vsync_time.tv_sec - curr_time.tv_sec) * 1000 +
-            (double)(vsync_time.tv_nsec - curr_time.tv_nsec) / 1e6;
-            if (diff > VSYNC_TOUCH_TIME) {
-                intel->timer_set = 0;
-                intel->vsync_boost = 1;
-                intel->touchboost_disable = 0;
-                vsync_count = VSYNC_BOOST_COUNT;
-            }
-        }
-        if (intel->vsync_boost) {
-            if (((unsigned long)data != 0) && (vsync_count > 0)) {
-                sysfs_write(TOUCHBOOST_PULSE_SYSFS, (char *)"1");
-                vsync_count-- ;
-            if (vsync_count == 0)
-               intel->vsync_boost = 0;
-            }
-        }
+        halState.loadTouchState(&touch);
+        if (touchClassifier.vsync(&touch, now, data != NULL))
+            touch_boost(POWER_HINT_VSYNC, &rec->time);
+        halState.storeTouchState(touch);
         break;
     case POWER_HINT_LOW_POWER:
-        power_hint_worker(data);
+        power_save_hint(data);
+        break;
+    case POWER_HINT_SUSTAINED_PERFORMANCE:
+        boost_request(CLIENT_SUSTAINED, RES_PSTATE_LEVEL, BOOST_CEILING, PSTATE_SUSTAINED,
+                      data != NULL);
+        break;
+#ifdef APP_LAUNCH_BOOST
+    case POWER_HINT_LAUNCH:
+        if (data)
+            launchBoost.acquire(&rec->time);
+        else
+            launchBoost.release();
+        break;
+#endif
+    case HINT_RETUNE:
+        boost_retune();
         break;
 
     default:
@@ -491,6 +727,30 @@ static void power_hint(struct power_module *module, power_hint_t hint,
     }
 }
 
+static void power_hint_handler(const struct HintRecord *rec)
+{
+    int64_t posted = rec->time.tv_sec * 1000000000LL + rec->time.tv_nsec;
+    struct timespec done;
+
+    if (!HintTrace::enabled()) {
+        handle_power_hint(rec);
+        return;
+    }
+
+    HintTrace::record(TRACE_HINT, rec->hint, rec->data, posted);
+    handle_power_hint(rec);
+    clock_gettime(CLOCK_MONOTONIC, &done);
+    HintTrace::record(TRACE_HINT_DONE, rec->hint,
+                      done.tv_sec * 1000000000LL + done.tv_nsec - posted);
+}
+
+static void power_hint(__attribute__((unused))struct power_module *module, power_hint_t hint,
+                       void *data)
+{
+    PowerStats::countHint(hint);
+    hintDispatcher.post(hint, data);
+}
+
 static struct hw_module_methods_t power_module_methods = {
     .open = NULL,
 };
@@ -512,7 +772,4 @@ struct intel_power_module HAL_MODULE_INFO_SYM = {
     .setInteractive = power_set_interactive,
     .powerHint = power_hint,
     },
-    .touchboost_disable = 0,
-    .timer_set = 0,
-    .vsync_boost = 0,
 };
@@ -0,0 +1,42 @@
+# Copyright (C) 2014 Intel Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+LOCAL_PATH := $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/..
+
+LOCAL_MODULE := powerhal_replay
+LOCAL_CFLAGS += -Wno-error
+LOCAL_SRC_FILES := powerhal_replay.cpp \
+                   ../BoostCoalescer.cpp \
+                   ../GpuFreqMonitor.cpp \
+                   ../GpuThrottleController.cpp \
+                   ../HintTrace.cpp \
+                   ../PowerStats.cpp \
+                   ../SysfsIo.cpp \
+                   ../SysfsNode.cpp \
+                   ../TouchClassifier.cpp
+LOCAL_HEADER_LIBRARIES += libhardware_headers
+
+LOCAL_MODULE_PATH := $(TARGET_OUT_VENDOR_EXECUTABLES)
+
+LOCAL_SHARED_LIBRARIES := liblog libcutils libdl
+
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_MODULE_OWNER := intel
+
+include $(BUILD_EXECUTABLE)
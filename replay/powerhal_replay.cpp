@@ -0,0 +1,727 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Offline tooling for hint traces written by the power HAL.
+ *
+ *   powerhal_replay report <trace>
+ *       syscalls, boost duty cycle and per hint latency of a recording
+ *   powerhal_replay replay <trace> <power module .so> <output trace> [speed [root]]
+ *       feeds the recorded hints and interactive transitions into a power
+ *       module at the recorded pace (speed 0 for back to back), then
+ *       reports on the trace the module wrote. With a root, a debug build
+ *       of the module runs against that tree instead of the real files.
+ *   powerhal_replay coalesce <trace> [boostpulse_duration_us]
+ *       the touchboostpulse writes the touch and vsync hints of a recording
+ *       cause without coalescing, with the HAL's window and with a window
+ *       of the whole pulse, and the boost time each window loses
+ *   powerhal_replay touch <trace>
+ *       runs the touch and vsync hints of a recording through the legacy
+ *       and the adaptive touch profile and lists every gesture
+ *   powerhal_replay gestures [rate ...]
+ *       the touch suite: taps, a double tap, a scroll and a fling at each
+ *       event rate in Hz (30 60 90 120 240 by default), checked against
+ *       the adaptive profile; exits 1 on a misclassified gesture
+ *   powerhal_replay gpu [minutes]
+ *       the GPU monitor's sampling policy in simulated time over a made up
+ *       load of idle, light and heavy phases: wakeups per minute and how
+ *       late the cap is applied and released, with the back off held to
+ *       the base interval while capped and without
+ *   powerhal_replay throttle [minutes]
+ *       the same load through the legacy and the pid throttle as the HAL
+ *       samples it: time throttled, cap changes and the CPU performance
+ *       the caps took away
+ */
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cutils/properties.h>
+#include <hardware/hardware.h>
+#include <hardware/power.h>
+
+#include "BoostCoalescer.h"
+#include "GpuFreqMonitor.h"
+#include "GpuThrottleController.h"
+#include "HintTrace.h"
+#include "TouchClassifier.h"
+
+struct Trace {
+    std::vector<std::string> nodes;
+    std::vector<TraceRecord> records;
+};
+
+static int load_trace(const char *path, Trace &trace)
+{
+    struct TraceHeader header;
+    FILE *f = fopen(path, "rb");
+
+    if (f == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return -1;
+    }
+
+    if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != HINT_TRACE_MAGIC ||
+        header.version != HINT_TRACE_VERSION) {
+        fprintf(stderr, "%s is not a version %d hint trace\n", path, HINT_TRACE_VERSION);
+        fclose(f);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < header.nodeCount; i++) {
+        char buf[4096];
+        uint16_t len;
+
+        if (fread(&len, sizeof(len), 1, f) != 1 || len >= sizeof(buf) ||
+            fread(buf, 1, len, f) != len)
+            goto truncated;
+        trace.nodes.push_back(std::string(buf, len));
+    }
+
+    trace.records.resize(header.recordCount);
+    if (header.recordCount &&
+        fread(trace.records.data(), sizeof(TraceRecord), header.recordCount, f) != header.recordCount)
+        goto truncated;
+
+    fclose(f);
+    return 0;
+
+truncated:
+    fprintf(stderr, "%s is truncated\n", path);
+    fclose(f);
+    return -1;
+}
+
+static int64_t percentile(std::vector<int64_t> &v, int pct)
+{
+    if (v.empty())
+        return 0;
+    std::sort(v.begin(), v.end());
+    return v[(v.size() - 1) * pct / 100];
+}
+
+static void report(const Trace &trace)
+{
+    std::map<int, std::vector<int64_t> > latency;
+    std::map<int, unsigned long> writes;
+    std::map<int, int64_t> boostSince, boostNs;
+    int64_t first, last;
+
+    if (trace.records.empty()) {
+        printf("empty trace\n");
+        return;
+    }
+    first = trace.records.front().timeNs;
+    last = trace.records.back().timeNs;
+
+    for (size_t i = 0; i < trace.records.size(); i++) {
+        const TraceRecord &rec = trace.records[i];
+        int res;
+
+        switch (rec.event) {
+        case TRACE_HINT_DONE:
+            latency[rec.arg].push_back(rec.data);
+            break;
+        case TRACE_SYSFS_WRITE:
+            writes[rec.arg]++;
+            break;
+        case TRACE_BOOST:
+            res = rec.arg & ~TRACE_BOOST_ACTIVE;
+            if (boostSince.count(res)) {
+                boostNs[res] += rec.timeNs - boostSince[res];
+                boostSince.erase(res);
+            }
+            if (rec.arg & TRACE_BOOST_ACTIVE)
+                boostSince[res] = rec.timeNs;
+            break;
+        default:
+            break;
+        }
+    }
+    for (std::map<int, int64_t>::iterator it = boostSince.begin(); it != boostSince.end(); ++it)
+        boostNs[it->first] += last - it->second;
+
+    printf("%zu records over %.3f s\n", trace.records.size(), (last - first) / 1e9);
+
+    printf("\nper hint latency, post to handled (us)\n");
+    printf("%6s %8s %8s %8s %8s\n", "hint", "count", "p50", "p99", "max");
+    for (std::map<int, std::vector<int64_t> >::iterator it = latency.begin(); it != latency.end(); ++it) {
+        std::vector<int64_t> &v = it->second;
+        printf("%6d %8zu %8.1f %8.1f %8.1f\n", it->first, v.size(),
+               percentile(v, 50) / 1e3, percentile(v, 99) / 1e3, percentile(v, 100) / 1e3);
+    }
+
+    printf("\nsysfs writes\n");
+    for (std::map<int, unsigned long>::iterator it = writes.begin(); it != writes.end(); ++it) {
+        const char *name = it->first < (int)trace.nodes.size() ?
+                           trace.nodes[it->first].c_str() : "?";
+        printf("%8lu %s\n", it->second, name);
+    }
+
+    printf("\nboost duty cycle per arbiter resource\n");
+    for (std::map<int, int64_t>::iterator it = boostNs.begin(); it != boostNs.end(); ++it) {
+        printf("%6d %6.2f%%\n", it->first,
+               last > first ? 100.0 * it->second / (last - first) : 0.0);
+    }
+}
+
+static void sleep_until(int64_t ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ns / 1000000000LL;
+    ts.tv_nsec = ns % 1000000000LL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL))
+        ;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Only the HAL entry points are driven; everything else (sysfs writes,
+ * boosts, throttling) is whatever the module under test decides to do.
+ */
+static int replay(const Trace &trace, const char *module, const char *output, double speed,
+                  const char *root)
+{
+    struct power_module *power;
+    void *handle;
+    int64_t start, base;
+
+    handle = dlopen(module, RTLD_NOW);
+    if (handle == NULL) {
+        fprintf(stderr, "dlopen %s: %s\n", module, dlerror());
+        return -1;
+    }
+    power = (struct power_module *)dlsym(handle, HAL_MODULE_INFO_SYM_AS_STR);
+    if (power == NULL) {
+        fprintf(stderr, "%s has no %s\n", module, HAL_MODULE_INFO_SYM_AS_STR);
+        return -1;
+    }
+
+    /* the module writes its trace on the final screen off */
+    property_set("vendor.powerhal.trace", "1");
+    property_set("vendor.powerhal.trace.file", output);
+    if (root)
+        property_set("vendor.powerhal.sysfs_root", root);
+    power->init(power);
+
+    start = now_ns();
+    base = trace.records.empty() ? 0 : trace.records.front().timeNs;
+    for (size_t i = 0; i < trace.records.size(); i++) {
+        const TraceRecord &rec = trace.records[i];
+
+        if (rec.event != TRACE_HINT && rec.event != TRACE_INTERACTIVE)
+            continue;
+        if (speed > 0)
+            sleep_until(start + (int64_t)((rec.timeNs - base) / speed));
+
+        if (rec.event == TRACE_HINT)
+            power->powerHint(power, (power_hint_t)rec.arg, (void *)(uintptr_t)rec.data);
+        else
+            power->setInteractive(power, rec.arg);
+    }
+
+    /* let the dispatch thread drain before the dump */
+    usleep(100000);
+    power->setInteractive(power, 1);
+    power->setInteractive(power, 0);
+    return 0;
+}
+
+struct GestureResult {
+    int64_t startNs;
+    int64_t endNs;
+    int events;
+    int boosts;
+    int vsyncBoosts;
+    enum touch_gesture gesture;
+};
+
+static const char *gesture_names[] = { "tap", "scroll", "fling" };
+
+/*
+ * The classifier sees the hints as the dispatch thread would. A gesture
+ * is what the classifier takes for one: events up to a pause of longNs.
+ */
+static std::vector<GestureResult> classify(const std::vector<TraceRecord> &records,
+                                           TouchClassifier &classifier)
+{
+    std::vector<GestureResult> gestures;
+    struct TouchState state;
+
+    memset(&state, 0, sizeof(state));
+    for (size_t i = 0; i < records.size(); i++) {
+        const TraceRecord &rec = records[i];
+
+        if (rec.event != TRACE_HINT)
+            continue;
+        if (rec.arg == POWER_HINT_INTERACTION) {
+            if (gestures.empty() || rec.timeNs - state.lastTouchNs > classifier.thresholds().longNs) {
+                GestureResult result = { rec.timeNs, rec.timeNs, 0, 0, 0, TOUCH_TAP };
+                gestures.push_back(result);
+            }
+            GestureResult &cur = gestures.back();
+
+            cur.events++;
+            if (classifier.touch(&state, rec.timeNs))
+                cur.boosts++;
+            cur.gesture = std::max(cur.gesture, TouchClassifier::gesture(state));
+            cur.endNs = rec.timeNs;
+        } else if (rec.arg == POWER_HINT_VSYNC && !gestures.empty()) {
+            if (classifier.vsync(&state, rec.timeNs, rec.data != 0))
+                gestures.back().vsyncBoosts++;
+        }
+    }
+    return gestures;
+}
+
+/* Length of the union of [t, t + durationNs) over sorted times */
+static int64_t covered(const std::vector<int64_t> &times, int64_t durationNs)
+{
+    int64_t total = 0, end = INT64_MIN;
+
+    for (size_t i = 0; i < times.size(); i++) {
+        int64_t start = std::max(times[i], end);
+
+        end = times[i] + durationNs;
+        if (end > start)
+            total += end - start;
+    }
+    return total;
+}
+
+/*
+ * The classifier decides which hints boost, as in the HAL; a coalescer
+ * on a scratch file then writes or drops each pulse. Boost time lost is
+ * what the dropped pulses would have added to the written ones.
+ */
+static int coalesce_report(const Trace &trace, int64_t durationNs)
+{
+    const char *tmp = getenv("TMPDIR");
+    std::string path = std::string(tmp ? tmp : "/tmp") + "/powerhal-pulse-XXXXXX";
+    std::vector<std::pair<int64_t, int> > boosts;
+    std::vector<int64_t> all;
+    int64_t windows[] = { 0, durationNs / 4, durationNs };
+    const char *names[] = { "none", "hal", "pulse" };
+    TouchClassifier classifier;
+    struct TouchState state;
+    int fd;
+
+    memset(&state, 0, sizeof(state));
+    for (size_t i = 0; i < trace.records.size(); i++) {
+        const TraceRecord &rec = trace.records[i];
+        bool boost = false;
+
+        if (rec.event != TRACE_HINT)
+            continue;
+        if (rec.arg == POWER_HINT_INTERACTION)
+            boost = classifier.touch(&state, rec.timeNs);
+        else if (rec.arg == POWER_HINT_VSYNC)
+            boost = classifier.vsync(&state, rec.timeNs, rec.data != 0);
+        if (boost) {
+            boosts.push_back(std::make_pair(rec.timeNs, rec.arg));
+            all.push_back(rec.timeNs);
+        }
+    }
+
+    fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        fprintf(stderr, "cannot create %s\n", path.c_str());
+        return -1;
+    }
+    close(fd);
+
+    printf("%zu boosts requested, %.1f ms of boost with every pulse written\n\n", boosts.size(),
+           covered(all, durationNs) / 1e6);
+    printf("%-6s %10s %8s %8s %8s %10s\n", "window", "us", "writes", "dropped", "removed",
+           "lost ms");
+    for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+        SysfsNode node(path.c_str());
+        BoostCoalescer coalescer(&node);
+        std::vector<int64_t> written;
+
+        coalescer.setWindow(windows[w] / 1000);
+        for (size_t i = 0; i < boosts.size(); i++) {
+            struct timespec ts;
+
+            ts.tv_sec = boosts[i].first / 1000000000LL;
+            ts.tv_nsec = boosts[i].first % 1000000000LL;
+            if (coalescer.pulse(boosts[i].second, &ts) > 0)
+                written.push_back(boosts[i].first);
+        }
+        printf("%-6s %10lld %8zu %8zu %7.1f%% %10.1f\n", names[w], (long long)windows[w] / 1000,
+               written.size(), boosts.size() - written.size(),
+               boosts.empty() ? 0.0 : 100.0 * (boosts.size() - written.size()) / boosts.size(),
+               (covered(all, durationNs) - covered(written, durationNs)) / 1e6);
+    }
+    unlink(path.c_str());
+    return 0;
+}
+
+static void touch_report(const Trace &trace)
+{
+    TouchClassifier legacy, adaptive;
+    std::vector<GestureResult> old, now;
+
+    legacy.setProfile(TOUCH_PROFILE_LEGACY);
+    old = classify(trace.records, legacy);
+    now = classify(trace.records, adaptive);
+
+    printf("%10s %8s %6s %6s  %-20s %-20s\n", "start s", "ms", "events", "Hz",
+           "legacy boosts/vsync", "adaptive boosts/vsync");
+    for (size_t i = 0; i < now.size() && i < old.size(); i++) {
+        const GestureResult &g = now[i];
+        int64_t ns = g.endNs - g.startNs;
+
+        printf("%10.3f %8.1f %6d %6.0f  %-7s %5d %5d  %-7s %5d %5d\n",
+               (g.startNs - now[0].startNs) / 1e9, ns / 1e6, g.events,
+               ns > 0 ? (g.events - 1) * 1e9 / ns : 0.0,
+               gesture_names[old[i].gesture], old[i].boosts, old[i].vsyncBoosts,
+               gesture_names[g.gesture], g.boosts, g.vsyncBoosts);
+    }
+    if (adaptive.learned())
+        printf("\nlearned event period %.2f ms\n", adaptive.periodNs() / 1e6);
+    else
+        printf("\ntoo few events to learn the rate, adaptive ran the legacy profile\n");
+}
+
+struct GestureSpec {
+    const char *name;
+    int contactMs;
+    int pauseMs;                /* after it, before the next gesture */
+    enum touch_gesture expected;
+};
+
+/* The first gesture lets the classifier learn the rate and is not checked */
+static const GestureSpec gestureSpecs[] = {
+    { "warm up", 800, 300, TOUCH_FLING },
+    { "tap", 40, 300, TOUCH_TAP },
+    { "double tap 1", 40, 150, TOUCH_TAP },
+    { "double tap 2", 40, 300, TOUCH_TAP },
+    { "scroll", 120, 300, TOUCH_SCROLL },
+    { "fling", 400, 300, TOUCH_FLING },
+};
+
+#define GESTURE_SPECS (sizeof(gestureSpecs) / sizeof(gestureSpecs[0]))
+#define VSYNC_PERIOD_NS 16666667LL
+
+/*
+ * A recording as a digitizer at rate would make it: touch hints with up
+ * to 10% jitter while a finger is down, and a vsync hint every frame.
+ */
+static std::vector<TraceRecord> synthesize(int rate)
+{
+    std::vector<TraceRecord> records;
+    int64_t period = 1000000000LL / rate;
+    int64_t t = 1000000000LL;
+    int64_t vsync = t;
+    uint32_t seed = rate;
+
+    for (size_t i = 0; i < GESTURE_SPECS; i++) {
+        int64_t end = t + gestureSpecs[i].contactMs * 1000000LL;
+        int64_t next = end + gestureSpecs[i].pauseMs * 1000000LL;
+
+        while (t <= end || vsync < next) {
+            TraceRecord rec = { 0, TRACE_HINT, 0, 0, 1 };
+
+            if (t <= end && t < vsync) {
+                rec.timeNs = t;
+                rec.arg = POWER_HINT_INTERACTION;
+                seed = seed * 1103515245 + 12345;
+                t += period + ((int64_t)((seed >> 16) % 201) - 100) * period / 1000;
+            } else {
+                rec.timeNs = vsync;
+                rec.arg = POWER_HINT_VSYNC;
+                vsync += VSYNC_PERIOD_NS;
+            }
+            records.push_back(rec);
+        }
+        t = next;
+    }
+    return records;
+}
+
+static int gesture_suite(const std::vector<int> &rates)
+{
+    int failures = 0;
+
+    printf("%5s %-14s %-7s %-14s %-14s %s\n", "Hz", "gesture", "expect", "legacy", "adaptive",
+           "adaptive thresholds");
+    for (size_t r = 0; r < rates.size(); r++) {
+        std::vector<TraceRecord> records = synthesize(rates[r]);
+        TouchClassifier legacy, adaptive;
+        std::vector<GestureResult> old, now;
+
+        legacy.setProfile(TOUCH_PROFILE_LEGACY);
+        old = classify(records, legacy);
+        now = classify(records, adaptive);
+        if (now.size() != GESTURE_SPECS || old.size() != GESTURE_SPECS) {
+            printf("%5d %zu gestures seen, expected %zu  FAIL\n", rates[r], now.size(),
+                   GESTURE_SPECS);
+            failures++;
+            continue;
+        }
+
+        for (size_t i = 1; i < GESTURE_SPECS; i++) {
+            const GestureSpec &spec = gestureSpecs[i];
+            const struct TouchThresholds &t = adaptive.thresholds();
+            /* a scroll gets its vsync boosts once the finger is up, a tap none */
+            int vsyncs = spec.expected == TOUCH_TAP ? 0 : t.vsyncBoosts;
+            bool ok = now[i].gesture == spec.expected && now[i].vsyncBoosts == vsyncs;
+            char legacyCol[16], adaptiveCol[16];
+
+            snprintf(legacyCol, sizeof(legacyCol), "%s/%d", gesture_names[old[i].gesture],
+                     old[i].vsyncBoosts);
+            snprintf(adaptiveCol, sizeof(adaptiveCol), "%s/%d", gesture_names[now[i].gesture],
+                     now[i].vsyncBoosts);
+            printf("%5d %-14s %-7s %-14s %-14s", rates[r], spec.name,
+                   gesture_names[spec.expected], legacyCol, adaptiveCol);
+            if (i == 1)
+                printf(" short %.1f ms, scroll >%d, fling >%d, release %.1f ms",
+                       t.shortNs / 1e6, t.scrollEvents, t.flingEvents, t.releaseNs / 1e6);
+            printf("%s\n", ok ? "" : "  FAIL");
+            failures += !ok;
+        }
+    }
+
+    printf("\n%d failed\n", failures);
+    return failures ? 1 : 0;
+}
+
+#define GPU_TICK_NS 10000000LL
+
+/*
+ * gt_act_freq_mhz every 10 ms: idle and light phases sit at one frequency,
+ * heavy ones move between 650 and 1000 MHz every few hundred ms.
+ */
+static std::vector<int> gpu_load(int minutes)
+{
+    std::vector<int> freqs;
+    size_t ticks = minutes * 60 * (1000000000LL / GPU_TICK_NS);
+    uint32_t seed = 1;
+
+    while (freqs.size() < ticks) {
+        int phase, length, freq;
+
+        seed = seed * 1103515245 + 12345;
+        phase = (seed >> 16) % 3;
+        seed = seed * 1103515245 + 12345;
+        length = 200 + (seed >> 16) % 6000;
+        freq = phase == 0 ? 100 : 350;
+        for (int t = 0; t < length && freqs.size() < ticks; t++) {
+            if (phase == 2 && t % 30 == 0) {
+                seed = seed * 1103515245 + 12345;
+                freq = 650 + (seed >> 16) % 8 * 50;
+            }
+            freqs.push_back(freq);
+        }
+    }
+    return freqs;
+}
+
+struct GpuRun {
+    unsigned long samples;
+    std::vector<int64_t> caps;      /* times the cap went on */
+    std::vector<int64_t> releases;  /* times it came off */
+    unsigned long changes;          /* every cap write */
+    int64_t cappedNs;
+    double lostPctNs;               /* 100 - cap over time */
+};
+
+/*
+ * The HAL's sample handler, with the monitor's sampling policy in place
+ * of the timer. A zero interval samples every tick, as a reference.
+ */
+static GpuRun gpu_run(const std::vector<int> &freqs, const GpuFreqMonitor *monitor,
+                      enum gpu_throttle_mode mode)
+{
+    GpuThrottleController controller;
+    unsigned int interval = 1000, cap = 100;
+    int64_t end = freqs.size() * GPU_TICK_NS;
+    GpuRun run = { 0, {}, {}, 0, 0, 0 };
+    int64_t t, step;
+    int old = -1;
+
+    controller.setMode(mode);
+    for (t = 0; t < end; t += step) {
+        int freq = freqs[t / GPU_TICK_NS];
+        unsigned int next;
+        bool near = false;
+
+        next = controller.update(freq, t, &near);
+        if (next < 100 && cap == 100)
+            run.caps.push_back(t);
+        else if (next == 100 && cap < 100)
+            run.releases.push_back(t);
+        run.changes += next != cap;
+        cap = next;
+        run.samples++;
+        if (monitor)
+            interval = monitor->nextInterval(interval, near ? GPU_SAMPLE_FAST :
+                                             cap < 100 ? GPU_SAMPLE_HELD : GPU_SAMPLE_IDLE,
+                                             freq != old);
+        old = freq;
+
+        step = std::min<int64_t>(monitor ? interval * 1000000LL : GPU_TICK_NS, end - t);
+        if (cap < 100)
+            run.cappedNs += step;
+        run.lostPctNs += (100.0 - cap) * step;
+    }
+    return run;
+}
+
+/* How long after the reference each transition happened */
+static std::vector<int64_t> gpu_lateness(const std::vector<int64_t> &ref,
+                                         const std::vector<int64_t> &seen)
+{
+    std::vector<int64_t> late;
+
+    for (size_t i = 0; i < seen.size(); i++) {
+        std::vector<int64_t>::const_iterator it =
+            std::upper_bound(ref.begin(), ref.end(), seen[i]);
+
+        if (it != ref.begin())
+            late.push_back(seen[i] - *(it - 1));
+    }
+    return late;
+}
+
+static void gpu_report(int minutes)
+{
+    std::vector<int> freqs = gpu_load(minutes);
+    GpuFreqMonitor hal("", NULL, NULL), unbounded("", NULL, NULL);
+    const GpuFreqMonitor *monitors[] = { &hal, &unbounded };
+    const char *names[] = { "held", "unbound" };
+    GpuRun ref = gpu_run(freqs, NULL, THROTTLE_MODE_LEGACY);
+
+    unbounded.setIntervals(100, 1000, 8000, 8000);
+    printf("%d min, %zu caps and releases with every 10 ms sampled\n\n", minutes,
+           ref.caps.size());
+    printf("%-8s %10s %6s %9s %9s %6s %9s %9s\n", "backoff", "wakeup/min", "caps",
+           "p50 ms", "max ms", "rels", "p50 ms", "max ms");
+    for (size_t m = 0; m < sizeof(monitors) / sizeof(monitors[0]); m++) {
+        GpuRun run = gpu_run(freqs, monitors[m], THROTTLE_MODE_LEGACY);
+        std::vector<int64_t> capLate = gpu_lateness(ref.caps, run.caps);
+        std::vector<int64_t> relLate = gpu_lateness(ref.releases, run.releases);
+
+        printf("%-8s %10.1f %6zu %9.0f %9.0f %6zu %9.0f %9.0f\n", names[m],
+               (double)run.samples / minutes, run.caps.size(),
+               percentile(capLate, 50) / 1e6, percentile(capLate, 100) / 1e6,
+               run.releases.size(), percentile(relLate, 50) / 1e6,
+               percentile(relLate, 100) / 1e6);
+    }
+}
+
+static void throttle_report(int minutes)
+{
+    std::vector<int> freqs = gpu_load(minutes);
+    GpuFreqMonitor monitor("", NULL, NULL);
+    enum gpu_throttle_mode modes[] = { THROTTLE_MODE_LEGACY, THROTTLE_MODE_PID };
+    const char *names[] = { "legacy", "pid" };
+    int64_t totalNs = freqs.size() * GPU_TICK_NS;
+
+    printf("%d min of load, sampled as the HAL does\n\n", minutes);
+    printf("%-7s %10s %10s %8s %8s %10s %9s\n", "mode", "wakeup/min", "throttled", "caps",
+           "changes", "perf lost", "rel p50");
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        GpuRun ref = gpu_run(freqs, NULL, modes[m]);
+        GpuRun run = gpu_run(freqs, &monitor, modes[m]);
+        std::vector<int64_t> relLate = gpu_lateness(ref.releases, run.releases);
+
+        printf("%-7s %10.1f %9.1f%% %8zu %8lu %9.1f%% %6.0f ms\n", names[m],
+               (double)run.samples / minutes, 100.0 * run.cappedNs / totalNs,
+               run.caps.size(), run.changes, run.lostPctNs / totalNs,
+               percentile(relLate, 50) / 1e6);
+    }
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: powerhal_replay report <trace>\n"
+                    "       powerhal_replay replay <trace> <module.so> <output trace> [speed [root]]\n"
+                    "       powerhal_replay coalesce <trace> [boostpulse_duration_us]\n"
+                    "       powerhal_replay touch <trace>\n"
+                    "       powerhal_replay gestures [rate ...]\n"
+                    "       powerhal_replay gpu [minutes]\n"
+                    "       powerhal_replay throttle [minutes]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    Trace trace, result;
+
+    if (argc >= 2 && !strcmp(argv[1], "gestures")) {
+        std::vector<int> rates;
+
+        for (int i = 2; i < argc; i++)
+            rates.push_back(atoi(argv[i]));
+        if (rates.empty())
+            rates = { 30, 60, 90, 120, 240 };
+        return gesture_suite(rates);
+    }
+
+    if (argc >= 2 && !strcmp(argv[1], "gpu")) {
+        gpu_report(argc > 2 ? atoi(argv[2]) : 60);
+        return 0;
+    }
+    if (argc >= 2 && !strcmp(argv[1], "throttle")) {
+        throttle_report(argc > 2 ? atoi(argv[2]) : 60);
+        return 0;
+    }
+
+    if (argc < 3)
+        usage();
+    if (load_trace(argv[2], trace))
+        return 1;
+
+    if (!strcmp(argv[1], "report")) {
+        report(trace);
+        return 0;
+    }
+    if (!strcmp(argv[1], "coalesce"))
+        return coalesce_report(trace, (argc > 3 ? atoll(argv[3]) : 80000) * 1000) ? 1 : 0;
+    if (!strcmp(argv[1], "touch")) {
+        touch_report(trace);
+        return 0;
+    }
+    if (strcmp(argv[1], "replay") || argc < 5)
+        usage();
+
+    if (replay(trace, argv[3], argv[4], argc > 5 ? atof(argv[5]) : 1.0,
+               argc > 6 ? argv[6] : NULL) ||
+        load_trace(argv[4], result))
+        return 1;
+    report(result);
+    return 0;
+}
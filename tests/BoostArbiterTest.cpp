@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "BoostArbiter.h"
+
+#define MS 1000000LL
+
+static BoostArbiter *arbiter;
+static std::vector<int> writes;
+static int failWrites;
+
+/* Reads the arbiter back, which deadlocked while writers ran under its lock */
+static int record_write(int value)
+{
+    EXPECT_EQ(value, arbiter->value(RES_INTERACTIVE_BOOST));
+    if (failWrites > 0) {
+        failWrites--;
+        return -1;
+    }
+    writes.push_back(value);
+    return 0;
+}
+
+static struct BoostRequest request(enum boost_client client, enum boost_kind kind, int level,
+                                   enum boost_priority priority, int64_t deadlineNs = 0,
+                                   enum boost_resource resource = RES_INTERACTIVE_BOOST)
+{
+    struct BoostRequest request;
+
+    request.client = client;
+    request.resource = resource;
+    request.kind = kind;
+    request.level = level;
+    request.priority = priority;
+    request.deadlineNs = deadlineNs;
+    return request;
+}
+
+class BoostArbiterTest : public ::testing::Test {
+
+  protected:
+      BoostArbiter mArbiter;
+
+      void SetUp() override {
+          arbiter = &mArbiter;
+          writes.clear();
+          failWrites = 0;
+          mArbiter.setResource(RES_INTERACTIVE_BOOST, 50, record_write);
+      };
+      int value() { return mArbiter.value(RES_INTERACTIVE_BOOST); };
+};
+
+TEST_F(BoostArbiterTest, HighestFloorLowestCeiling)
+{
+    mArbiter.submit(request(CLIENT_TOUCH, BOOST_FLOOR, 60, PRIORITY_NORMAL));
+    mArbiter.submit(request(CLIENT_LAUNCH, BOOST_FLOOR, 80, PRIORITY_NORMAL));
+    EXPECT_EQ(80, value());
+    mArbiter.submit(request(CLIENT_LOW_POWER, BOOST_CEILING, 70, PRIORITY_LOW));
+    mArbiter.submit(request(CLIENT_GPU_THROTTLE, BOOST_CEILING, 90, PRIORITY_LOW));
+    /* a floor of higher priority beats the ceiling */
+    EXPECT_EQ(80, value());
+    mArbiter.cancel(CLIENT_LAUNCH, RES_INTERACTIVE_BOOST);
+    EXPECT_EQ(60, value());
+}
+
+TEST_F(BoostArbiterTest, CeilingWinsAtEqualPriority)
+{
+    mArbiter.submit(request(CLIENT_LAUNCH, BOOST_FLOOR, 80, PRIORITY_NORMAL));
+    mArbiter.submit(request(CLIENT_GPU_THROTTLE, BOOST_CEILING, 70, PRIORITY_NORMAL));
+    EXPECT_EQ(70, value());
+}
+
+TEST_F(BoostArbiterTest, CeilingWinsOverLowerPriorityFloor)
+{
+    mArbiter.submit(request(CLIENT_LAUNCH, BOOST_FLOOR, 80, PRIORITY_LOW));
+    mArbiter.submit(request(CLIENT_GPU_THROTTLE, BOOST_CEILING, 70, PRIORITY_HIGH));
+    EXPECT_EQ(70, value());
+    /* raising the floor's priority past the ceiling's lets it through */
+    mArbiter.submit(request(CLIENT_GPU_THROTTLE, BOOST_CEILING, 70, PRIORITY_LOW));
+    mArbiter.submit(request(CLIENT_LAUNCH, BOOST_FLOOR, 80, PRIORITY_HIGH));
+    EXPECT_EQ(80, value());
+}
+
+TEST_F(BoostArbiterTest, WritesOnlyChanges)
+{
+    mArbiter.submit(request(CLIENT_TOUCH, BOOST_FLOOR, 60, PRIORITY_NORMAL));
+    mArbiter.submit(request(CLIENT_LAUNCH, BOOST_FLOOR, 60, PRIORITY_NORMAL));
+    mArbiter.submit(request(CLIENT_TOUCH, BOOST_FLOOR, 40, PRIORITY_NORMAL));
+    mArbiter.cancel(CLIENT_LAUNCH, RES_INTERACTIVE_BOOST);
+    EXPECT_EQ((std::vector<int>{ 60, 50 }), writes);
+}
+
+TEST_F(BoostArbiterTest, FailedWriteIsRetried)
+{
+    failWrites = 1;
+    mArbiter.submit(request(CLIENT_TOUCH, BOOST_FLOOR, 60, PRIORITY_NORMAL));
+    EXPECT_TRUE(writes.empty());
+    mArbiter.submit(request(CLIENT_TOUCH, BOOST_FLOOR, 60, PRIORITY_NORMAL));
+    EXPECT_EQ((std::vector<int>{ 60 }), writes);
+}
+
+TEST_F(BoostArbiterTest, ExpiresInDeadlineOrder)
+{
+    mArbiter.submit(request(CLIENT_LAUNCH, BOOST_FLOOR, 90, PRIORITY_NORMAL, 200 * MS));
+    mArbiter.submit(request(CLIENT_TOUCH, BOOST_FLOOR, 70, PRIORITY_NORMAL, 300 * MS));
+    mArbiter.submit(request(CLIENT_INTERACTIVE, BOOST_FLOOR, 60, PRIORITY_NORMAL, 100 * MS));
+
+    EXPECT_EQ(50 * MS, mArbiter.expire(150 * MS));
+    EXPECT_EQ(90, value());
+    EXPECT_EQ(50 * MS, mArbiter.expire(250 * MS));
+    EXPECT_EQ(70, value());
+    EXPECT_EQ(-1, mArbiter.expire(300 * MS));
+    EXPECT_EQ(50, value());
+    EXPECT_EQ((std::vector<int>{ 90, 70, 50 }), writes);
+}
+
+/* Replaced and cancelled requests leave heap entries that must not fire */
+TEST_F(BoostArbiterTest, StaleDeadlinesSkipped)
+{
+    mArbiter.submit(request(CLIENT_LAUNCH, BOOST_FLOOR, 90, PRIORITY_NORMAL, 100 * MS));
+    mArbiter.submit(request(CLIENT_LAUNCH, BOOST_FLOOR, 90, PRIORITY_NORMAL, 400 * MS));
+    EXPECT_EQ(300 * MS, mArbiter.expire(100 * MS));
+    EXPECT_TRUE(mArbiter.active(CLIENT_LAUNCH, RES_INTERACTIVE_BOOST));
+
+    mArbiter.submit(request(CLIENT_TOUCH, BOOST_FLOOR, 70, PRIORITY_NORMAL, 200 * MS));
+    mArbiter.cancel(CLIENT_TOUCH, RES_INTERACTIVE_BOOST);
+    /* a new request after the cancel gets a generation of its own */
+    mArbiter.submit(request(CLIENT_TOUCH, BOOST_FLOOR, 70, PRIORITY_NORMAL));
+    EXPECT_EQ(200 * MS, mArbiter.expire(200 * MS));
+    EXPECT_TRUE(mArbiter.active(CLIENT_TOUCH, RES_INTERACTIVE_BOOST));
+
+    EXPECT_EQ(-1, mArbiter.expire(400 * MS));
+    EXPECT_FALSE(mArbiter.active(CLIENT_LAUNCH, RES_INTERACTIVE_BOOST));
+    EXPECT_EQ(70, value());
+}
+
+static std::atomic<bool> slowWriting;
+
+static int slow_write(int)
+{
+    slowWriting = true;
+    usleep(200 * 1000);
+    slowWriting = false;
+    return 0;
+}
+
+/* A knob that takes long to write holds up its own callers only */
+TEST_F(BoostArbiterTest, SlowWriterBlocksOnlyItsKnob)
+{
+    struct timespec start, end;
+    std::thread slow;
+
+    mArbiter.setResource(RES_PSTATE_LEVEL, 0, slow_write);
+    slow = std::thread([this] {
+        mArbiter.submit(request(CLIENT_LAUNCH, BOOST_FLOOR, 1, PRIORITY_NORMAL, 0,
+                                RES_PSTATE_LEVEL));
+    });
+    while (!slowWriting)
+        usleep(1000);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    mArbiter.submit(request(CLIENT_TOUCH, BOOST_FLOOR, 60, PRIORITY_NORMAL));
+    mArbiter.expire(0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    EXPECT_TRUE(slowWriting);
+    EXPECT_LT((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000, 50);
+    slow.join();
+    EXPECT_EQ(1, mArbiter.value(RES_PSTATE_LEVEL));
+}
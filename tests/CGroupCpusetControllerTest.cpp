@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+
+#include "CGroupCpusetController.h"
+#include "CpuTopology.h"
+#include "SysfsIo.h"
+#include "bench/FakeSysfs.h"
+
+#define CPUFREQ_DIR "/sys/devices/system/cpu/cpufreq"
+#define CPUSET_DIR "/dev/cpuset"
+
+/* A /dev/cpuset of eight cpus with the groups the defaults touch */
+class CGroupCpusetControllerTest : public ::testing::Test {
+
+  protected:
+      FakeSysfs mSysfs;
+      CpuTopology mTopology;
+      CGroupCpusetController mController;
+
+      void SetUp() override {
+          mSysfs.addCpusets("0-7");
+          mSysfs.write(CPUSET_DIR "/background/cpus", "0-7");
+          mSysfs.write(CPUSET_DIR "/system-background/cpus", "0-7");
+          mSysfs.write(CPUSET_DIR "/foreground/cpus", "0-7");
+          SysfsIo::setRoot(mSysfs.root().c_str());
+      };
+      void TearDown() override { SysfsIo::setRoot(""); };
+
+      void init() {
+          ASSERT_EQ(0, mTopology.scan());
+          mController.init(mTopology);
+      };
+      std::string cpus(const char *group) {
+          return mSysfs.read(std::string(CPUSET_DIR "/") + group + "/cpus");
+      };
+};
+
+TEST_F(CGroupCpusetControllerTest, HybridDefaults)
+{
+    mSysfs.addCpus(8, 4);
+    mSysfs.write("/sys/devices/cpu_core/cpus", "0-3");
+    mSysfs.write("/sys/devices/cpu_atom/cpus", "4-7");
+    init();
+
+    mController.setState(0);
+    EXPECT_EQ("4-7", cpus("non_interactive"));
+    EXPECT_EQ("4-7", cpus("background"));
+    EXPECT_EQ("4-7", cpus("system-background"));
+    EXPECT_EQ("0-7", cpus("foreground"));
+
+    mController.setState(1);
+    EXPECT_EQ("0-7", cpus("non_interactive"));
+    EXPECT_EQ("0-7", cpus("background"));
+    EXPECT_EQ("0-7", cpus("system-background"));
+}
+
+TEST_F(CGroupCpusetControllerTest, NonHybridDefaults)
+{
+    mSysfs.addCpus(8, 4);
+    init();
+
+    mController.setState(0);
+    EXPECT_EQ("0", cpus("non_interactive"));
+    EXPECT_EQ("0-7", cpus("background"));
+    EXPECT_EQ("0-7", cpus("system-background"));
+
+    mController.setState(1);
+    EXPECT_EQ("0-7", cpus("non_interactive"));
+}
+
+/* A few bins between ITMT favoured cores do not make a part hybrid */
+TEST_F(CGroupCpusetControllerTest, ItmtPartKeepsNonHybridDefaults)
+{
+    mSysfs.addCpus(8, 2);
+    mSysfs.write(CPUFREQ_DIR "/policy0/cpuinfo_max_freq", "3100000");
+    mSysfs.write(CPUFREQ_DIR "/policy2/cpuinfo_max_freq", "3000000");
+    mSysfs.write(CPUFREQ_DIR "/policy4/cpuinfo_max_freq", "2900000");
+    mSysfs.write(CPUFREQ_DIR "/policy6/cpuinfo_max_freq", "2900000");
+    init();
+
+    mController.setState(0);
+    EXPECT_EQ("0", cpus("non_interactive"));
+    EXPECT_EQ("0-7", cpus("background"));
+    EXPECT_EQ("0-7", cpus("system-background"));
+}
+
+/* The vendor table adds groups and overrides defaults per state */
+TEST_F(CGroupCpusetControllerTest, ConfigOverridesDefaults)
+{
+    mSysfs.addCpus(8, 4);
+    mSysfs.write("/sys/devices/cpu_core/cpus", "0-3");
+    mSysfs.write("/sys/devices/cpu_atom/cpus", "4-7");
+    mSysfs.write("/vendor/etc/powerhal_cpusets.conf",
+                 "# screen off\n"
+                 "foreground non_interactive performance\n"
+                 "background non_interactive 6-7   # two E-cores\n"
+                 "background bogus 0\n"
+                 "background interactive 0-5,9\n");
+    init();
+
+    mController.setState(0);
+    EXPECT_EQ("0-3", cpus("foreground"));
+    EXPECT_EQ("6-7", cpus("background"));
+    EXPECT_EQ("4-7", cpus("system-background"));
+
+    mController.setState(1);
+    EXPECT_EQ("0-7", cpus("foreground"));
+    EXPECT_EQ("0-5", cpus("background"));
+}
+
+/* A cpuset that already holds the cpus is left as the kernel printed it */
+TEST_F(CGroupCpusetControllerTest, UnchangedCpusetNotWritten)
+{
+    mSysfs.addCpus(8, 4);
+    mSysfs.write(CPUSET_DIR "/non_interactive/cpus", "0-3,4-7");
+    init();
+
+    mController.setState(1);
+    EXPECT_EQ("0-3,4-7", cpus("non_interactive"));
+    mController.setState(0);
+    EXPECT_EQ("0", cpus("non_interactive"));
+}
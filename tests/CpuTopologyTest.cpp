@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "CpuTopology.h"
+#include "SysfsIo.h"
+#include "bench/FakeSysfs.h"
+
+#define CPUFREQ_DIR "/sys/devices/system/cpu/cpufreq"
+
+class CpuTopologyTest : public ::testing::Test {
+
+  protected:
+      FakeSysfs mSysfs;
+
+      void SetUp() override { SysfsIo::setRoot(mSysfs.root().c_str()); };
+      void TearDown() override { SysfsIo::setRoot(""); };
+
+      void setMaxFreq(int policy, unsigned long khz) {
+          mSysfs.write(CPUFREQ_DIR "/policy" + std::to_string(policy) + "/cpuinfo_max_freq",
+                       std::to_string(khz));
+      };
+};
+
+TEST_F(CpuTopologyTest, PmusDecideCoreTypes)
+{
+    CpuTopology topology;
+    std::vector<CpufreqPolicy> policies;
+
+    mSysfs.addCpus(8, 4);
+    mSysfs.write("/sys/devices/cpu_core/cpus", "0-3");
+    mSysfs.write("/sys/devices/cpu_atom/cpus", "4-7");
+    ASSERT_EQ(0, topology.scan());
+
+    policies = topology.policies();
+    ASSERT_EQ(2u, policies.size());
+    EXPECT_EQ(CORE_TYPE_PERFORMANCE, policies[0].coreType);
+    EXPECT_EQ(CORE_TYPE_EFFICIENCY, policies[1].coreType);
+}
+
+/* ITMT favoured cores run a few bins above the rest, they are not E-cores */
+TEST_F(CpuTopologyTest, ItmtSpreadStaysUnknown)
+{
+    CpuTopology topology;
+
+    mSysfs.addCpus(8, 2);
+    setMaxFreq(0, 3000000);
+    setMaxFreq(2, 2900000);
+    setMaxFreq(4, 3100000);
+    setMaxFreq(6, 2800000);
+    ASSERT_EQ(0, topology.scan());
+
+    for (const CpufreqPolicy &policy : topology.policies())
+        EXPECT_EQ(CORE_TYPE_UNKNOWN, policy.coreType) << policy.path;
+}
+
+TEST_F(CpuTopologyTest, FrequencyGapSplitsCoreTypes)
+{
+    CpuTopology topology;
+    std::vector<CpufreqPolicy> policies;
+
+    mSysfs.addCpus(8, 4);
+    setMaxFreq(4, 1800000);
+    ASSERT_EQ(0, topology.scan());
+
+    policies = topology.policies();
+    ASSERT_EQ(2u, policies.size());
+    EXPECT_EQ(CORE_TYPE_PERFORMANCE, policies[0].coreType);
+    EXPECT_EQ(CORE_TYPE_EFFICIENCY, policies[1].coreType);
+}
+
+/* Readers hold a copy, a hotplug rescan must not free it under them */
+TEST_F(CpuTopologyTest, RescanWhileReading)
+{
+    CpuTopology topology;
+    std::atomic<bool> done(false);
+    std::atomic<int> bad(0);
+
+    mSysfs.addCpus(4, 2);
+    ASSERT_EQ(0, topology.scan());
+
+    std::thread reader([&] {
+        for (int i = 0; i < 2000; i++) {
+            std::vector<CpufreqPolicy> policies = topology.policies();
+
+            if (policies.size() != 2 || policies[0].path.find("policy0") == std::string::npos)
+                bad++;
+            topology.capMaxFreq(i % 2 ? 80 : 100);
+        }
+        done = true;
+    });
+    while (!done)
+        topology.scan();
+    reader.join();
+
+    EXPECT_EQ(0, bad.load());
+    EXPECT_EQ(4, topology.onlineCpus().count());
+}
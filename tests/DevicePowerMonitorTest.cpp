@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/netlink.h>
+
+#include <gtest/gtest.h>
+
+#include <cutils/properties.h>
+
+#include "DevicePowerMonitor.h"
+#include "PropertyCache.h"
+#include "SysfsIo.h"
+#include "bench/FakeSysfs.h"
+
+#define DEVICES 4
+#define DEVICE_DELAY_MS 50
+
+/* every device takes DEVICE_DELAY_MS to power up or down */
+static int slow_device(const char *path, enum sysfs_op op)
+{
+    if (op == SYSFS_OP_WRITE && strstr(path, "/power_HAL_suspend/"))
+        usleep(DEVICE_DELAY_MS * 1000);
+    return 0;
+}
+
+static int64_t elapsed_ms(const struct timespec &start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+}
+
+static int64_t resume_ms(DevicePowerMonitor *monitor)
+{
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    monitor->setState(1);
+    return elapsed_ms(start);
+}
+
+/* Screen on takes as long as the slowest device, not all of them together */
+TEST(DevicePowerMonitorTest, ParallelResumeTakesTheMax)
+{
+    FakeSysfs sysfs;
+    /* the watch thread lives on, as with the HAL's static instance */
+    DevicePowerMonitor *monitor = new DevicePowerMonitor();
+    int64_t serial, parallel;
+
+    sysfs.setDevices(DEVICES);
+    SysfsIo::setRoot(sysfs.root().c_str());
+    SysfsIo::setFaultHook(slow_device);
+
+    property_set("vendor.powerhal.device_parallel", "0");
+    PropertyCache::refresh();
+    ASSERT_EQ((size_t)DEVICES, monitor->rescan());
+    serial = resume_ms(monitor);
+
+    property_set("vendor.powerhal.device_parallel", "1");
+    PropertyCache::refresh();
+    ASSERT_EQ((size_t)DEVICES, monitor->rescan());
+    parallel = resume_ms(monitor);
+
+    SysfsIo::setFaultHook(NULL);
+    EXPECT_GE(serial, DEVICES * DEVICE_DELAY_MS);
+    EXPECT_GE(parallel, DEVICE_DELAY_MS);
+    EXPECT_LT(parallel, 2 * DEVICE_DELAY_MS);
+    printf("resume of %d devices: serial %lld ms, parallel %lld ms\n", DEVICES,
+           (long long)serial, (long long)parallel);
+}
+
+#define HAL_DIR "/sys/power/power_HAL_suspend"
+#define SETTLE_MS 2000
+
+/* Polls until the monitor knows count devices, returns how long it took */
+static int64_t wait_devices(DevicePowerMonitor *monitor, size_t count)
+{
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (monitor->devices() != count && elapsed_ms(start) < SETTLE_MS)
+        usleep(1000);
+    return elapsed_ms(start);
+}
+
+TEST(DevicePowerMonitorTest, AddRemoveLatency)
+{
+    FakeSysfs sysfs;
+    DevicePowerMonitor *monitor = new DevicePowerMonitor();
+    int64_t added, removed;
+
+    sysfs.setDevices(2);
+    SysfsIo::setRoot(sysfs.root().c_str());
+    monitor->setState(1);
+    ASSERT_EQ(2u, monitor->devices());
+
+    sysfs.setDevices(3);
+    added = wait_devices(monitor, 3);
+    sysfs.setDevices(2);
+    removed = wait_devices(monitor, 2);
+
+    EXPECT_EQ(2u, monitor->devices());
+    EXPECT_LT(added, SETTLE_MS);
+    EXPECT_LT(removed, SETTLE_MS);
+    printf("device seen %lld ms after it was added, dropped %lld ms after removal\n",
+           (long long)added, (long long)removed);
+}
+
+static int send_uevent(int fd, const std::string &action, const std::string &devpath)
+{
+    struct sockaddr_nl addr;
+    std::string msg = action + "@" + devpath;
+
+    msg += '\0';
+    msg += "ACTION=" + action;
+    msg += '\0';
+    msg += "DEVPATH=" + devpath;
+    msg += '\0';
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1;
+    return sendto(fd, msg.data(), msg.size(), 0, (struct sockaddr *) &addr, sizeof(addr));
+}
+
+/* Uevents about other devices leave the set alone, one about a device drops it */
+TEST(DevicePowerMonitorTest, UeventsFilteredByDevpath)
+{
+    FakeSysfs sysfs;
+    DevicePowerMonitor *monitor = new DevicePowerMonitor();
+    int fd;
+
+    sysfs.setDevices(2);
+    SysfsIo::setRoot(sysfs.root().c_str());
+    monitor->setState(1);
+    ASSERT_EQ(2u, monitor->devices());
+
+    fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0 || send_uevent(fd, "change", "/devices/virtual/misc/none") < 0) {
+        int err = errno;
+
+        if (fd >= 0)
+            close(fd);
+        GTEST_SKIP() << "cannot send uevents: " << strerror(err);
+    }
+
+    for (int i = 0; i < 100; i++) {
+        send_uevent(fd, "add", "/devices/virtual/input/input" + std::to_string(i));
+        send_uevent(fd, "remove", "/devices/platform/dev0.extra" + std::to_string(i));
+    }
+    usleep(200 * 1000);
+    EXPECT_EQ(2u, monitor->devices());
+
+    /* the node is still there, only the uevent says the device is gone */
+    send_uevent(fd, "remove", "/devices/platform/i2c-0/dev0");
+    EXPECT_LT(wait_devices(monitor, 1), SETTLE_MS);
+    send_uevent(fd, "bind", "/devices/platform/i2c-0/dev0");
+    EXPECT_LT(wait_devices(monitor, 2), SETTLE_MS);
+    close(fd);
+}
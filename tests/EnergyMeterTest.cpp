@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+
+#include "EnergyMeter.h"
+#include "SysfsIo.h"
+#include "bench/FakeSysfs.h"
+
+#define RANGE_UJ 1000000ULL
+/* intel-rapl:0 sorts first, so the package is zone 0 */
+#define PACKAGE "intel-rapl:0"
+
+class EnergyMeterTest : public ::testing::Test {
+  protected:
+      void SetUp() override {
+          sysfs.addRapl(1, RANGE_UJ);
+          SysfsIo::setRoot(sysfs.root().c_str());
+      };
+      void TearDown() override {
+          EnergyMeter::reset();
+          SysfsIo::setRoot("");
+      };
+
+      FakeSysfs sysfs;
+};
+
+TEST_F(EnergyMeterTest, ChargesTheDelta)
+{
+    ASSERT_EQ(0, EnergyMeter::init());
+    sysfs.setEnergy(PACKAGE, 5000);
+    EXPECT_EQ(5000u, EnergyMeter::stateUj(0, 0));
+    sysfs.setEnergy(PACKAGE, 7500);
+    EXPECT_EQ(7500u, EnergyMeter::stateUj(0, 0));
+}
+
+/* The counter reaches RANGE_UJ itself before it goes on from 0 */
+TEST_F(EnergyMeterTest, CountsAcrossAWrap)
+{
+    ASSERT_EQ(0, EnergyMeter::init());
+    sysfs.setEnergy(PACKAGE, RANGE_UJ - 1000);
+    EXPECT_EQ(RANGE_UJ - 1000, EnergyMeter::stateUj(0, 0));
+    sysfs.setEnergy(PACKAGE, 500);
+    EXPECT_EQ(RANGE_UJ - 1000 + 1501, EnergyMeter::stateUj(0, 0));
+}
+
+/* Without a range a lower counter cannot be told apart, so it adds nothing */
+TEST_F(EnergyMeterTest, NoRangeChargesNothingOnAWrap)
+{
+    sysfs.remove(POWERCAP_ROOT "/" PACKAGE "/max_energy_range_uj");
+    ASSERT_EQ(0, EnergyMeter::init());
+    sysfs.setEnergy(PACKAGE, 9000);
+    EXPECT_EQ(9000u, EnergyMeter::stateUj(0, 0));
+    sysfs.setEnergy(PACKAGE, 100);
+    EXPECT_EQ(9000u, EnergyMeter::stateUj(0, 0));
+    sysfs.setEnergy(PACKAGE, 400);
+    EXPECT_EQ(9300u, EnergyMeter::stateUj(0, 0));
+}
+
+/* Each test probes its own tree */
+TEST_F(EnergyMeterTest, InitRunsAgainAfterReset)
+{
+    ASSERT_EQ(0, EnergyMeter::init());
+    EnergyMeter::reset();
+    sysfs.remove(POWERCAP_ROOT);
+    EXPECT_EQ(-1, EnergyMeter::init());
+    EXPECT_EQ(0u, EnergyMeter::stateUj(0, 0));
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <pthread.h>
+#include <time.h>
+
+#include <gtest/gtest.h>
+
+#include "GpuFreqMonitor.h"
+#include "SysfsIo.h"
+#include "bench/FakeSysfs.h"
+
+#define GPU_FREQ_PATH "/sys/class/drm/card0/gt_act_freq_mhz"
+/* Only bounds a hang when the monitor is broken, never a pass condition */
+#define WAIT_LIMIT_S 5
+/* No second sample comes within the test */
+#define INTERVAL_MS 60000
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static bool sampled;
+static bool exitRequested;
+static bool exited;
+
+static bool wait_for(const bool *flag)
+{
+    struct timespec deadline;
+    bool ret;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += WAIT_LIMIT_S;
+    pthread_mutex_lock(&lock);
+    while (!*flag && pthread_cond_timedwait(&cond, &lock, &deadline) == 0)
+        ;
+    ret = *flag;
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+static void set_flag(bool *flag)
+{
+    pthread_mutex_lock(&lock);
+    *flag = true;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+}
+
+static enum gpu_sample_rate sample(int)
+{
+    set_flag(&sampled);
+    return GPU_SAMPLE_IDLE;
+}
+
+static bool should_exit(void)
+{
+    bool ret;
+
+    pthread_mutex_lock(&lock);
+    ret = exitRequested;
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+static void *run_monitor(void *data)
+{
+    static_cast<GpuFreqMonitor *>(data)->run();
+    set_flag(&exited);
+    return NULL;
+}
+
+/* An exit asked for between two samples stops the loop without a sample */
+TEST(GpuFreqMonitorTest, WakeExitsBeforeTheNextSample)
+{
+    FakeSysfs sysfs;
+    GpuFreqMonitor monitor(GPU_FREQ_PATH, sample, should_exit);
+    pthread_t thread;
+
+    sysfs.addGpu(300);
+    SysfsIo::setRoot(sysfs.root().c_str());
+    monitor.setIntervals(INTERVAL_MS, INTERVAL_MS, INTERVAL_MS, INTERVAL_MS);
+    ASSERT_EQ(0, pthread_create(&thread, NULL, run_monitor, &monitor));
+
+    /* the first sample is taken right away */
+    ASSERT_TRUE(wait_for(&sampled));
+
+    set_flag(&exitRequested);
+    monitor.wake();
+    EXPECT_TRUE(wait_for(&exited));
+    pthread_join(thread, NULL);
+    EXPECT_EQ(1ul, monitor.samples());
+    SysfsIo::setRoot("");
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+
+#include "CpuTopology.h"
+#include "IntelPstateBackend.h"
+#include "SysfsIo.h"
+#include "SysfsNode.h"
+#include "bench/FakeSysfs.h"
+
+#define PSTATE_DIR "/sys/devices/system/cpu/intel_pstate"
+#define POLICY0 "/sys/devices/system/cpu/cpufreq/policy0"
+#define POLICY4 "/sys/devices/system/cpu/cpufreq/policy4"
+
+/* Two policies of four cpus; each test adds the driver it runs against */
+class IntelPstateBackendTest : public ::testing::Test {
+
+  protected:
+      FakeSysfs mSysfs;
+      CpuTopology mTopology;
+      IntelPstateBackend mBackend;
+
+      IntelPstateBackendTest(): mBackend(&mTopology) {};
+
+      void SetUp() override {
+          mSysfs.addCpus(8, 4);
+          SysfsIo::setRoot(mSysfs.root().c_str());
+          SysfsNodeRegistry::closeAll();
+      };
+      void TearDown() override { SysfsIo::setRoot(""); };
+
+      int probe() {
+          EXPECT_EQ(0, mTopology.scan());
+          return mBackend.probe();
+      };
+      std::string epp(const char *policy) {
+          return mSysfs.read(std::string(policy) + "/energy_performance_preference");
+      };
+      std::string minFreq(const char *policy) {
+          return mSysfs.read(std::string(policy) + "/scaling_min_freq");
+      };
+};
+
+TEST_F(IntelPstateBackendTest, HwpWithEpp)
+{
+    mSysfs.addIntelPstate(true);
+    ASSERT_EQ(0, probe());
+    EXPECT_EQ((unsigned)(PSTATE_CAP_ACTIVE | PSTATE_CAP_HWP | PSTATE_CAP_EPP), mBackend.caps());
+
+    EXPECT_EQ(0, mBackend.apply(PSTATE_LAUNCH));
+    EXPECT_EQ("performance", epp(POLICY0));
+    EXPECT_EQ("3000000", minFreq(POLICY4));
+
+    EXPECT_EQ(0, mBackend.apply(PSTATE_LOW_POWER));
+    EXPECT_EQ("power", epp(POLICY4));
+    EXPECT_EQ("800000", minFreq(POLICY0));
+
+    EXPECT_EQ(0, mBackend.restore());
+    EXPECT_EQ("balance_performance", epp(POLICY0));
+    EXPECT_EQ("balance_performance", epp(POLICY4));
+    EXPECT_EQ("20", mSysfs.read(PSTATE_DIR "/min_perf_pct"));
+}
+
+/* A level whose preference the part does not offer keeps the probed one */
+TEST_F(IntelPstateBackendTest, HwpWithPartialPreferences)
+{
+    mSysfs.addIntelPstate(true);
+    mSysfs.write(POLICY0 "/energy_performance_available_preferences", "default performance");
+    ASSERT_EQ(0, probe());
+
+    EXPECT_EQ(0, mBackend.apply(PSTATE_LOW_POWER));
+    EXPECT_EQ("balance_performance", epp(POLICY0));
+    EXPECT_EQ(0, mBackend.apply(PSTATE_LAUNCH));
+    EXPECT_EQ("performance", epp(POLICY0));
+}
+
+/* The performance governor pins EPP, the policy only gets its min freq */
+TEST_F(IntelPstateBackendTest, PerformanceGovernorKeepsEpp)
+{
+    mSysfs.addIntelPstate(true);
+    mSysfs.write(POLICY4 "/scaling_governor", "performance");
+    ASSERT_EQ(0, probe());
+
+    EXPECT_EQ(0, mBackend.apply(PSTATE_LAUNCH));
+    EXPECT_EQ("performance", epp(POLICY0));
+    EXPECT_EQ("balance_performance", epp(POLICY4));
+    EXPECT_EQ("3000000", minFreq(POLICY4));
+}
+
+TEST_F(IntelPstateBackendTest, HwpWithoutEpp)
+{
+    mSysfs.addIntelPstate(true);
+    mSysfs.remove(POLICY0 "/energy_performance_preference");
+    mSysfs.remove(POLICY4 "/energy_performance_preference");
+    ASSERT_EQ(0, probe());
+    EXPECT_EQ((unsigned)(PSTATE_CAP_ACTIVE | PSTATE_CAP_HWP), mBackend.caps());
+
+    EXPECT_EQ(0, mBackend.apply(PSTATE_LAUNCH));
+    EXPECT_EQ("3000000", minFreq(POLICY0));
+    EXPECT_EQ("", epp(POLICY0));
+    EXPECT_EQ(0, mBackend.restore());
+    EXPECT_EQ("800000", minFreq(POLICY0));
+}
+
+/* Without HWP only the global min_perf_pct moves */
+TEST_F(IntelPstateBackendTest, NoHwp)
+{
+    mSysfs.addIntelPstate(false);
+    ASSERT_EQ(0, probe());
+    EXPECT_EQ((unsigned)PSTATE_CAP_ACTIVE, mBackend.caps());
+
+    EXPECT_EQ(0, mBackend.apply(PSTATE_LAUNCH));
+    EXPECT_EQ("100", mSysfs.read(PSTATE_DIR "/min_perf_pct"));
+    EXPECT_EQ("800000", minFreq(POLICY0));
+    EXPECT_EQ(0, mBackend.restore());
+    EXPECT_EQ("20", mSysfs.read(PSTATE_DIR "/min_perf_pct"));
+}
+
+/* With turbo off a launch min freq above the base one would be rejected */
+TEST_F(IntelPstateBackendTest, NoTurboLaunchesAtBaseFrequency)
+{
+    mSysfs.addIntelPstate(true);
+    mSysfs.write(POLICY0 "/base_frequency", "2000000");
+    mSysfs.write(POLICY4 "/scaling_max_freq", "2200000");
+    mSysfs.write(PSTATE_DIR "/no_turbo", "1");
+    ASSERT_EQ(0, probe());
+
+    EXPECT_EQ(0, mBackend.apply(PSTATE_LAUNCH));
+    EXPECT_EQ("2000000", minFreq(POLICY0));
+    EXPECT_EQ("2200000", minFreq(POLICY4));
+
+    mSysfs.write(PSTATE_DIR "/no_turbo", "0");
+    EXPECT_EQ(0, mBackend.apply(PSTATE_LAUNCH));
+    EXPECT_EQ("3000000", minFreq(POLICY0));
+}
+
+TEST_F(IntelPstateBackendTest, PassiveModeDisables)
+{
+    mSysfs.addIntelPstate(true);
+    mSysfs.write(PSTATE_DIR "/status", "passive");
+    EXPECT_EQ(-1, probe());
+    EXPECT_EQ(0u, mBackend.caps());
+    EXPECT_EQ(-1, mBackend.apply(PSTATE_LAUNCH));
+}
+
+/* acpi-cpufreq parts have no intel_pstate directory at all */
+TEST_F(IntelPstateBackendTest, AcpiCpufreqFallsBack)
+{
+    mSysfs.write(POLICY0 "/scaling_driver", "acpi-cpufreq");
+    mSysfs.write(POLICY0 "/scaling_available_frequencies", "3000000 2400000 1600000 800000");
+    EXPECT_EQ(-1, probe());
+    EXPECT_EQ(0u, mBackend.caps());
+    EXPECT_EQ(-1, mBackend.apply(PSTATE_LAUNCH));
+    EXPECT_EQ("800000", minFreq(POLICY0));
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+
+#include "BoostArbiter.h"
+#include "CpuTopology.h"
+#include "IntelPstateBackend.h"
+#include "LaunchBoost.h"
+#include "SysfsIo.h"
+#include "SysfsNode.h"
+#include "bench/FakeSysfs.h"
+
+#define CPU_DIR "/sys/devices/system/cpu"
+#define INTERACTIVE_BOOST CPU_DIR "/cpufreq/interactive/boost"
+#define POLICY4 CPU_DIR "/cpufreq/policy4"
+#define TIMEOUT_MS 100
+#define MS 1000000LL
+
+static IntelPstateBackend *backend;
+
+static int pstate_write(int value)
+{
+    return backend->apply(value);
+}
+
+static int interactive_write(int value)
+{
+    return sysfs_write(INTERACTIVE_BOOST, value ? "1" : "0");
+}
+
+static int uclampPct;
+
+static int uclamp_write(int value)
+{
+    uclampPct = value;
+    return 0;
+}
+
+static struct timespec at(int64_t ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ns / 1000000000LL;
+    ts.tv_nsec = ns % 1000000000LL;
+    return ts;
+}
+
+class LaunchBoostTest : public ::testing::Test {
+
+  protected:
+      FakeSysfs mSysfs;
+      CpuTopology mTopology;
+      IntelPstateBackend mBackend;
+      BoostArbiter mArbiter;
+      LaunchBoost mLaunch;
+
+      LaunchBoostTest(): mBackend(&mTopology), mLaunch(&mArbiter) {};
+
+      void SetUp() override {
+          mSysfs.addCpus(8, 4);
+          mSysfs.addInteractiveGovernor();
+          mSysfs.addIntelPstate(true);
+          /* an EPP and min freq that differ from what any level writes */
+          mSysfs.write(POLICY4 "/energy_performance_preference", "balance_power");
+          mSysfs.write(POLICY4 "/scaling_min_freq", "1200000");
+          SysfsIo::setRoot(mSysfs.root().c_str());
+          SysfsNodeRegistry::closeAll();
+          ASSERT_EQ(0, mTopology.scan());
+          ASSERT_EQ(0, mBackend.probe());
+          backend = &mBackend;
+          mLaunch.setTimeout(TIMEOUT_MS);
+      };
+      void TearDown() override { SysfsIo::setRoot(""); };
+
+      void expectRestored() {
+          EXPECT_EQ("balance_performance",
+                    mSysfs.read(CPU_DIR "/cpufreq/policy0/energy_performance_preference"));
+          EXPECT_EQ("800000", mSysfs.read(CPU_DIR "/cpufreq/policy0/scaling_min_freq"));
+          EXPECT_EQ("balance_power", mSysfs.read(POLICY4 "/energy_performance_preference"));
+          EXPECT_EQ("1200000", mSysfs.read(POLICY4 "/scaling_min_freq"));
+      };
+
+      void expectLaunch() {
+          EXPECT_EQ("performance", mSysfs.read(POLICY4 "/energy_performance_preference"));
+          EXPECT_EQ("3000000", mSysfs.read(POLICY4 "/scaling_min_freq"));
+      };
+};
+
+/* A lost OFF hint: the deadline puts back the values found at probe */
+TEST_F(LaunchBoostTest, PstateReleasedAtDeadline)
+{
+    struct timespec now = at(1000 * MS);
+
+    mArbiter.setResource(RES_PSTATE_LEVEL, PSTATE_DEFAULT, pstate_write);
+    mLaunch.setBackend(LAUNCH_BOOST_INTEL_PSTATE);
+    mLaunch.acquire(&now);
+    expectLaunch();
+
+    EXPECT_EQ(1 * MS, mArbiter.expire(1099 * MS));
+    expectLaunch();
+    EXPECT_EQ(-1, mArbiter.expire(1100 * MS));
+    EXPECT_EQ(PSTATE_DEFAULT, mArbiter.value(RES_PSTATE_LEVEL));
+    expectRestored();
+}
+
+/* Overlapping launches hold the boost until the last one ends */
+TEST_F(LaunchBoostTest, PstateRestoredAfterLastRelease)
+{
+    struct timespec first = at(1000 * MS), second = at(1050 * MS);
+
+    mArbiter.setResource(RES_PSTATE_LEVEL, PSTATE_DEFAULT, pstate_write);
+    mLaunch.setBackend(LAUNCH_BOOST_INTEL_PSTATE);
+    mLaunch.acquire(&first);
+    mLaunch.acquire(&second);
+
+    /* the second launch pushed the deadline out */
+    EXPECT_EQ(50 * MS, mArbiter.expire(1100 * MS));
+    mLaunch.release();
+    expectLaunch();
+    mLaunch.release();
+    expectRestored();
+}
+
+/* A launch after a timed out one starts a new boost of its own */
+TEST_F(LaunchBoostTest, InteractiveBoostAfterTimeout)
+{
+    struct timespec first = at(1000 * MS), second = at(2000 * MS);
+
+    mArbiter.setResource(RES_INTERACTIVE_BOOST, 0, interactive_write);
+    mLaunch.setBackend(LAUNCH_BOOST_INTERACTIVE);
+    mLaunch.acquire(&first);
+    EXPECT_EQ("1", mSysfs.read(INTERACTIVE_BOOST));
+    mArbiter.expire(1000 * MS + TIMEOUT_MS * MS);
+    EXPECT_EQ("0", mSysfs.read(INTERACTIVE_BOOST));
+
+    mLaunch.acquire(&second);
+    EXPECT_EQ("1", mSysfs.read(INTERACTIVE_BOOST));
+    mLaunch.release();
+    EXPECT_EQ("0", mSysfs.read(INTERACTIVE_BOOST));
+}
+
+/* The launch pct is tuned after power_init() picked the backend, and live */
+TEST_F(LaunchBoostTest, UclampLevelSetAfterBackend)
+{
+    struct timespec first = at(1000 * MS), second = at(2000 * MS);
+
+    mArbiter.setResource(RES_UCLAMP_MIN_PCT, 0, uclamp_write);
+    mLaunch.setBackend(LAUNCH_BOOST_UCLAMP);
+    mLaunch.setUclampLevel(40);
+    mLaunch.acquire(&first);
+    EXPECT_EQ(40, uclampPct);
+    mLaunch.release();
+    EXPECT_EQ(0, uclampPct);
+
+    mLaunch.setUclampLevel(75);
+    mLaunch.acquire(&second);
+    EXPECT_EQ(75, uclampPct);
+    mLaunch.release();
+    EXPECT_EQ(0, uclampPct);
+}
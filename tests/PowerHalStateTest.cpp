@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "PowerHalState.h"
+
+#define MS 1000000LL
+
+/*
+ * Run these under -DPOWERHAL_TSAN=ON too; the checks below catch torn
+ * snapshots, ThreadSanitizer catches the races that do not tear.
+ */
+
+/* Every field derives from the store count, so a torn read shows */
+static struct TouchState numbered(int n)
+{
+    struct TouchState state;
+
+    state.lastTouchNs = n * MS;
+    state.consecutiveTouches = n;
+    state.vsyncCount = -n;
+    state.vsyncBoost = n & 1;
+    state.timerSet = n & 2;
+    state.touchboostDisabled = n & 4;
+    return state;
+}
+
+static bool consistent(const struct TouchState &state)
+{
+    int n = state.consecutiveTouches;
+
+    return state.lastTouchNs == n * MS && state.vsyncCount == -n &&
+           state.vsyncBoost == (bool)(n & 1) && state.timerSet == (bool)(n & 2) &&
+           state.touchboostDisabled == (bool)(n & 4);
+}
+
+static PowerHalState *halState;
+static std::atomic<int> inTransition;
+static std::atomic<int> overlaps;
+static std::atomic<int> transitions;
+
+static void slow_transition(bool on)
+{
+    struct timespec delay = {0, 5 * MS};
+
+    if (inTransition.fetch_add(1) != 0)
+        overlaps++;
+    /* the state flips after the handler, so it still reads the old one */
+    if (halState->interactive() == on)
+        overlaps++;
+    nanosleep(&delay, NULL);
+    transitions++;
+    inTransition.fetch_sub(1);
+}
+
+class PowerHalStateTest : public ::testing::Test {
+
+  protected:
+      PowerHalState mState;
+
+      void SetUp() override {
+          halState = &mState;
+          inTransition = 0;
+          overlaps = 0;
+          transitions = 0;
+      };
+};
+
+/* One writer, as the dispatch thread, against readers on other threads */
+TEST_F(PowerHalStateTest, SnapshotsAreConsistent)
+{
+    const int stores = 200000;
+    std::atomic<bool> done(false);
+    std::atomic<int> torn(0), backwards(0);
+    std::vector<std::thread> readers;
+    int null = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+    ASSERT_GE(null, 0);
+    for (int i = 0; i < 3; i++) {
+        readers.emplace_back([&, i] {
+            struct TouchState state;
+            int last = 0;
+
+            while (!done.load()) {
+                if (i == 0)
+                    mState.dump(null);
+                mState.loadTouchState(&state);
+                if (!consistent(state))
+                    torn++;
+                if (state.consecutiveTouches < last)
+                    backwards++;
+                last = state.consecutiveTouches;
+            }
+        });
+    }
+    for (int n = 1; n <= stores; n++)
+        mState.storeTouchState(numbered(n));
+    done = true;
+    for (std::thread &reader : readers)
+        reader.join();
+    close(null);
+
+    struct TouchState state;
+    mState.loadTouchState(&state);
+    EXPECT_EQ(stores, state.consecutiveTouches);
+    EXPECT_TRUE(consistent(state));
+    EXPECT_EQ(0, torn.load());
+    EXPECT_EQ(0, backwards.load());
+}
+
+/*
+ * Screen on/off from several binder threads run one at a time, skip
+ * repeats of the current state, and never hold up the touch state writer.
+ */
+TEST_F(PowerHalStateTest, TransitionsSerializedHintsKeepFlowing)
+{
+    std::atomic<bool> done(false);
+    std::atomic<int> stores(0);
+    std::vector<std::thread> binders;
+    std::thread dispatch([&] {
+        struct TouchState state;
+
+        while (!done.load()) {
+            mState.loadTouchState(&state);
+            mState.storeTouchState(numbered(state.consecutiveTouches + 1));
+            stores++;
+        }
+    });
+
+    for (int i = 0; i < 4; i++) {
+        binders.emplace_back([&, i] {
+            for (int j = 0; j < 10; j++)
+                mState.setInteractive((i + j) & 1, slow_transition);
+        });
+    }
+    for (std::thread &binder : binders)
+        binder.join();
+    int duringTransitions = stores.load();
+    done = true;
+    dispatch.join();
+
+    EXPECT_EQ(0, overlaps.load());
+    EXPECT_GT(transitions.load(), 0);
+    EXPECT_LE(transitions.load(), 40);
+    /* 5 ms per transition leaves the writer plenty of time to run */
+    EXPECT_GT(duringTransitions, transitions.load());
+
+    struct TouchState state;
+    mState.loadTouchState(&state);
+    EXPECT_TRUE(consistent(state));
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ProcessMigrator.h"
+#include "SysfsIo.h"
+#include "bench/FakeSysfs.h"
+
+static std::vector<std::string> moves;
+
+static int record_move(const char *path, enum sysfs_op op)
+{
+    if (op == SYSFS_OP_WRITE)
+        moves.push_back(path);
+    return 0;
+}
+
+/*
+ * Six processes in foreground, the first three running mediaserver, which
+ * is what gets migrated without a config. The fake tree has no kernel to
+ * move tasks, so the tests update /proc/<pid>/cpuset themselves.
+ */
+class ProcessMigratorTest : public ::testing::Test {
+
+  protected:
+      FakeSysfs mSysfs;
+
+      void SetUp() override {
+          mSysfs.addCpusets("0-7");
+          mSysfs.setProcesses(6, 3);
+          SysfsIo::setRoot(mSysfs.root().c_str());
+          moves.clear();
+          SysfsIo::setFaultHook(record_move);
+      };
+      void TearDown() override {
+          SysfsIo::setFaultHook(NULL);
+          SysfsIo::setRoot("");
+      };
+
+      void moveTo(int pid, const char *cpuset) {
+          mSysfs.write("/proc/" + std::to_string(pid) + "/cpuset", cpuset);
+      };
+};
+
+TEST_F(ProcessMigratorTest, MigratesAndRestores)
+{
+    ProcessMigrator migrator;
+
+    migrator.init();
+    migrator.setState(0);
+    EXPECT_EQ(3u, moves.size());
+    for (const std::string &path : moves)
+        EXPECT_EQ("/dev/cpuset/non_interactive/cgroup.procs", path);
+    for (int pid = 1000; pid < 1003; pid++)
+        moveTo(pid, "/non_interactive");
+
+    moves.clear();
+    migrator.setState(1);
+    EXPECT_EQ(3u, moves.size());
+    for (const std::string &path : moves)
+        EXPECT_EQ("/dev/cpuset/foreground/cgroup.procs", path);
+}
+
+/* What the framework did while the screen was off is not undone */
+TEST_F(ProcessMigratorTest, FrameworkMoveWins)
+{
+    ProcessMigrator migrator;
+
+    migrator.init();
+    migrator.setState(0);
+    ASSERT_EQ(3u, moves.size());
+    moveTo(1000, "/non_interactive");
+    moveTo(1001, "/top-app");
+    moveTo(1002, "/non_interactive");
+    mSysfs.remove("/proc/1002");
+
+    moves.clear();
+    migrator.setState(1);
+    ASSERT_EQ(1u, moves.size());
+    EXPECT_EQ("/dev/cpuset/foreground/cgroup.procs", moves[0]);
+    EXPECT_EQ("1000", mSysfs.read("/dev/cpuset/foreground/cgroup.procs"));
+    EXPECT_EQ("/top-app", mSysfs.read("/proc/1001/cpuset"));
+}
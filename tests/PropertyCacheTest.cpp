@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+
+#include <cutils/properties.h>
+
+#include "PropertyCache.h"
+
+static int notified;
+
+static void count_listener(__attribute__((unused)) void *cookie)
+{
+    notified++;
+}
+
+/* Each test runs in its own process under ctest, names are still unique */
+TEST(PropertyCacheTest, PropertySetLaterIsPickedUp)
+{
+    CachedProperty property("test.powerhal.later", "5");
+
+    EXPECT_FALSE(property.isSet());
+    EXPECT_EQ(5, property.intValue());
+
+    property_set("test.powerhal.later", "7");
+    PropertyCache::refresh();
+    EXPECT_TRUE(property.isSet());
+    EXPECT_EQ(7, property.intValue());
+
+    property_set("test.powerhal.later", "9");
+    PropertyCache::refresh();
+    EXPECT_EQ("9", property.value());
+}
+
+TEST(PropertyCacheTest, ListenersRunOnlyForTheirChanges)
+{
+    CachedProperty first("test.powerhal.watched.first");
+    CachedProperty second("test.powerhal.watched.second");
+    CachedProperty other("test.powerhal.other");
+
+    notified = 0;
+    PropertyCache::subscribe("test.powerhal.watched.", count_listener);
+
+    /* once per refresh, however many of the prefix changed */
+    property_set("test.powerhal.watched.first", "1");
+    property_set("test.powerhal.watched.second", "1");
+    PropertyCache::refresh();
+    EXPECT_EQ(1, notified);
+
+    property_set("test.powerhal.other", "1");
+    PropertyCache::refresh();
+    EXPECT_EQ(1, notified);
+
+    /* rewriting the same value moves the serial but changes nothing */
+    property_set("test.powerhal.watched.first", "1");
+    PropertyCache::refresh();
+    EXPECT_EQ(1, notified);
+    EXPECT_TRUE(first.boolValue());
+    EXPECT_TRUE(second.boolValue());
+    EXPECT_TRUE(other.boolValue());
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <pthread.h>
+#include <time.h>
+
+#include <gtest/gtest.h>
+
+#include "ThermalClient.h"
+
+/* Only bounds a hang when the client is broken, never a pass condition */
+#define WAIT_LIMIT_S 5
+
+/*
+ * A service manager lookup that blocks until the test lets it go, then
+ * finds the daemon or not. Everything the HAL does before release() runs
+ * while the connect is provably still in progress.
+ */
+class StubTransport : public ThermalClient::Transport {
+
+  public:
+      StubTransport(bool present): mPresent(present), mConnecting(false), mReleased(false),
+          mSent(-1) {
+          pthread_mutex_init(&mLock, NULL);
+          pthread_cond_init(&mCond, NULL);
+      };
+      ~StubTransport() {
+          pthread_cond_destroy(&mCond);
+          pthread_mutex_destroy(&mLock);
+      };
+      int connect(ThermalClient *) override {
+          pthread_mutex_lock(&mLock);
+          mConnecting = true;
+          pthread_cond_broadcast(&mCond);
+          while (!mReleased)
+              pthread_cond_wait(&mCond, &mLock);
+          mConnecting = false;
+          pthread_mutex_unlock(&mLock);
+          return mPresent ? 0 : -1;
+      };
+      int sendPowerSave(bool on) override {
+          pthread_mutex_lock(&mLock);
+          mSent = on;
+          pthread_cond_broadcast(&mCond);
+          pthread_mutex_unlock(&mLock);
+          return 0;
+      };
+
+      /* waits for the client thread to enter connect() */
+      bool waitConnecting() { return wait(&mConnecting); };
+      bool connecting() {
+          bool ret;
+
+          pthread_mutex_lock(&mLock);
+          ret = mConnecting;
+          pthread_mutex_unlock(&mLock);
+          return ret;
+      };
+      void release() {
+          pthread_mutex_lock(&mLock);
+          mReleased = true;
+          pthread_cond_broadcast(&mCond);
+          pthread_mutex_unlock(&mLock);
+      };
+      int waitSent() {
+          int ret;
+
+          wait(NULL);
+          pthread_mutex_lock(&mLock);
+          ret = mSent;
+          pthread_mutex_unlock(&mLock);
+          return ret;
+      };
+
+  private:
+      bool mPresent;
+      bool mConnecting;
+      bool mReleased;
+      int mSent;
+      pthread_mutex_t mLock;
+      pthread_cond_t mCond;
+
+      /* for *flag to be set, or with NULL for a power save to arrive */
+      bool wait(bool *flag) {
+          struct timespec deadline;
+          bool ret;
+
+          clock_gettime(CLOCK_REALTIME, &deadline);
+          deadline.tv_sec += WAIT_LIMIT_S;
+          pthread_mutex_lock(&mLock);
+          while (!(flag ? *flag : mSent >= 0) &&
+                 pthread_cond_timedwait(&mCond, &mLock, &deadline) == 0)
+              ;
+          ret = flag ? *flag : mSent >= 0;
+          pthread_mutex_unlock(&mLock);
+          return ret;
+      };
+};
+
+/* What power_init() and the first power save hint do with the client */
+static void init(ThermalClient &client, StubTransport &transport)
+{
+    EXPECT_EQ(0, client.start());
+    ASSERT_TRUE(transport.waitConnecting());
+    EXPECT_EQ(0, client.setPowerSave(true));
+    /* both returned while the lookup is still blocked */
+    EXPECT_TRUE(transport.connecting());
+    EXPECT_FALSE(client.connected());
+}
+
+TEST(ThermalClientTest, SlowDaemonDoesNotBlockInit)
+{
+    StubTransport transport(true);
+    ThermalClient client(&transport);
+
+    init(client, transport);
+
+    /* the state asked for before the daemon showed up is delivered */
+    transport.release();
+    EXPECT_EQ(1, transport.waitSent());
+    EXPECT_TRUE(client.connected());
+}
+
+TEST(ThermalClientTest, AbsentDaemonDoesNotBlockInit)
+{
+    StubTransport transport(false);
+    ThermalClient client(&transport);
+
+    init(client, transport);
+
+    transport.release();
+    EXPECT_FALSE(client.connected());
+    EXPECT_EQ(0, client.setPowerSave(false));
+    EXPECT_FALSE(client.connected());
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#include "TouchClassifier.h"
+
+#define MS 1000000LL
+#define PERIOD_240HZ 4166667LL
+
+/* Feeds touches gap apart from nowNs on, returns the time of the last */
+static int64_t touches(TouchClassifier &classifier, struct TouchState *state, int64_t nowNs,
+                       int count, int64_t gap)
+{
+    for (int i = 0; i < count; i++) {
+        nowNs += gap;
+        classifier.touch(state, nowNs);
+    }
+    return nowNs;
+}
+
+class TouchClassifierTest : public ::testing::Test {
+
+  protected:
+      TouchClassifier mClassifier;
+      struct TouchState mState;
+
+      void SetUp() override { memset(&mState, 0, sizeof(mState)); };
+};
+
+TEST_F(TouchClassifierTest, LearnsThePanelRate)
+{
+    int64_t now = touches(mClassifier, &mState, 1000 * MS, 1, 0);
+
+    now = touches(mClassifier, &mState, now, 40, PERIOD_240HZ);
+    ASSERT_TRUE(mClassifier.learned());
+    EXPECT_NEAR(PERIOD_240HZ, mClassifier.periodNs(), PERIOD_240HZ / 10);
+
+    /* the next gesture uses it: tighter than the 80 Hz legacy window */
+    touches(mClassifier, &mState, now, 1, 500 * MS);
+    EXPECT_LT(mClassifier.thresholds().shortNs, TouchClassifier::legacy().shortNs);
+    EXPECT_GT(mClassifier.thresholds().scrollEvents, TouchClassifier::legacy().scrollEvents);
+}
+
+/*
+ * A pause just under the new gesture gap first must not set the period:
+ * checked as learning ends, when the thresholds start to follow it.
+ */
+TEST_F(TouchClassifierTest, SlowFirstIntervalDoesNotSeed)
+{
+    int64_t now = touches(mClassifier, &mState, 1000 * MS, 1, 0);
+
+    now = touches(mClassifier, &mState, now, 1, 90 * MS);
+    now = touches(mClassifier, &mState, now, 14, PERIOD_240HZ);
+    EXPECT_FALSE(mClassifier.learned());
+    now = touches(mClassifier, &mState, now, 1, PERIOD_240HZ);
+    ASSERT_TRUE(mClassifier.learned());
+    EXPECT_NEAR(PERIOD_240HZ, mClassifier.periodNs(), PERIOD_240HZ / 10);
+
+    touches(mClassifier, &mState, now, 1, 500 * MS);
+    EXPECT_LT(mClassifier.thresholds().shortNs, TouchClassifier::legacy().shortNs);
+}
+
+/* Once seeded, pauses mid gesture are left out of the average */
+TEST_F(TouchClassifierTest, PausesAfterSeedingSkipped)
+{
+    int64_t now = touches(mClassifier, &mState, 1000 * MS, 1, 0);
+
+    now = touches(mClassifier, &mState, now, 8, PERIOD_240HZ);
+    for (int i = 0; i < 4; i++) {
+        now = touches(mClassifier, &mState, now, 1, 80 * MS);
+        now = touches(mClassifier, &mState, now, 10, PERIOD_240HZ);
+    }
+    ASSERT_TRUE(mClassifier.learned());
+    EXPECT_NEAR(PERIOD_240HZ, mClassifier.periodNs(), PERIOD_240HZ / 10);
+}
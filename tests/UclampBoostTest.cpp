@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2014 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <map>
+
+#include <errno.h>
+
+#include <gtest/gtest.h>
+
+#include "CpuTopology.h"
+#include "SysfsIo.h"
+#include "UclampBoost.h"
+#include "bench/FakeSysfs.h"
+
+#define TASKS "/dev/cpuset/top-app/tasks"
+
+/* The clamps a kernel with CONFIG_UCLAMP_TASK would hold, by tid */
+class StubClamp : public UclampBoost::TaskClamp {
+
+  public:
+      std::map<pid_t, uint32_t> mClamps;
+
+      int get(pid_t tid, uint32_t *utilMin) override {
+          if (!mClamps.count(tid)) {
+              errno = ESRCH;
+              return -1;
+          }
+          *utilMin = mClamps[tid];
+          return 0;
+      };
+      int set(pid_t tid, uint32_t utilMin) override {
+          if (!mClamps.count(tid)) {
+              errno = ESRCH;
+              return -1;
+          }
+          mClamps[tid] = utilMin;
+          return 0;
+      };
+};
+
+/* top-app has no cpu.uclamp.min in the fake tree, so clamps go per task */
+class UclampBoostTest : public ::testing::Test {
+
+  protected:
+      FakeSysfs mSysfs;
+      CpuTopology mTopology;
+      StubClamp mClamp;
+      UclampBoost mBoost;
+
+      UclampBoostTest(): mBoost("/dev/cpuctl", "/dev/cpuset", &mClamp) {};
+
+      void SetUp() override {
+          mSysfs.addCpus(4, 4);
+          mSysfs.write(TASKS, "101\n102\n103\n");
+          SysfsIo::setRoot(mSysfs.root().c_str());
+          mClamp.mClamps[gettid()] = 0;
+          mClamp.mClamps[101] = 0;
+          mClamp.mClamps[102] = 300;
+          mClamp.mClamps[103] = 800;
+          ASSERT_EQ(0, mTopology.scan());
+          ASSERT_EQ(0, mBoost.probe("top-app", mTopology, true));
+          ASSERT_EQ(UCLAMP_TASK, mBoost.mode());
+      };
+      void TearDown() override { SysfsIo::setRoot(""); };
+};
+
+TEST_F(UclampBoostTest, ReleaseRestoresEachThreadsClamp)
+{
+    EXPECT_EQ(0, mBoost.apply(50));
+    EXPECT_EQ(512u, mClamp.mClamps[101]);
+    EXPECT_EQ(512u, mClamp.mClamps[102]);
+    EXPECT_EQ(800u, mClamp.mClamps[103]);
+
+    /* a level change must not take the boost for the thread's own clamp */
+    EXPECT_EQ(0, mBoost.apply(80));
+    EXPECT_EQ(819u, mClamp.mClamps[102]);
+    EXPECT_EQ(819u, mClamp.mClamps[103]);
+
+    EXPECT_EQ(0, mBoost.apply(0));
+    EXPECT_EQ(0u, mClamp.mClamps[101]);
+    EXPECT_EQ(300u, mClamp.mClamps[102]);
+    EXPECT_EQ(800u, mClamp.mClamps[103]);
+}
+
+TEST_F(UclampBoostTest, ThreadsLeavingAreRestored)
+{
+    EXPECT_EQ(0, mBoost.apply(50));
+    mClamp.mClamps[104] = 100;
+    mSysfs.write(TASKS, "101\n104\n");
+
+    EXPECT_EQ(0, mBoost.apply(60));
+    EXPECT_EQ(614u, mClamp.mClamps[101]);
+    EXPECT_EQ(300u, mClamp.mClamps[102]);
+    EXPECT_EQ(800u, mClamp.mClamps[103]);
+    EXPECT_EQ(614u, mClamp.mClamps[104]);
+
+    EXPECT_EQ(0, mBoost.apply(0));
+    EXPECT_EQ(0u, mClamp.mClamps[101]);
+    EXPECT_EQ(100u, mClamp.mClamps[104]);
+}
+
+/* Threads exiting while boosted are not an error */
+TEST_F(UclampBoostTest, ExitedThreadsIgnored)
+{
+    mSysfs.write(TASKS, "101\n102\n103\n105\n");
+    EXPECT_EQ(0, mBoost.apply(50));
+    mClamp.mClamps.erase(102);
+    EXPECT_EQ(0, mBoost.apply(0));
+    EXPECT_EQ(0u, mClamp.mClamps[101]);
+    EXPECT_EQ(800u, mClamp.mClamps[103]);
+}
@@ -15,8 +15,16 @@
  */
 
 
+#define LOG_TAG "PowerHAL"
+
 #include <thd_binder_client.h>
 
+#include <binder/IServiceManager.h>
+#include <binder/Parcel.h>
+#include <cutils/log.h>
+
+#include "ThermalClient.h"
+
 using namespace powerhal_api;
 
 IMPLEMENT_META_INTERFACE(ThermalAPI, META_INTERFACE_NAME);
@@ -33,3 +41,53 @@ status_t BpThermalAPI::sendPowerSaveMsg(struct PowerSaveMessage *tmsg) {
     remote()->transact(SEND_POWER_SAVE_MSG, data, &reply);
     return reply.readInt32();
 }
+
+/*
+ * ThermalClient's way to thermald. Power save messages go out oneway: the
+ * daemon's reply carries nothing the HAL acts on, and waiting for it put
+ * the daemon's processing time on the hint path.
+ */
+class ThdTransport : public ThermalClient::Transport, public IBinder::DeathRecipient {
+
+  public:
+      ThdTransport() : mClient(NULL) {};
+
+      int connect(ThermalClient *client) {
+          /* checkService() does not wait, ThermalClient does the backoff */
+          sp<IBinder> binder = defaultServiceManager()->checkService(String16(SERVICE_NAME));
+
+          if (binder == NULL)
+              return -1;
+          mClient = client;
+          if (binder->linkToDeath(this) != NO_ERROR)
+              return -1;
+          mBinder = binder;
+          return 0;
+      }
+
+      int sendPowerSave(bool on) {
+          struct PowerSaveMessage msg = { 1 , 50 };
+          Parcel data;
+
+          msg.on = on;
+          data.writeInterfaceToken(IThermalAPI::getInterfaceDescriptor());
+          data.write((const void*)&msg, sizeof(msg));
+          return mBinder->transact(SEND_POWER_SAVE_MSG, data, NULL, IBinder::FLAG_ONEWAY) ==
+                 NO_ERROR ? 0 : -1;
+      }
+
+      void binderDied(const wp<IBinder> &) {
+          mClient->onDeath();
+      }
+
+  private:
+      ThermalClient *mClient;
+      sp<IBinder> mBinder;
+};
+
+ThermalClient::Transport *thd_transport(void)
+{
+    static sp<ThdTransport> transport = new ThdTransport();
+
+    return transport.get();
+}